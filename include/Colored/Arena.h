@@ -0,0 +1,57 @@
+/*
+ * File:   Arena.h
+ *
+ * Owns the colors, types, variables and expressions of a single colored net.
+ * Everything is released at once when the arena is destroyed.
+ */
+
+#ifndef COLORED_ARENA_H
+#define COLORED_ARENA_H
+
+#include <stddef.h>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace unfoldtacpn {
+    namespace Colored {
+        class Arena {
+        public:
+            Arena(size_t blockSize = 64*1024);
+            ~Arena();
+            Arena(const Arena&) = delete;
+            Arena& operator=(const Arena&) = delete;
+
+            template<typename T, typename... Args>
+            T* make(Args&&... args) {
+                std::lock_guard<std::mutex> lock(_lock);
+                void* mem = allocate(sizeof(T), alignof(T));
+                T* obj = new (mem) T(std::forward<Args>(args)...);
+                if constexpr (!std::is_trivially_destructible<T>::value)
+                    _destructors.emplace_back(obj, [](void* p) { static_cast<T*>(p)->~T(); });
+                return obj;
+            }
+
+            // not synchronized, only make may be used from several threads
+            void* allocate(size_t size, size_t align);
+
+            size_t allocated() const {
+                return _allocated;
+            }
+
+        private:
+            std::vector<std::unique_ptr<char[]>> _blocks;
+            std::vector<std::pair<void*, void(*)(void*)>> _destructors;
+            char* _next = nullptr;
+            char* _end = nullptr;
+            size_t _blockSize;
+            size_t _allocated = 0;
+            std::mutex _lock;
+        };
+    }
+}
+
+#endif /* COLORED_ARENA_H */
@@ -49,7 +49,7 @@ namespace unfoldtacpn {
         struct Arc {
             uint32_t place;
             uint32_t transition;
-            ArcExpression_ptr expr;
+            ArcExpression_ptr expr = nullptr;
             bool input;
             bool inhibitor = false;
             int weight;
@@ -60,15 +60,15 @@ namespace unfoldtacpn {
             uint32_t source;
             uint32_t transition;
             uint32_t destination;
-            ArcExpression_ptr in_expr;
-            ArcExpression_ptr out_expr;
+            ArcExpression_ptr in_expr = nullptr;
+            ArcExpression_ptr out_expr = nullptr;
             int weight;
             std::vector<Colored::TimeInterval> interval;
         };
 
         struct Transition {
             std::string name;
-            GuardExpression_ptr guard;
+            GuardExpression_ptr guard = nullptr;
             int player;
             bool urgent;
             SMC::Distribution distribution;
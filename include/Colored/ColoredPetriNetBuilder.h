@@ -8,11 +8,18 @@
 #ifndef COLOREDPETRINETBUILDER_H
 #define COLOREDPETRINETBUILDER_H
 
+#include <functional>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <sstream>
+#include <memory>
 
+#include "Arena.h"
+#include "ExpressionInterner.h"
 #include "ColoredNetStructures.h"
+#include "Symmetry.h"
+#include "UnfoldCache.h"
 #include "../TAPNBuilderInterface.h"
 
 namespace unfoldtacpn {
@@ -21,12 +28,25 @@ namespace unfoldtacpn {
         typedef std::unordered_map<std::string, const Colored::ColorType*> ColorTypeMap;
         typedef std::unordered_map<std::string, std::unordered_map<uint32_t , std::string>> PTPlaceMap;
         typedef std::unordered_map<std::string, std::vector<std::string>> PTTransitionMap;
+        typedef std::unordered_map<std::string, uint32_t> ConstantMap;
 
     public:
         ColoredPetriNetBuilder(std::stringstream *output_stream = nullptr);
         ColoredPetriNetBuilder(const ColoredPetriNetBuilder& orig);
         virtual ~ColoredPetriNetBuilder();
         void parseNet(std::istream& istream);
+        // parses the net directly from a file on disk
+        void parseNetFile(const std::string& path);
+        // same as parseNet, but without holding the whole document in memory
+        void parseNetStreaming(std::istream& istream);
+        // binary image of the parsed net, much faster to load than the PNML it came from
+        void writeSnapshot(std::ostream& out) const;
+        // loads a snapshot into an empty builder, returns false if it is not a valid snapshot
+        bool readSnapshot(std::istream& in);
+        // threads used by parseNet and parseNetFile, the resulting net does not depend on it
+        void setParseThreads(size_t threads) {
+            _parse_threads = threads;
+        }
 
         void addPlace(const std::string& name,
                       Colored::Multiset&& tokens,
@@ -51,6 +71,17 @@ namespace unfoldtacpn {
         void addColorType(const std::string& id,
                 const Colored::ColorType* type);
 
+        void addConstant(const std::string& name, uint32_t value);
+
+        const ConstantMap& getConstants() const {
+            return _constants;
+        }
+
+        // assigns new values to constants of the net, the time intervals and
+        // invariants given by them follow. Unfold again to emit the new net,
+        // from then on the bindings of the transitions are kept and reused.
+        void setConstants(const ConstantMap& values);
+
         void addTransportArc(const std::string& source,
                 const std::string& transition,
                 const std::string& destination,
@@ -87,14 +118,40 @@ namespace unfoldtacpn {
             return _pttransitionnames;
         }
 
+        // the names of the colors making up the given color of a place, one per
+        // constituent of its type, empty if there is no such place
+        std::vector<std::string> getPlaceColorNames(const std::string& place, uint32_t color) const;
+
+        // the sorts whose colors can be permuted without changing the net, by
+        // name; the generators refer to the places of the last unfolding
+        std::vector<Colored::SortSymmetry> getSymmetries() const;
+
+        // owns the types, variables and expressions of the net, shared by copies of the builder
+        Colored::Arena& arena() {
+            return *_arena;
+        }
+
+        // expressions are hash-consed, use this rather than the arena to create them
+        Colored::ExpressionInterner& expressions() {
+            return *_expressions;
+        }
 
         void unfold(TAPNBuilderInterface& builder);
+        // replays the places and transitions that are unchanged since the unfolding stored in cache
+        void unfold(TAPNBuilderInterface& builder, Colored::UnfoldCache& cache);
+        // unfolds only the places and transitions which can affect the marking
+        // of the given colored places, as well as time constraints of the net
+        void unfoldConeOfInfluence(TAPNBuilderInterface& builder, const std::unordered_set<std::string>& places);
         void clear() { _sumPlacesNames.clear(); _pttransitionnames.clear(); _ptplacenames.clear(); }
     private:
+        std::shared_ptr<Colored::Arena> _arena;
+        std::shared_ptr<Colored::ExpressionInterner> _expressions;
         std::unordered_map<std::string,uint32_t> _placenames;
         std::unordered_map<std::string,uint32_t> _transitionnames;
         PTPlaceMap _ptplacenames;
         std::unordered_map<std::string, std::string> _sumPlacesNames;
+        // inhibiting places which need a place holding their sum, see findSumPlaces
+        std::vector<bool> _sumPlaces;
         PTTransitionMap _pttransitionnames;
         std::vector< std::tuple<double, double> > _placelocations;
         std::vector< std::tuple<double, double> > _transitionlocations;
@@ -103,21 +160,35 @@ namespace unfoldtacpn {
         std::vector<Colored::Place> _places;
         std::map<uint32_t, std::vector<Colored::Arc>> _inhibitorArcs;
         ColorTypeMap _colors;
+        ConstantMap _constants;
+        // the bindings of a transition as the color ids of its variables, one
+        // row per binding. Only kept once constants are reassigned.
+        struct bindings_t {
+            std::vector<const Colored::Variable*> variables;
+            std::vector<uint32_t> colors;
+            size_t count = 0;
+        };
+        std::unordered_map<uint32_t, bindings_t> _bindings;
+        bool _keepBindings = false;
         double _time;
+        size_t _parse_threads = 1;
 
         std::stringstream* _output_stream;
         
         std::string arcToString(const Colored::Arc& arc) const;
         const std::string& findSumName(const std::string& id) const;
         const std::string& findSumName(uint32_t id) const { return findSumName(_places[id].name); }
-        const std::string& findPlaceName(uint32_t id, const Colored::Color* color) const
+        const std::string& findPlaceName(uint32_t id, const Colored::Color& color) const
         {
             return findPlaceName(_places[id].name, color);
         }
-        const std::string& findPlaceName(const std::string& place, const Colored::Color* color) const;
-        const Colored::TimeInterval& getTimeIntervalForArc(const std::vector< Colored::TimeInterval>& timeIntervals,const Colored::Color* color) const;
+        const std::string& findPlaceName(const std::string& place, const Colored::Color& color) const;
+        const Colored::TimeInterval& getTimeIntervalForArc(const std::vector< Colored::TimeInterval>& timeIntervals,const Colored::Color& color) const;
+        void findSumPlaces();
         void unfoldPlace(TAPNBuilderInterface& builder, const Colored::Place& place);
-        const Colored::TimeInvariant& getTimeInvariantForPlace(const std::vector< Colored::TimeInvariant>& TimeInvariants, const Colored::Color* color) const;
+        const Colored::TimeInvariant& getTimeInvariantForPlace(const std::vector< Colored::TimeInvariant>& TimeInvariants, const Colored::Color& color) const;
+        void forEachBinding(uint32_t transitionId,
+                            const std::function<void(const std::string&, const Colored::ExpressionContext::BindingMap&)>& f);
         void unfoldTransition(TAPNBuilderInterface& builder, const Colored::Transition& transition);
         void unfoldArc(TAPNBuilderInterface& builder, const Colored::Arc& arc, const Colored::ExpressionContext::BindingMap& binding, const std::string& name);
         void unfoldTransport(TAPNBuilderInterface& builder, const Colored::TransportArc& arc, const Colored::ExpressionContext::BindingMap& binding, const std::string& name);
@@ -142,6 +213,7 @@ namespace unfoldtacpn {
     private:
         Colored::GuardExpression_ptr _expr;
         Colored::ExpressionContext::BindingMap _bindings;
+        std::vector<const Colored::Variable*> _variables;
         const ColoredPetriNetBuilder::ColorTypeMap& _colorTypes;
         bool _empty = false;
 
@@ -152,6 +224,10 @@ namespace unfoldtacpn {
         BindingGenerator(const Colored::Transition& transition,
                 const ColoredPetriNetBuilder::ColorTypeMap& colorTypes);
         bool isInitial() const;
+        // in the order they were added to the bindings
+        const std::vector<const Colored::Variable*>& variables() const {
+            return _variables;
+        }
         Iterator begin();
         Iterator end();
     };
@@ -22,42 +22,31 @@
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
+#include <optional>
 
 namespace unfoldtacpn {
     namespace Colored {
         class ColorType;
         class TimeInvariant;
 
+        // a color is only a handle (type, id) and is passed by value, names and
+        // tuple components are kept by the type
         class Color {
         public:
             friend std::ostream& operator<< (std::ostream& stream, const Color& color);
 
         protected:
-            const std::vector<const Color*> _tuple;
             const ColorType* _colorType;
-            std::string _colorName;
             uint32_t _id;
 
         public:
             Color();
-            Color(const ColorType* colorType, uint32_t id, const std::vector<const Color*>& colors);
-            Color(const ColorType* colorType, uint32_t id, const char* color);
+            Color(const ColorType* colorType, uint32_t id);
             ~Color() {}
 
-            bool isTuple() const {
-                return _tuple.size() > 1;
-            }
-
-            const std::vector<const Color*>& getTuple() const {
-                return _tuple;
-            }
-
-            const std::string& getColorName() const {
-                if (this->isTuple()) {
-                    throw "Cannot get color from a tuple color.";
-                }
-                return _colorName;
-            }
+            bool isTuple() const;
+            std::vector<Color> getTuple() const;
+            std::string getColorName() const;
 
             const ColorType* getColorType() const {
                 return _colorType;
@@ -67,14 +56,16 @@ namespace unfoldtacpn {
                 return _id;
             }
 
-            static const Color* dotConstant();
+            static Color dotConstant();
 
-            const Color* operator[] (size_t index) const;
+            Color operator[] (size_t index) const;
             bool operator< (const Color& other) const;
             bool operator> (const Color& other) const;
             bool operator<= (const Color& other) const;
             bool operator>= (const Color& other) const;
 
+            // colors are equal only within one type, guards relate int
+            // ranges by value through equalValues and lessValue
             bool operator== (const Color& other) const {
                 return _colorType == other._colorType && _id == other._id;
             }
@@ -82,12 +73,18 @@ namespace unfoldtacpn {
                 return !((*this) == other);
             }
 
-            const Color& operator++ () const;
-            const Color& operator-- () const;
+            // successor and predecessor, wrapping around
+            Color operator++ () const;
+            Color operator-- () const;
 
             std::string toString() const;
-            static std::string toString(const Color* color);
-            static std::string toString(const std::vector<const Color*>& colors);
+            static std::string toString(const Color& color);
+            static std::string toString(const std::vector<Color>& colors);
+
+            // the comparisons of a guard, which may mix colors of different
+            // int ranges, these are compared by their integer value
+            static bool equalValues(const Color& a, const Color& b);
+            static bool lessValue(const Color& a, const Color& b);
         };
 
         class ColorType {
@@ -100,73 +97,81 @@ namespace unfoldtacpn {
             public:
                 iterator(const ColorType& type, size_t index) : type(type), index(index) {}
 
-                const Color& operator++() {
-                    return type[++index];
-                }
-
-                const Color& operator++(int) {
-                    return type[index++];
-                }
-
-                const Color& operator--() {
-                    return type[--index];
-                }
-                const Color& operator--(int) {
-                    return type[index--];
+                iterator& operator++() {
+                    ++index;
+                    return *this;
                 }
 
-                const Color& operator*() {
+                Color operator*() const {
                     return type[index];
                 }
 
-                const Color* operator->() {
-                    return &type[index];
-                }
-
-                bool operator==(const iterator& other) {
+                bool operator==(const iterator& other) const {
                     return type == other.type && index == other.index;
                 }
 
-                bool operator!=(const iterator& other) {
-                    return !(type == other.type) || index != other.index;
+                bool operator!=(const iterator& other) const {
+                    return !(*this == other);
                 }
             };
 
         private:
-            std::vector<Color> _colors;
+            std::vector<std::string> _names;
+            std::unordered_map<std::string,uint32_t> _index;
             uintptr_t _id;
             std::string _name;
 
         public:
-            ColorType(std::string name = "Undefined") : _colors(), _name(std::move(name)) {
+            ColorType(std::string name = "Undefined") : _name(std::move(name)) {
                 _id = (uintptr_t)this;
             }
+            virtual ~ColorType() {}
 
             virtual void addColor(const char* colorName);
-            virtual void addColor(std::vector<const Color*>& colors);
+            virtual void addColor(const std::vector<Color>& colors);
 
             virtual size_t size() const {
-                return _colors.size();
+                return _names.size();
             }
 
-            virtual const Color& operator[] (size_t index) const {
-                return _colors[index];
+            Color operator[] (size_t index) const {
+                return Color(this, index);
             }
 
-            virtual const Color& operator[] (int index) const {
-                return _colors[index];
+            Color operator[] (int index) const {
+                return Color(this, index);
             }
 
-            virtual const Color& operator[] (uint32_t index) const {
-                return _colors[index];
+            Color operator[] (uint32_t index) const {
+                return Color(this, index);
             }
 
-            virtual const Color& operator[] (const char* index) const;
+            // exits if no color of this type has the given name
+            Color operator[] (const char* index) const;
 
-            virtual const Color& operator[] (const std::string& index) const {
+            Color operator[] (const std::string& index) const {
                 return (*this)[index.c_str()];
             }
 
+            virtual std::optional<Color> findColor(const std::string& name) const;
+
+            virtual std::string getColorName(uint32_t id) const {
+                return _names[id];
+            }
+
+            // number of components of the colors of this type
+            virtual size_t tupleSize() const {
+                return 1;
+            }
+
+            virtual Color getTupleElement(uint32_t id, size_t index) const {
+                throw "Cannot access tuple if not a tuple color";
+            }
+
+            virtual bool isIntRange() const {
+                return false;
+            }
+
             bool operator== (const ColorType& other) const {
                 return _id == other._id;
             }
@@ -191,35 +196,18 @@ namespace unfoldtacpn {
         // just here to give transitions a scope
         class ScopeType : public ColorType {
             std::unordered_set<const ColorType*> _constituents;
+            std::unordered_map<std::string,Color> _names;
+            std::vector<const ColorType*> _ranges;
 
         public:
-            void addType(const ColorType* type) {
-                _constituents.insert(type);
-            }
+            void addType(const ColorType* type);
 
             size_t size() const override {
                 throw "size is undefined for ScopeType";
                 return 0;
             }
 
-            virtual const Color& operator[] (size_t index) const {
-                throw "Not supported";
-            }
-
-            virtual const Color& operator[] (int index) const {
-                throw "Not supported";
-            }
-
-            virtual const Color& operator[] (uint32_t index) const {
-                throw "Not supported";
-            }
-
-            virtual const Color& operator[] (const char* index) const;
-
-            virtual const Color& operator[] (const std::string& index) const {
-                return (*this)[index.c_str()];
-            }
-
+            std::optional<Color> findColor(const std::string& name) const override;
         };
 
 
@@ -240,17 +228,60 @@ namespace unfoldtacpn {
             bool operator== (const StarColorType& other) {
                 return true;
             }
+
+            std::string getColorName(uint32_t id) const override;
         };
 
+        // colors of a finite int range are implicit, their ids are offsets from the lower bound
+        class FiniteIntRangeType : public ColorType {
+        private:
+            uint32_t _start;
+            uint32_t _end;
+            size_t _size;
+
+        public:
+            FiniteIntRangeType(const std::string& name, uint32_t start, uint32_t end)
+            : ColorType(name), _start(start), _end(end), _size(end < start ? 0 : (size_t)(end - start) + 1) {}
+
+            void addColor(const char* colorName) override {
+                throw "Cannot add colors to a finite int range";
+            }
+
+            void addColor(const std::vector<Color>& colors) override {
+                throw "Cannot add colors to a finite int range";
+            }
+
+            size_t size() const override {
+                return _size;
+            }
+
+            bool isIntRange() const override {
+                return true;
+            }
+
+            uint32_t lowerBound() const {
+                return _start;
+            }
+
+            uint32_t upperBound() const {
+                return _end;
+            }
+
+            int64_t valueOf(uint32_t id) const {
+                return (int64_t)_start + id;
+            }
+
+            std::optional<Color> findColor(const std::string& name) const override;
+            std::string getColorName(uint32_t id) const override;
+        };
+
+        // colors of a product are implicit, their ids encode the components
         class ProductType : public ColorType {
         private:
             std::vector<const ColorType*> constituents;
-            mutable std::unordered_map<size_t,Color> cache;
 
         public:
             ProductType(const std::string& name = "Undefined") : ColorType(name) {}
-            ~ProductType() {
-            }
 
             void addType(const ColorType* type) {
                 constituents.push_back(type);
@@ -261,7 +292,7 @@ namespace unfoldtacpn {
             }
 
             void addColor(const char* colorName) override {}
-            void addColor(std::vector<const Color*>& colors) override {}
+            void addColor(const std::vector<Color>& colors) override {}
 
             size_t size() const override {
                 size_t product = 1;
@@ -283,18 +314,17 @@ namespace unfoldtacpn {
                 return true;
             }
 
-            const Color* getColor(const std::vector<const Color*>& colors) const;
+            // the tuple of the given components, if they match the constituents
+            std::optional<Color> getColor(const std::vector<Color>& colors) const;
 
-            const Color& operator[](size_t index) const override;
-            const Color& operator[](int index) const override {
-                return operator[]((size_t)index);
-            }
-            const Color& operator[](uint32_t index) const override {
-                return operator[]((size_t)index);
+            std::optional<Color> findColor(const std::string& name) const override;
+            std::string getColorName(uint32_t id) const override;
+
+            size_t tupleSize() const override {
+                return constituents.size();
             }
 
-            const Color& operator[](const char* index) const override;
-            const Color& operator[](const std::string& index) const override;
+            Color getTupleElement(uint32_t id, size_t index) const override;
         };
 
         struct Variable {
@@ -304,7 +334,7 @@ namespace unfoldtacpn {
 
         struct Binding {
             const Variable* var;
-            const Color* color;
+            Color color;
 
             bool operator==(Binding& other) {
                 return var->name.compare(other.var->name);
@@ -314,4 +344,3 @@ namespace unfoldtacpn {
 }
 
 #endif /* COLORS_H */
-
@@ -0,0 +1,94 @@
+/*
+ * File:   ExpressionInterner.h
+ *
+ * Hash-conses expression nodes of a colored net, structurally equal
+ * expressions are represented by the same node and share its id.
+ */
+
+#ifndef COLORED_EXPRESSIONINTERNER_H
+#define COLORED_EXPRESSIONINTERNER_H
+
+#include <stdint.h>
+#include <mutex>
+#include <typeindex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Arena.h"
+#include "Expressions.h"
+
+namespace unfoldtacpn {
+    namespace Colored {
+        class ExpressionInterner {
+        public:
+            ExpressionInterner(Arena& arena) : _arena(arena) {}
+            ExpressionInterner(const ExpressionInterner&) = delete;
+            ExpressionInterner& operator=(const ExpressionInterner&) = delete;
+
+            // children must already be interned, such that they can be compared by address
+            template<typename T, typename... Args>
+            const T* make(Args&&... args) {
+                Key key{std::type_index(typeid(T)), {}};
+                (append(key.second, args), ...);
+                std::lock_guard<std::mutex> lock(_lock);
+                auto it = _nodes.find(key);
+                if (it != _nodes.end())
+                    return static_cast<const T*>(it->second);
+                T* node = _arena.make<T>(std::forward<Args>(args)...);
+                node->_id = _expressions.size();
+                _expressions.push_back(node);
+                _nodes.emplace(std::move(key), node);
+                return node;
+            }
+
+            size_t size() const {
+                return _expressions.size();
+            }
+
+            const Expression* operator[](uint32_t id) const {
+                return _expressions[id];
+            }
+
+        private:
+            typedef std::pair<std::type_index, std::vector<uint64_t>> Key;
+
+            struct KeyHash {
+                size_t operator()(const Key& key) const {
+                    size_t h = key.first.hash_code();
+                    for (auto v : key.second)
+                        h ^= std::hash<uint64_t>()(v) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+                    return h;
+                }
+            };
+
+            template<typename V>
+            static void append(std::vector<uint64_t>& key, const V& value) {
+                if constexpr (std::is_pointer<V>::value)
+                    key.push_back((uint64_t)(uintptr_t)value);
+                else
+                    key.push_back((uint64_t)value);
+            }
+
+            static void append(std::vector<uint64_t>& key, const Color& color) {
+                key.push_back((uint64_t)(uintptr_t)color.getColorType());
+                key.push_back(color.getId());
+            }
+
+            template<typename V>
+            static void append(std::vector<uint64_t>& key, const std::vector<V>& values) {
+                key.push_back(values.size());
+                for (auto& v : values)
+                    append(key, v);
+            }
+
+            Arena& _arena;
+            std::vector<const Expression*> _expressions;
+            std::unordered_map<Key, const Expression*, KeyHash> _nodes;
+            std::mutex _lock;
+        };
+    }
+}
+
+#endif /* COLORED_EXPRESSIONINTERNER_H */
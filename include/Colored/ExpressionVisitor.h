@@ -0,0 +1,57 @@
+/*
+ * File:   ExpressionVisitor.h
+ *
+ * Double dispatch over the colored expression nodes.
+ */
+
+#ifndef COLORED_EXPRESSIONVISITOR_H
+#define COLORED_EXPRESSIONVISITOR_H
+
+#include "Expressions.h"
+
+namespace unfoldtacpn {
+    namespace Colored {
+        class ExpressionVisitor {
+        public:
+            ExpressionVisitor() {}
+            virtual ~ExpressionVisitor() {}
+
+            template<typename T>
+            void accept(T element)
+            {
+                _accept(element);
+            }
+
+        protected:
+            // color expressions
+            virtual void _accept(const DotConstantExpression* element) = 0;
+            virtual void _accept(const VariableExpression* element) = 0;
+            virtual void _accept(const UserOperatorExpression* element) = 0;
+            virtual void _accept(const UserSortExpression* element) = 0;
+            virtual void _accept(const NumberConstantExpression* element) = 0;
+            virtual void _accept(const SuccessorExpression* element) = 0;
+            virtual void _accept(const PredecessorExpression* element) = 0;
+            virtual void _accept(const TupleExpression* element) = 0;
+
+            // guards
+            virtual void _accept(const LessThanExpression* element) = 0;
+            virtual void _accept(const GreaterThanExpression* element) = 0;
+            virtual void _accept(const LessThanEqExpression* element) = 0;
+            virtual void _accept(const GreaterThanEqExpression* element) = 0;
+            virtual void _accept(const EqualityExpression* element) = 0;
+            virtual void _accept(const InequalityExpression* element) = 0;
+            virtual void _accept(const NotExpression* element) = 0;
+            virtual void _accept(const AndExpression* element) = 0;
+            virtual void _accept(const OrExpression* element) = 0;
+
+            // arc expressions
+            virtual void _accept(const AllExpression* element) = 0;
+            virtual void _accept(const NumberOfExpression* element) = 0;
+            virtual void _accept(const AddExpression* element) = 0;
+            virtual void _accept(const SubtractExpression* element) = 0;
+            virtual void _accept(const ScalarProductExpression* element) = 0;
+        };
+    }
+}
+
+#endif /* COLORED_EXPRESSIONVISITOR_H */
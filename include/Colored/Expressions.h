@@ -20,7 +20,7 @@
 #include <stdlib.h>
 #include <iostream>
 #include <cassert>
-#include <memory>
+#include <limits>
 
 
 #include "Colors.h"
@@ -31,12 +31,12 @@ namespace unfoldtacpn {
 
     namespace Colored {
         struct ExpressionContext {
-            typedef std::unordered_map<std::string, const Color*> BindingMap;
+            typedef std::unordered_map<std::string, Color> BindingMap;
             typedef std::unordered_map<std::string, const ColorType*> TypeMap;
             const BindingMap& binding;
             const TypeMap& colorTypes;
 
-            const Color* findColor(const std::string& color) const;
+            Color findColor(const std::string& color) const;
 
             const ProductType* findProductColorType(const std::vector<const ColorType*>& types) const;
         };
@@ -52,13 +52,30 @@ namespace unfoldtacpn {
             }
         };
 
+        // expression nodes are owned by the Arena of the net they were parsed for,
+        // children are plain pointers into the same arena
+        class ExpressionInterner;
+        class ExpressionVisitor;
+
         class Expression {
+        private:
+            friend class ExpressionInterner;
+            uint32_t _id = std::numeric_limits<uint32_t>::max();
+
         public:
             Expression() {}
+            virtual ~Expression() {}
+
+            // unique among the distinct expressions of a net, see ExpressionInterner
+            uint32_t id() const {
+                return _id;
+            }
 
             virtual void getVariables(std::set<const Variable*>& variables) const {
             }
 
+            virtual void visit(ExpressionVisitor& visitor) const = 0;
+
             virtual void expressionType() {
                 std::cout << "Expression" << std::endl;
             }
@@ -73,37 +90,44 @@ namespace unfoldtacpn {
             ColorExpression() {}
             virtual ~ColorExpression() {}
 
-            virtual const Color* eval(ExpressionContext& context) const = 0;
+            virtual Color eval(ExpressionContext& context) const = 0;
 
             virtual const ColorType* getColorType() const = 0;
 
-            virtual void getConstants(std::unordered_map<uint32_t, const Color*> &constantMap, uint32_t &index) const = 0;
+            virtual void getConstants(std::unordered_map<uint32_t, Color> &constantMap, uint32_t &index) const = 0;
         };
 
         class DotConstantExpression : public ColorExpression {
         public:
-            const Color* eval(ExpressionContext& context) const override {
+            void visit(ExpressionVisitor& visitor) const override;
+
+            Color eval(ExpressionContext& context) const override {
                 return Color::dotConstant();
             }
 
             const ColorType* getColorType() const override {
-                return Color::dotConstant()->getColorType();
+                return Color::dotConstant().getColorType();
             }
 
-            void getConstants(std::unordered_map<uint32_t, const Color*> &constantMap, uint32_t &index) const override {
-                const Color *dotColor = Color::dotConstant();
-                constantMap[index] = dotColor;
+            void getConstants(std::unordered_map<uint32_t, Color> &constantMap, uint32_t &index) const override {
+                constantMap[index] = Color::dotConstant();
             }
         };
 
-        typedef std::shared_ptr<ColorExpression> ColorExpression_ptr;
+        typedef const ColorExpression* ColorExpression_ptr;
 
         class VariableExpression : public ColorExpression {
         private:
             const Variable* _variable;
 
         public:
-            const Color* eval(ExpressionContext& context) const override {
+            void visit(ExpressionVisitor& visitor) const override;
+
+            const Variable* variable() const {
+                return _variable;
+            }
+
+            Color eval(ExpressionContext& context) const override {
                 auto it = context.binding.find(_variable->name);
                 if(it == std::end(context.binding))
                 {
@@ -124,7 +148,7 @@ namespace unfoldtacpn {
                 return _variable->name;
             }
 
-            void getConstants(std::unordered_map<uint32_t, const Color*> &constantMap, uint32_t &index) const override {
+            void getConstants(std::unordered_map<uint32_t, Color> &constantMap, uint32_t &index) const override {
             }
 
             VariableExpression(const Variable* variable)
@@ -133,26 +157,32 @@ namespace unfoldtacpn {
 
         class UserOperatorExpression : public ColorExpression {
         private:
-            const Color* _userOperator;
+            Color _userOperator;
 
         public:
-            const Color* eval(ExpressionContext& context) const override {
+            void visit(ExpressionVisitor& visitor) const override;
+
+            const Color& userOperator() const {
+                return _userOperator;
+            }
+
+            Color eval(ExpressionContext& context) const override {
                 return _userOperator;
             }
 
             std::string toString() const override {
-                return _userOperator->toString();
+                return _userOperator.toString();
             }
 
-            void getConstants(std::unordered_map<uint32_t, const Color*> &constantMap, uint32_t &index) const override {
+            void getConstants(std::unordered_map<uint32_t, Color> &constantMap, uint32_t &index) const override {
                 constantMap[index] = _userOperator;
             }
 
             const ColorType* getColorType() const override{
-                return _userOperator->getColorType();
+                return _userOperator.getColorType();
             }
 
-            UserOperatorExpression(const Color* userOperator)
+            UserOperatorExpression(const Color& userOperator)
                     : _userOperator(userOperator) {}
         };
 
@@ -161,6 +191,12 @@ namespace unfoldtacpn {
             ColorType* _userSort;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            ColorType* userSort() const {
+                return _userSort;
+            }
+
             ColorType* eval(ExpressionContext& context) const {
                 return _userSort;
             }
@@ -173,13 +209,19 @@ namespace unfoldtacpn {
                     : _userSort(userSort) {}
         };
 
-        typedef std::shared_ptr<UserSortExpression> UserSortExpression_ptr;
+        typedef const UserSortExpression* UserSortExpression_ptr;
 
         class NumberConstantExpression : public Expression {
         private:
             uint32_t _number;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            uint32_t number() const {
+                return _number;
+            }
+
             uint32_t eval(ExpressionContext& context) const {
                 return _number;
             }
@@ -188,15 +230,21 @@ namespace unfoldtacpn {
                     : _number(number) {}
         };
 
-        typedef std::shared_ptr<NumberConstantExpression> NumberConstantExpression_ptr;
+        typedef const NumberConstantExpression* NumberConstantExpression_ptr;
 
         class SuccessorExpression : public ColorExpression {
         private:
             ColorExpression_ptr _color;
 
         public:
-            const Color* eval(ExpressionContext& context) const override {
-                return &++(*_color->eval(context));
+            void visit(ExpressionVisitor& visitor) const override;
+
+            ColorExpression_ptr color() const {
+                return _color;
+            }
+
+            Color eval(ExpressionContext& context) const override {
+                return ++_color->eval(context);
             }
 
             void getVariables(std::set<const Variable*>& variables) const override {
@@ -211,15 +259,15 @@ namespace unfoldtacpn {
                 return _color->getColorType();
             }
 
-            void getConstants(std::unordered_map<uint32_t, const Color*> &constantMap, uint32_t &index) const override {
+            void getConstants(std::unordered_map<uint32_t, Color> &constantMap, uint32_t &index) const override {
                 _color->getConstants(constantMap, index);
                 for(auto& constIndexPair : constantMap){
-                    constIndexPair.second = &constIndexPair.second->operator++();
+                    constIndexPair.second = ++constIndexPair.second;
                 }
             }
 
-            SuccessorExpression(ColorExpression_ptr&& color)
-                    : _color(std::move(color)) {}
+            SuccessorExpression(ColorExpression_ptr color)
+                    : _color(color) {}
         };
 
         class PredecessorExpression : public ColorExpression {
@@ -227,8 +275,14 @@ namespace unfoldtacpn {
             ColorExpression_ptr _color;
 
         public:
-            const Color* eval(ExpressionContext& context) const override {
-                return &--(*_color->eval(context));
+            void visit(ExpressionVisitor& visitor) const override;
+
+            ColorExpression_ptr color() const {
+                return _color;
+            }
+
+            Color eval(ExpressionContext& context) const override {
+                return --_color->eval(context);
             }
 
             void getVariables(std::set<const Variable*>& variables) const override {
@@ -243,15 +297,15 @@ namespace unfoldtacpn {
                 return _color->getColorType();
             }
 
-            void getConstants(std::unordered_map<uint32_t, const Color*> &constantMap, uint32_t &index) const override {
+            void getConstants(std::unordered_map<uint32_t, Color> &constantMap, uint32_t &index) const override {
                 _color->getConstants(constantMap, index);
                 for(auto& constIndexPair : constantMap){
-                    constIndexPair.second = &constIndexPair.second->operator--();
+                    constIndexPair.second = --constIndexPair.second;
                 }
             }
 
-            PredecessorExpression(ColorExpression_ptr&& color)
-                    : _color(std::move(color)) {}
+            PredecessorExpression(ColorExpression_ptr color)
+                    : _color(color) {}
         };
 
         class TupleExpression : public ColorExpression {
@@ -260,27 +314,33 @@ namespace unfoldtacpn {
             const ColorType* _colorType;
 
         public:
-            const Color* eval(ExpressionContext& context) const override {
-                std::vector<const Color*> colors;
+            void visit(ExpressionVisitor& visitor) const override;
+
+            const std::vector<ColorExpression_ptr>& colors() const {
+                return _colors;
+            }
+
+            Color eval(ExpressionContext& context) const override {
+                std::vector<Color> colors;
                 std::vector<const ColorType*> types;
                 for (auto& color : _colors) {
                     colors.push_back(color->eval(context));
-                    types.push_back(colors.back()->getColorType());
+                    types.push_back(colors.back().getColorType());
                 }
 
                 const ProductType* pt = context.findProductColorType(types);
                 if(pt == nullptr)
                     throw "Could not match color types during parsing";
-                const Color* col = pt->getColor(colors);
-                assert(col != nullptr);
-                return col;
+                auto col = pt->getColor(colors);
+                assert(col);
+                return *col;
             }
 
             const ColorType* getColorType() const override {
                 return _colorType;
             }
 
-            void getConstants(std::unordered_map<uint32_t, const Color*> &constantMap, uint32_t &index) const override {
+            void getConstants(std::unordered_map<uint32_t, Color> &constantMap, uint32_t &index) const override {
                 for (auto& elem : _colors) {
                     elem->getConstants(constantMap, index);
                     index++;
@@ -316,7 +376,7 @@ namespace unfoldtacpn {
             virtual bool eval(ExpressionContext& context) const = 0;
         };
 
-        typedef std::shared_ptr<GuardExpression> GuardExpression_ptr;
+        typedef const GuardExpression* GuardExpression_ptr;
 
         class LessThanExpression : public GuardExpression {
         private:
@@ -324,8 +384,18 @@ namespace unfoldtacpn {
             ColorExpression_ptr _right;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            ColorExpression_ptr left() const {
+                return _left;
+            }
+
+            ColorExpression_ptr right() const {
+                return _right;
+            }
+
             bool eval(ExpressionContext& context) const override {
-                return _left->eval(context) < _right->eval(context);
+                return Color::lessValue(_left->eval(context), _right->eval(context));
             }
 
             void getVariables(std::set<const Variable*>& variables) const override {
@@ -333,8 +403,8 @@ namespace unfoldtacpn {
                 _right->getVariables(variables);
             }
 
-            LessThanExpression(ColorExpression_ptr&& left, ColorExpression_ptr&& right)
-                    : _left(std::move(left)), _right(std::move(right)) {}
+            LessThanExpression(ColorExpression_ptr left, ColorExpression_ptr right)
+                    : _left(left), _right(right) {}
         };
 
         class GreaterThanExpression : public GuardExpression {
@@ -343,8 +413,18 @@ namespace unfoldtacpn {
             ColorExpression_ptr _right;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            ColorExpression_ptr left() const {
+                return _left;
+            }
+
+            ColorExpression_ptr right() const {
+                return _right;
+            }
+
             bool eval(ExpressionContext& context) const override {
-                return _left->eval(context) > _right->eval(context);
+                return Color::lessValue(_right->eval(context), _left->eval(context));
             }
 
             void getVariables(std::set<const Variable*>& variables) const override {
@@ -352,8 +432,8 @@ namespace unfoldtacpn {
                 _right->getVariables(variables);
             }
 
-            GreaterThanExpression(ColorExpression_ptr&& left, ColorExpression_ptr&& right)
-                    : _left(std::move(left)), _right(std::move(right)) {}
+            GreaterThanExpression(ColorExpression_ptr left, ColorExpression_ptr right)
+                    : _left(left), _right(right) {}
         };
 
         class LessThanEqExpression : public GuardExpression {
@@ -362,8 +442,18 @@ namespace unfoldtacpn {
             ColorExpression_ptr _right;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            ColorExpression_ptr left() const {
+                return _left;
+            }
+
+            ColorExpression_ptr right() const {
+                return _right;
+            }
+
             bool eval(ExpressionContext& context) const override {
-                return _left->eval(context) <= _right->eval(context);
+                return !Color::lessValue(_right->eval(context), _left->eval(context));
             }
 
             void getVariables(std::set<const Variable*>& variables) const override {
@@ -371,8 +461,8 @@ namespace unfoldtacpn {
                 _right->getVariables(variables);
             }
 
-            LessThanEqExpression(ColorExpression_ptr&& left, ColorExpression_ptr&& right)
-                    : _left(std::move(left)), _right(std::move(right)) {}
+            LessThanEqExpression(ColorExpression_ptr left, ColorExpression_ptr right)
+                    : _left(left), _right(right) {}
         };
 
         class GreaterThanEqExpression : public GuardExpression {
@@ -381,8 +471,18 @@ namespace unfoldtacpn {
             ColorExpression_ptr _right;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            ColorExpression_ptr left() const {
+                return _left;
+            }
+
+            ColorExpression_ptr right() const {
+                return _right;
+            }
+
             bool eval(ExpressionContext& context) const override {
-                return _left->eval(context) >= _right->eval(context);
+                return !Color::lessValue(_left->eval(context), _right->eval(context));
             }
 
             void getVariables(std::set<const Variable*>& variables) const override {
@@ -390,8 +490,8 @@ namespace unfoldtacpn {
                 _right->getVariables(variables);
             }
 
-            GreaterThanEqExpression(ColorExpression_ptr&& left, ColorExpression_ptr&& right)
-                    : _left(std::move(left)), _right(std::move(right)) {}
+            GreaterThanEqExpression(ColorExpression_ptr left, ColorExpression_ptr right)
+                    : _left(left), _right(right) {}
         };
 
         class EqualityExpression : public GuardExpression {
@@ -400,8 +500,18 @@ namespace unfoldtacpn {
             ColorExpression_ptr _right;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            ColorExpression_ptr left() const {
+                return _left;
+            }
+
+            ColorExpression_ptr right() const {
+                return _right;
+            }
+
             bool eval(ExpressionContext& context) const override {
-                return _left->eval(context) == _right->eval(context);
+                return Color::equalValues(_left->eval(context), _right->eval(context));
             }
 
             void getVariables(std::set<const Variable*>& variables) const override {
@@ -409,8 +519,8 @@ namespace unfoldtacpn {
                 _right->getVariables(variables);
             }
 
-            EqualityExpression(ColorExpression_ptr&& left, ColorExpression_ptr&& right)
-                    : _left(std::move(left)), _right(std::move(right)) {}
+            EqualityExpression(ColorExpression_ptr left, ColorExpression_ptr right)
+                    : _left(left), _right(right) {}
         };
 
         class InequalityExpression : public GuardExpression {
@@ -419,8 +529,18 @@ namespace unfoldtacpn {
             ColorExpression_ptr _right;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            ColorExpression_ptr left() const {
+                return _left;
+            }
+
+            ColorExpression_ptr right() const {
+                return _right;
+            }
+
             bool eval(ExpressionContext& context) const override {
-                return _left->eval(context) != _right->eval(context);
+                return !Color::equalValues(_left->eval(context), _right->eval(context));
             }
 
             void getVariables(std::set<const Variable*>& variables) const override {
@@ -428,8 +548,8 @@ namespace unfoldtacpn {
                 _right->getVariables(variables);
             }
 
-            InequalityExpression(ColorExpression_ptr&& left, ColorExpression_ptr&& right)
-                    : _left(std::move(left)), _right(std::move(right)) {}
+            InequalityExpression(ColorExpression_ptr left, ColorExpression_ptr right)
+                    : _left(left), _right(right) {}
         };
 
         class NotExpression : public GuardExpression {
@@ -437,6 +557,12 @@ namespace unfoldtacpn {
             GuardExpression_ptr _expr;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            GuardExpression_ptr expr() const {
+                return _expr;
+            }
+
             bool eval(ExpressionContext& context) const override {
                 return !_expr->eval(context);
             }
@@ -445,7 +571,7 @@ namespace unfoldtacpn {
                 _expr->getVariables(variables);
             }
 
-            NotExpression(GuardExpression_ptr&& expr) : _expr(std::move(expr)) {}
+            NotExpression(GuardExpression_ptr expr) : _expr(expr) {}
         };
 
         class AndExpression : public GuardExpression {
@@ -454,6 +580,16 @@ namespace unfoldtacpn {
             GuardExpression_ptr _right;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            GuardExpression_ptr left() const {
+                return _left;
+            }
+
+            GuardExpression_ptr right() const {
+                return _right;
+            }
+
             bool eval(ExpressionContext& context) const override {
                 return _left->eval(context) && _right->eval(context);
             }
@@ -463,7 +599,7 @@ namespace unfoldtacpn {
                 _right->getVariables(variables);
             }
 
-            AndExpression(GuardExpression_ptr&& left, GuardExpression_ptr&& right)
+            AndExpression(GuardExpression_ptr left, GuardExpression_ptr right)
                     : _left(left), _right(right) {}
         };
 
@@ -473,6 +609,16 @@ namespace unfoldtacpn {
             GuardExpression_ptr _right;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            GuardExpression_ptr left() const {
+                return _left;
+            }
+
+            GuardExpression_ptr right() const {
+                return _right;
+            }
+
             bool eval(ExpressionContext& context) const override {
                 return _left->eval(context) || _right->eval(context);
             }
@@ -482,8 +628,8 @@ namespace unfoldtacpn {
                 _right->getVariables(variables);
             }
 
-            OrExpression(GuardExpression_ptr&& left, GuardExpression_ptr&& right)
-                    : _left(std::move(left)), _right(std::move(right)) {}
+            OrExpression(GuardExpression_ptr left, GuardExpression_ptr right)
+                    : _left(left), _right(right) {}
         };
 
         class ArcExpression : public Expression {
@@ -491,7 +637,7 @@ namespace unfoldtacpn {
             ArcExpression() {}
             virtual ~ArcExpression() {}
 
-            virtual void getConstants(std::unordered_map<uint32_t, std::vector<const Color*>> &constantMap, uint32_t &index) const = 0;
+            virtual void getConstants(std::unordered_map<uint32_t, std::vector<Color>> &constantMap, uint32_t &index) const = 0;
 
             virtual Multiset eval(ExpressionContext& context) const = 0;
 
@@ -502,19 +648,25 @@ namespace unfoldtacpn {
             virtual uint32_t weight() const = 0;
         };
 
-        typedef std::shared_ptr<ArcExpression> ArcExpression_ptr;
+        typedef const ArcExpression* ArcExpression_ptr;
 
         class AllExpression : public Expression {
         private:
             const ColorType* _sort;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            const ColorType* sort() const {
+                return _sort;
+            }
+
             virtual ~AllExpression() {};
-            std::vector<const Color*> eval(ExpressionContext& context) const {
-                std::vector<const Color*> colors;
+            std::vector<Color> eval(ExpressionContext& context) const {
+                std::vector<Color> colors;
                 assert(_sort != nullptr);
                 for (size_t i = 0; i < _sort->size(); i++) {
-                    colors.push_back(&(*_sort)[i]);
+                    colors.push_back((*_sort)[i]);
                 }
                 return colors;
             }
@@ -523,9 +675,9 @@ namespace unfoldtacpn {
                 return  _sort->size();
             }
 
-            void getConstants(std::unordered_map<uint32_t, std::vector<const Color*>> &constantMap, uint32_t &index) const {
+            void getConstants(std::unordered_map<uint32_t, std::vector<Color>> &constantMap, uint32_t &index) const {
                 for (size_t i = 0; i < _sort->size(); i++) {
-                    constantMap[index].push_back(&(*_sort)[i]);
+                    constantMap[index].push_back((*_sort)[i]);
                 }
             }
 
@@ -539,7 +691,7 @@ namespace unfoldtacpn {
             }
         };
 
-        typedef std::shared_ptr<AllExpression> AllExpression_ptr;
+        typedef const AllExpression* AllExpression_ptr;
 
         class NumberOfExpression : public ArcExpression {
         private:
@@ -548,8 +700,18 @@ namespace unfoldtacpn {
             AllExpression_ptr _all;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            const std::vector<ColorExpression_ptr>& colors() const {
+                return _color;
+            }
+
+            AllExpression_ptr all() const {
+                return _all;
+            }
+
             Multiset eval(ExpressionContext& context) const override {
-                std::vector<const Color*> colors;
+                std::vector<Color> colors;
                 if (!_color.empty()) {
                     for (auto elem : _color) {
                         colors.push_back(elem->eval(context));
@@ -557,18 +719,18 @@ namespace unfoldtacpn {
                 } else if (_all != nullptr) {
                     colors = _all->eval(context);
                 }
-                std::vector<std::pair<const Color*,uint32_t>> col;
+                std::vector<std::pair<Color,uint32_t>> col;
                 for (auto elem : colors) {
                     col.push_back(std::make_pair(elem, _number));
                 }
                 return Multiset(col);
             }
 
-            void getConstants(std::unordered_map<uint32_t, std::vector<const Color*>> &constantMap, uint32_t &index) const override {
+            void getConstants(std::unordered_map<uint32_t, std::vector<Color>> &constantMap, uint32_t &index) const override {
                 if (_all != nullptr)
                     _all->getConstants(constantMap, index);
                 else for (auto elem : _color) {
-                    std::unordered_map<uint32_t, const Color*> elemMap;
+                    std::unordered_map<uint32_t, Color> elemMap;
                     elem->getConstants(elemMap, index);
                     for(auto pair : elemMap){
                         constantMap[pair.first].push_back(pair.second);
@@ -617,17 +779,23 @@ namespace unfoldtacpn {
 
             NumberOfExpression(std::vector<ColorExpression_ptr>&& color, uint32_t number = 1)
                     : _number(number), _color(std::move(color)), _all(nullptr) {}
-            NumberOfExpression(AllExpression_ptr&& all, uint32_t number = 1)
-                    : _number(number), _color(), _all(std::move(all)) {}
+            NumberOfExpression(AllExpression_ptr all, uint32_t number = 1)
+                    : _number(number), _color(), _all(all) {}
         };
 
-        typedef std::shared_ptr<NumberOfExpression> NumberOfExpression_ptr;
+        typedef const NumberOfExpression* NumberOfExpression_ptr;
 
         class AddExpression : public ArcExpression {
         private:
             std::vector<ArcExpression_ptr> _constituents;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            const std::vector<ArcExpression_ptr>& constituents() const {
+                return _constituents;
+            }
+
             Multiset eval(ExpressionContext& context) const override {
                 Multiset ms;
                 for (auto expr : _constituents) {
@@ -636,7 +804,7 @@ namespace unfoldtacpn {
                 return ms;
             }
 
-            void getConstants(std::unordered_map<uint32_t, std::vector<const Color*>> &constantMap, uint32_t &index) const override {
+            void getConstants(std::unordered_map<uint32_t, std::vector<Color>> &constantMap, uint32_t &index) const override {
                 uint32_t indexCopy = index;
                 for (auto elem : _constituents) {
                     uint32_t localIndex = indexCopy;
@@ -676,11 +844,21 @@ namespace unfoldtacpn {
             ArcExpression_ptr _right;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            ArcExpression_ptr left() const {
+                return _left;
+            }
+
+            ArcExpression_ptr right() const {
+                return _right;
+            }
+
             Multiset eval(ExpressionContext& context) const override {
                 return _left->eval(context) - _right->eval(context);
             }
 
-            void getConstants(std::unordered_map<uint32_t, std::vector<const Color*>> &constantMap, uint32_t &index) const override {
+            void getConstants(std::unordered_map<uint32_t, std::vector<Color>> &constantMap, uint32_t &index) const override {
                 uint32_t rIndex = index;
                 _left->getConstants(constantMap, index);
                 _right->getConstants(constantMap, rIndex);
@@ -692,11 +870,11 @@ namespace unfoldtacpn {
             }
 
             uint32_t weight() const override {
-                auto* left = dynamic_cast<NumberOfExpression*>(_left.get());
+                auto* left = dynamic_cast<const NumberOfExpression*>(_left);
                 if (!left || !left->isAll()) {
                     throw WeightException("Left constituent of subtract is not an all expression!");
                 }
-                auto* right = dynamic_cast<NumberOfExpression*>(_right.get());
+                auto* right = dynamic_cast<const NumberOfExpression*>(_right);
                 if (!right || !right->isSingleColor()) {
                     throw WeightException("Right constituent of subtract is not a single color number of expression!");
                 }
@@ -709,8 +887,8 @@ namespace unfoldtacpn {
                 return _left->toString() + " - " + _right->toString();
             }
 
-            SubtractExpression(ArcExpression_ptr&& left, ArcExpression_ptr&& right)
-                    : _left(std::move(left)), _right(std::move(right)) {}
+            SubtractExpression(ArcExpression_ptr left, ArcExpression_ptr right)
+                    : _left(left), _right(right) {}
         };
 
         class ScalarProductExpression : public ArcExpression {
@@ -719,11 +897,21 @@ namespace unfoldtacpn {
             ArcExpression_ptr _expr;
 
         public:
+            void visit(ExpressionVisitor& visitor) const override;
+
+            ArcExpression_ptr expr() const {
+                return _expr;
+            }
+
+            uint32_t scalar() const {
+                return _scalar;
+            }
+
             Multiset eval(ExpressionContext& context) const override {
                 return _expr->eval(context) * _scalar;
             }
 
-            void getConstants(std::unordered_map<uint32_t, std::vector<const Color*>> &constantMap, uint32_t &index) const override {
+            void getConstants(std::unordered_map<uint32_t, std::vector<Color>> &constantMap, uint32_t &index) const override {
                 _expr->getConstants(constantMap, index);
             }
 
@@ -739,8 +927,8 @@ namespace unfoldtacpn {
                 return std::to_string(_scalar) + " * " + _expr->toString();
             }
 
-            ScalarProductExpression(ArcExpression_ptr&& expr, uint32_t scalar)
-                    : _scalar(std::move(scalar)), _expr(expr) {}
+            ScalarProductExpression(ArcExpression_ptr expr, uint32_t scalar)
+                    : _scalar(scalar), _expr(expr) {}
         };
     }
 }
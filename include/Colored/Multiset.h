@@ -36,8 +36,8 @@ namespace unfoldtacpn {
                 bool operator==(const Iterator& other) const;
                 bool operator!=(const Iterator& other) const;
                 Iterator& operator++();
-                std::pair<const Color*,uint32_t> operator++(int);
-                std::pair<const Color*,uint32_t> operator*();
+                std::pair<Color,uint32_t> operator++(int);
+                std::pair<Color,uint32_t> operator*();
             };
 
             typedef std::vector<std::pair<uint32_t,uint32_t>> Internal;
@@ -45,9 +45,9 @@ namespace unfoldtacpn {
         public:
             Multiset();
             Multiset(const Multiset& orig);
-            Multiset(const Color* color, uint32_t count);
-            Multiset(std::pair<const Color*,uint32_t> color);
-            Multiset(const std::vector<std::pair<const Color*,uint32_t>>& colors);
+            Multiset(const Color& color, uint32_t count);
+            Multiset(std::pair<Color,uint32_t> color);
+            Multiset(const std::vector<std::pair<Color,uint32_t>>& colors);
             virtual ~Multiset();
 
             Multiset operator+ (const Multiset& other) const;
@@ -56,8 +56,8 @@ namespace unfoldtacpn {
             void operator+= (const Multiset& other);
             void operator-= (const Multiset& other);
             void operator*= (uint32_t scalar);
-            uint32_t operator[] (const Color* color) const;
-            uint32_t& operator[] (const Color* color);
+            uint32_t operator[] (const Color& color) const;
+            uint32_t& operator[] (const Color& color);
 
             bool empty() const;
             void clean();
@@ -0,0 +1,33 @@
+/*
+ * File:   Symmetry.h
+ *
+ * A sort is symmetric when permuting its colors maps the net onto itself:
+ * no expression names one of its colors or relies on their order, through
+ * constants, successors, predecessors or comparisons other than equality,
+ * no guard compares it with an int range sharing some of its values,
+ * no time constraint is given for a specific color of it, and the initial
+ * marking is the same under every permutation. A verifier can then treat
+ * markings which only differ by such a permutation as one.
+ */
+
+#ifndef COLORED_SYMMETRY_H
+#define COLORED_SYMMETRY_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace unfoldtacpn {
+    namespace Colored {
+        struct SortSymmetry {
+            std::string sort;
+            std::vector<std::string> colors;
+            // swapping the first two colors and rotating all of them by one
+            // generate every permutation of the colors, given here by the
+            // unfolded places they move and the place each is moved to
+            std::vector<std::unordered_map<std::string, std::string>> generators;
+        };
+    }
+}
+
+#endif /* COLORED_SYMMETRY_H */
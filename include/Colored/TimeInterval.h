@@ -11,8 +11,10 @@
 #include <map>
 #include <cassert>
 #include <string>
+#include <string_view>
 #include <cctype>
 #include <vector>
+#include <unordered_map>
 #include "Colors.h"
 
 namespace unfoldtacpn {
@@ -22,13 +24,18 @@ namespace unfoldtacpn {
         public: //Construter
             TimeInterval(Colored::Color color) : leftStrict(false), lowerBound(0), upperBound(std::numeric_limits<int>::max()), rightStrict(true), color(color){ };
             TimeInterval(bool leftStrict, uint32_t lowerBound, uint32_t upperBound, bool rightStrict, Colored::Color color) : leftStrict(leftStrict), lowerBound(lowerBound), upperBound(upperBound), rightStrict(rightStrict), color(color) { };
-            TimeInterval(const TimeInterval& ti) : leftStrict(ti.leftStrict), lowerBound(ti.lowerBound), upperBound(ti.upperBound), rightStrict(ti.rightStrict), color(ti.color) {};
+            TimeInterval(const TimeInterval& ti) : leftStrict(ti.leftStrict), lowerBound(ti.lowerBound), upperBound(ti.upperBound), rightStrict(ti.rightStrict), color(ti.color),
+                lowerConstant(ti.lowerConstant), upperConstant(ti.upperConstant) {};
+            // the bounds of another interval, for another color
+            TimeInterval(const TimeInterval& ti, Colored::Color color) : TimeInterval(ti) { this->color = color; };
             TimeInterval& operator=(const TimeInterval& ti)
             {
                 leftStrict = ti.leftStrict;
                 lowerBound = ti.lowerBound;
                 upperBound = ti.upperBound;
                 rightStrict = ti.rightStrict;
+                lowerConstant = ti.lowerConstant;
+                upperConstant = ti.upperConstant;
                 return *this;
             }
 
@@ -38,6 +45,16 @@ namespace unfoldtacpn {
                 return color;
             }
 
+            // names of the constants the bounds were given by, empty for numbers
+            void setConstants(const std::string& lower, const std::string& upper) {
+                lowerConstant = lower;
+                upperConstant = upper;
+            }
+            const std::string& getLowerConstant() const { return lowerConstant; }
+            const std::string& getUpperConstant() const { return upperConstant; }
+            // takes the bounds given by constants from a new assignment of the constants
+            void instantiate(const std::unordered_map<std::string, uint32_t>& constantValues);
+
 
         public: // inspectors
             void print(std::ostream& out) const;
@@ -76,14 +93,16 @@ namespace unfoldtacpn {
 
         public: // statics
 
-            static TimeInterval createFor(const std::string& interval,
-                                          std::vector<const Colored::Color*> colors, std::unordered_map<std::string, uint32_t> constantValues);
+            static TimeInterval createFor(std::string_view interval,
+                                          const std::vector<Colored::Color>& colors, const std::unordered_map<std::string, uint32_t>& constantValues);
             static inline void ltrim(std::string &s) {
                 s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](int ch) {
                     return !std::isspace(ch);
                 }));
             }
-            static Colored::Color createColor(std::vector<const Colored::Color*> colors);
+            static Colored::Color createColor(std::vector<Colored::Color> colors);
+            // a number or the name of a constant, which is stored in constant
+            static uint32_t parseBound(std::string_view text, const std::unordered_map<std::string, uint32_t>& constantValues, std::string& constant);
 
             // trim from end
             static inline void rtrim(std::string &s) {
@@ -104,6 +123,8 @@ namespace unfoldtacpn {
             uint32_t upperBound;
             bool rightStrict;
             Colored::Color color;
+            std::string lowerConstant;
+            std::string upperConstant;
         };
 
         inline std::ostream& operator<<(std::ostream& out, const TimeInterval& interval)
@@ -6,11 +6,13 @@
 #define VERIFYPN_TIMEINVARIANT_H
 
 #include <string>
+#include <string_view>
 #include <map>
 #include <limits>
 #include <algorithm>
 #include <cctype>
 #include <locale>
+#include <unordered_map>
 #include "Colors.h"
 
 namespace unfoldtacpn {
@@ -20,11 +22,14 @@ namespace unfoldtacpn {
         public:
             TimeInvariant(Colored::Color&& color) : strictComparison(true), bound(std::numeric_limits<int>::max()), color(std::move(color)) {};
             TimeInvariant(bool strictComparison, int bound, Colored::Color&& color) : strictComparison(strictComparison), bound(bound), color(std::move(color)) { };
-            TimeInvariant(const TimeInvariant& ti) : strictComparison(ti.strictComparison), bound(ti.bound), color(ti.color) { };
+            TimeInvariant(const TimeInvariant& ti) : strictComparison(ti.strictComparison), bound(ti.bound), color(ti.color), boundConstant(ti.boundConstant) { };
+            // the bound of another invariant, for another color
+            TimeInvariant(const TimeInvariant& ti, Colored::Color color) : TimeInvariant(ti) { this->color = color; };
             TimeInvariant& operator=(const TimeInvariant& ti)
             {
                 strictComparison = ti.strictComparison;
                 bound = ti.bound;
+                boundConstant = ti.boundConstant;
                 return *this;
             }
 
@@ -36,15 +41,21 @@ namespace unfoldtacpn {
             inline const int getBound() const { return bound; }
             inline const bool isBoundStrict() const { return strictComparison; }
             inline const Colored::Color& getColor() const { return color;}
+            // name of the constant the bound was given by, empty for numbers
+            inline const std::string& getBoundConstant() const { return boundConstant; }
+            inline void setBoundConstant(const std::string& constant) { boundConstant = constant; }
+            // takes the bound from a new assignment of the constants if it is given by one
+            void instantiate(const std::unordered_map<std::string, uint32_t>& constants);
 
         public: // statics
-            static TimeInvariant createFor(const std::string& invariant, const std::vector<const Colored::Color*>& colors, const std::unordered_map<std::string, uint32_t>& constants);
-            static Colored::Color createColor(const std::vector<const Colored::Color*>& colors);
+            static TimeInvariant createFor(std::string_view invariant, const std::vector<Colored::Color>& colors, const std::unordered_map<std::string, uint32_t>& constants);
+            static Colored::Color createColor(const std::vector<Colored::Color>& colors);
 
         private: // data
             bool strictComparison;
             int bound;
             Colored::Color color;
+            std::string boundConstant;
         };
 
         inline bool operator==(const TimeInvariant& a, const TimeInvariant& b)
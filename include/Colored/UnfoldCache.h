@@ -0,0 +1,95 @@
+/*
+ * File:   UnfoldCache.h
+ *
+ * Keeps the unfolding of every place and transition of a previous run
+ * together with a fingerprint of its colored definition. Passing the same
+ * cache to ColoredPetriNetBuilder::unfold for an edited net replays the
+ * unchanged parts instead of unfolding them again.
+ */
+
+#ifndef COLORED_UNFOLDCACHE_H
+#define COLORED_UNFOLDCACHE_H
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../TAPNBuilderInterface.h"
+
+namespace unfoldtacpn {
+    class ColoredPetriNetBuilder;
+
+    namespace Colored {
+        class UnfoldCache {
+        public:
+            // builder calls of one unfolded place or transition
+            typedef std::vector<std::function<void(TAPNBuilderInterface&)>> calls_t;
+
+            // two independently mixed hashes, an entry is only replayed if both match
+            struct Fingerprint {
+                uint64_t first = 0;
+                uint64_t second = 0;
+
+                Fingerprint() = default;
+                Fingerprint(uint64_t value) : first(value), second(value) {}
+                Fingerprint(uint64_t first, uint64_t second) : first(first), second(second) {}
+
+                bool operator==(const Fingerprint& other) const {
+                    return first == other.first && second == other.second;
+                }
+            };
+
+            // number of places and transitions replayed by the last unfolding
+            size_t replayedPlaces() const {
+                return _replayedPlaces;
+            }
+
+            size_t replayedTransitions() const {
+                return _replayedTransitions;
+            }
+
+            // names of the places and transitions unfolded again by the last unfolding
+            const std::vector<std::string>& unfoldedPlaces() const {
+                return _unfoldedPlaces;
+            }
+
+            const std::vector<std::string>& unfoldedTransitions() const {
+                return _unfoldedTransitions;
+            }
+
+            void clear() {
+                _places.clear();
+                _transitions.clear();
+            }
+
+        private:
+            friend class unfoldtacpn::ColoredPetriNetBuilder;
+            struct PlaceEntry {
+                Fingerprint fingerprint;
+                calls_t calls;
+                std::unordered_map<uint32_t, std::string> names;
+                std::string sumName;
+            };
+
+            struct TransitionEntry {
+                Fingerprint fingerprint;
+                calls_t calls;
+                std::vector<std::string> names;
+                // only recorded when unfolding with an output stream
+                bool hasBindings = false;
+                std::string bindings;
+            };
+
+            std::unordered_map<std::string, PlaceEntry> _places;
+            std::unordered_map<std::string, TransitionEntry> _transitions;
+            size_t _replayedPlaces = 0;
+            size_t _replayedTransitions = 0;
+            std::vector<std::string> _unfoldedPlaces;
+            std::vector<std::string> _unfoldedTransitions;
+        };
+    }
+}
+
+#endif /* COLORED_UNFOLDCACHE_H */
@@ -0,0 +1,108 @@
+/*
+ * File:   NetReducer.h
+ *
+ * Optional stage between the unfolder and a builder which removes parts of
+ * the unfolded net that cannot influence its timed behaviour. The net is
+ * recorded as it is unfolded and handed on by reduce():
+ *
+ *  - transitions which need tokens from a place that can never be marked
+ *    are removed, as are inhibitor arcs from such places,
+ *  - places without arcs are removed unless tokens with an invariant in
+ *    them can stop time,
+ *  - transitions with the same arcs, intervals and attributes are merged
+ *    into the first of them, which gets their summed weight. Transitions
+ *    with a random delay race each other and are not merged.
+ *
+ * Removed places keep their initial marking, so queries can use it instead
+ * of the place; collecting PlaceBounds before the reducer does so when the
+ * queries are simplified.
+ */
+
+#ifndef NETREDUCER_H
+#define NETREDUCER_H
+
+#include "TAPNBuilderInterface.h"
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace unfoldtacpn {
+    class NetReducer : public TAPNBuilderInterface {
+    public:
+        NetReducer(TAPNBuilderInterface& builder) : _builder(builder) {}
+
+        void addPlace(const std::string& name, int tokens, bool strict, int bound,
+                      double x, double y) override;
+        void addTransition(const std::string& name, int player, bool urgent,
+                           double x, double y, int distrib, std::vector<double> distribParam1,
+                           double weight, int firingMode) override;
+        void addInputArc(const std::string& place, const std::string& transition,
+                         bool inhibitor, int weight,
+                         bool lstrict, bool ustrict, int lower, int upper) override;
+        void addOutputArc(const std::string& transition, const std::string& place, int weight) override;
+        void addTransportArc(const std::string& source, const std::string& transition,
+                             const std::string& target, int weight,
+                             bool lstrict, bool ustrict, int lower, int upper) override;
+
+        // reduces the recorded net and builds what is left of it
+        void reduce();
+
+        // the removed places with the marking they keep
+        const std::unordered_map<std::string, int>& removedPlaces() const {
+            return _removedPlaces;
+        }
+
+        // transitions which can never fire
+        const std::vector<std::string>& removedTransitions() const {
+            return _removedTransitions;
+        }
+
+        // the transitions a kept transition stands for besides itself, such
+        // that traces can be mapped back to the unreduced net
+        const std::vector<std::string>& mergedTransitions(const std::string& transition) const;
+
+    private:
+        struct Place {
+            std::string name;
+            int tokens;
+            bool strict;
+            int bound;
+            double x, y;
+        };
+
+        struct Transition {
+            std::string name;
+            int player;
+            bool urgent;
+            double x, y;
+            int distrib;
+            std::vector<double> distribParams;
+            double weight;
+            int firingMode;
+        };
+
+        struct Arc {
+            enum Kind { Input, Output, Transport } kind;
+            std::string place;
+            std::string transition;
+            std::string target;
+            bool inhibitor;
+            int weight;
+            bool lstrict, ustrict;
+            int lower, upper;
+        };
+
+        TAPNBuilderInterface& _builder;
+        std::vector<Place> _places;
+        std::vector<Transition> _transitions;
+        std::vector<Arc> _arcs;
+
+        std::unordered_map<std::string, int> _removedPlaces;
+        std::vector<std::string> _removedTransitions;
+        std::unordered_map<std::string, std::vector<std::string>> _merged;
+    };
+}
+
+#endif /* NETREDUCER_H */
@@ -27,6 +27,7 @@
 #include <list>
 #include <map>
 #include <chrono>
+#include <mutex>
 #include <unordered_map>
 
 namespace unfoldtacpn {
@@ -37,6 +38,15 @@ namespace unfoldtacpn {
         protected:
             const std::unordered_map<std::string, std::unordered_map<uint32_t , std::string>>& _coloredPlaceNames;
             const std::unordered_map<std::string, std::vector<std::string>>& _coloredTransitionNames;
+            // compiled expansion of every colored place analyzed so far, queries
+            // may be analyzed by several threads at once
+            std::unordered_map<std::string, Expr_ptr> _placeExpressions;
+            std::mutex _placeExpressionsLock;
+
+            template<typename F>
+            const Expr_ptr& cachedExpression(const std::string& key, F&& build);
+            Expr_ptr expandPlace(const std::string& place) const;
+            Expr_ptr expandPlace(const std::string& place, const std::vector<std::string>& pattern) const;
         public:
             NamingContext(  const std::unordered_map<std::string, std::unordered_map<uint32_t , std::string>>& cplaces,
                             const std::unordered_map<std::string, std::vector<std::string>>& ctnames)
@@ -44,9 +54,26 @@ namespace unfoldtacpn {
                       _coloredTransitionNames(ctnames)
                     {}
 
-            bool resolvePlace(const std::string& place, std::unordered_map<uint32_t,std::string>& out);
+            virtual ~NamingContext() {}
+
+            // the unfolded names of a colored place or transition, nullptr if unknown
+            const std::unordered_map<uint32_t,std::string>* resolvePlace(const std::string& place) const;
+
+            const std::vector<std::string>* resolveTransition(const std::string& transition) const;
+
+            // the sum of the unfolded places of a colored place, built once and
+            // shared by every query analyzed in this context, nullptr if unknown
+            const Expr_ptr& placeExpression(const std::string& place);
+
+            // the sum of the unfolded places of a colored place whose color matches
+            // the pattern, where "*" matches any color, nullptr if none matches
+            const Expr_ptr& placeExpression(const std::string& place, const std::vector<std::string>& pattern);
 
-            bool resolveTransition(const std::string& transition, std::vector<std::string>& out);
+            // the names of the colors making up the color of an unfolded place,
+            // empty when the colors of the net are not known to this context
+            virtual std::vector<std::string> placeColor(const std::string& place, uint32_t color) const {
+                return {};
+            }
 
             auto& allColoredPlaceNames() const { return _coloredPlaceNames; }
             auto& allColoredTransitionNames() const { return _coloredTransitionNames; }
@@ -121,12 +121,20 @@ namespace unfoldtacpn {
         class IdentifierExpr : public Expr {
         public:
             IdentifierExpr(const std::string& name) : _name(name) {}
+            // only the unfolded places whose color matches, "*" matches any color
+            IdentifierExpr(const std::string& name, std::vector<std::string> color)
+            : _name(name), _color(std::move(color)) {}
             void analyze(NamingContext& context) override;
             void visit(Visitor& visitor) const override;
             const Expr_ptr& compiled() const { return _compiled; }
             const std::string& name() const { return _name; }
+            const std::vector<std::string>& color() const { return _color; }
+            // reads a color pattern such as "a", "*" or "(a,*)", false if malformed
+            static bool parseColor(const std::string& text, std::vector<std::string>& color);
+            static std::string colorToString(const std::vector<std::string>& color);
         private:
             std::string _name;
+            std::vector<std::string> _color;
             Expr_ptr _compiled;
         };
 
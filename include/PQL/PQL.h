@@ -64,6 +64,11 @@ namespace unfoldtacpn {
 
         void to_xml(std::ostream&, const std::vector<std::pair<Condition_ptr,std::string>>&, uint32_t tab_size = 2, bool print_newlines = true);
         void to_xml(std::ostream&, const Condition&, uint32_t init_tabs = 0, uint32_t tab_size = 2, bool print_newlines = true);
+
+        // compact binary encoding of analyzed queries for consumers in the same process
+        void to_binary(std::string& out, const std::vector<std::pair<Condition_ptr,std::string>>&);
+        // false if data is not an encoding written by to_binary
+        bool from_binary(const std::string& data, std::vector<std::pair<Condition_ptr,std::string>>& queries);
     } // PQL
 }
 
@@ -0,0 +1,74 @@
+/*
+ * File:   QueryPlaces.h
+ *
+ * Collects the colored places read by queries which have not been analyzed
+ * yet. Only reachability properties (EF/AG of a state formula) can be decided
+ * on the part of the net that can affect these places, any other query
+ * needs the whole net.
+ */
+
+#ifndef QUERYPLACES_H
+#define QUERYPLACES_H
+
+#include "Visitor.h"
+
+#include <string>
+#include <unordered_set>
+
+namespace unfoldtacpn {
+    namespace PQL {
+        class QueryPlaces : public Visitor {
+        public:
+            const std::unordered_set<std::string>& places() const {
+                return _places;
+            }
+
+            bool needsWholeNet() const {
+                return _whole_net;
+            }
+
+        protected:
+            void _accept(const NotCondition* element) override;
+            void _accept(const AndCondition* element) override;
+            void _accept(const OrCondition* element) override;
+            void _accept(const LessThanCondition* element) override;
+            void _accept(const LessThanOrEqualCondition* element) override;
+            void _accept(const EqualCondition* element) override;
+            void _accept(const NotEqualCondition* element) override;
+            void _accept(const DeadlockCondition* element) override;
+
+            void _accept(const ControlCondition* element) override;
+            void _accept(const EFCondition* element) override;
+            void _accept(const EGCondition* element) override;
+            void _accept(const AGCondition* element) override;
+            void _accept(const AFCondition* element) override;
+            void _accept(const EXCondition* element) override;
+            void _accept(const AXCondition* element) override;
+            void _accept(const EUCondition* element) override;
+            void _accept(const AUCondition* element) override;
+            void _accept(const PFCondition* element) override;
+            void _accept(const PGCondition* element) override;
+
+            void _accept(const KSafeCondition* element) override;
+            void _accept(const BooleanCondition* element) override;
+            void _accept(const ShallowCondition* element) override;
+
+            void _accept(const UnfoldedIdentifierExpr* element) override;
+            void _accept(const LiteralExpr* element) override;
+            void _accept(const PlusExpr* element) override;
+            void _accept(const MultiplyExpr* element) override;
+            void _accept(const MinusExpr* element) override;
+            void _accept(const SubtractExpr* element) override;
+            void _accept(const IdentifierExpr* element) override;
+
+        private:
+            void reachability(const Condition_ptr& cond);
+
+            std::unordered_set<std::string> _places;
+            bool _whole_net = false;
+            bool _in_quantifier = false;
+        };
+    }
+}
+
+#endif /* QUERYPLACES_H */
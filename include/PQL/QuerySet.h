@@ -0,0 +1,71 @@
+/*
+ * File:   QuerySet.h
+ *
+ * A batch of analyzed queries as one graph in which structurally equal
+ * conditions and expressions are a single node, such that an engine can
+ * evaluate every distinct atomic proposition once per state instead of once
+ * per query. Nodes are numbered in the order they are first met, operands
+ * before the nodes using them, so the numbering is stable for a given list
+ * of queries and evaluating nodes by increasing number is bottom-up.
+ */
+
+#ifndef QUERYSET_H
+#define QUERYSET_H
+
+#include "PQL.h"
+
+#include <stdint.h>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace unfoldtacpn {
+    namespace PQL {
+        class QuerySet {
+        public:
+            // the root of a query which failed to parse
+            static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+            struct Node {
+                // exactly one of them is set
+                Condition_ptr condition;
+                Expr_ptr expression;
+                std::vector<uint32_t> operands;
+            };
+
+            QuerySet();
+            QuerySet(const std::vector<std::pair<Condition_ptr, std::string>>& queries);
+            QuerySet(const QuerySet&) = delete;
+            QuerySet& operator=(const QuerySet&) = delete;
+            ~QuerySet();
+
+            // the node of a condition, which is added to the graph when no
+            // structurally equal condition is in it yet
+            uint32_t add(const Condition_ptr& cond);
+
+            // the queries rewritten onto the shared nodes, in the given order
+            const std::vector<std::pair<Condition_ptr, std::string>>& queries() const { return _queries; }
+            uint32_t root(size_t query) const { return _roots[query]; }
+
+            size_t nodes() const { return _nodes.size(); }
+            const Node& node(uint32_t id) const { return _nodes[id]; }
+
+            // comparisons, deadlock and constants, in increasing order
+            const std::vector<uint32_t>& atoms() const { return _atoms; }
+
+        private:
+            class Builder;
+
+            std::vector<std::pair<Condition_ptr, std::string>> _queries;
+            std::vector<uint32_t> _roots;
+            std::vector<Node> _nodes;
+            std::vector<uint32_t> _atoms;
+            std::unique_ptr<Builder> _builder;
+        };
+    }
+}
+
+#endif /* QUERYSET_H */
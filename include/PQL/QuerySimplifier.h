@@ -0,0 +1,143 @@
+/*
+ * File:   QuerySimplifier.h
+ *
+ * Rewrites analyzed queries into smaller equivalent ones before they are
+ * printed: constants are folded, nested conjunctions, disjunctions, sums and
+ * products are flattened and duplicate operands of conjunctions and
+ * disjunctions are removed. Comparisons are decided from bounds on the
+ * number of tokens in the unfolded places, which PlaceBounds collects while
+ * the net is unfolded. Temporal operators are kept, only their operands are
+ * simplified.
+ */
+
+#ifndef QUERYSIMPLIFIER_H
+#define QUERYSIMPLIFIER_H
+
+#include "QuerySet.h"
+#include "Visitor.h"
+#include "../TAPNBuilderInterface.h"
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+namespace unfoldtacpn {
+    namespace PQL {
+        // Forwards the unfolded net to another builder and records which
+        // places can gain or lose tokens. A place without incoming arcs never
+        // holds more than its initial marking, one without outgoing arcs never
+        // less, and one without either keeps it.
+        class PlaceBounds : public TAPNBuilderInterface {
+        public:
+            PlaceBounds(TAPNBuilderInterface& builder) : _builder(builder) {}
+
+            void addPlace(const std::string& name, int tokens, bool strict, int bound,
+                          double x, double y) override;
+            void addTransition(const std::string& name, int player, bool urgent,
+                               double x, double y, int distrib, std::vector<double> distribParam1,
+                               double weight, int firingMode) override;
+            void addInputArc(const std::string& place, const std::string& transition,
+                             bool inhibitor, int weight,
+                             bool lstrict, bool ustrict, int lower, int upper) override;
+            void addOutputArc(const std::string& transition, const std::string& place, int weight) override;
+            void addTransportArc(const std::string& source, const std::string& transition,
+                                 const std::string& target, int weight,
+                                 bool lstrict, bool ustrict, int lower, int upper) override;
+
+            // the fewest and most tokens the place can hold, the maximum is
+            // INT64_MAX when it is unbounded
+            std::pair<int64_t, int64_t> bounds(const std::string& place) const;
+
+        private:
+            struct Place {
+                int initial = 0;
+                bool gains = false;
+                bool loses = false;
+            };
+
+            TAPNBuilderInterface& _builder;
+            std::unordered_map<std::string, Place> _places;
+        };
+
+        class QuerySimplifier : public Visitor {
+        public:
+            // without bounds only the structure of the queries is simplified
+            QuerySimplifier() = default;
+            QuerySimplifier(const PlaceBounds& bounds) : _bounds(&bounds) {}
+
+            Condition_ptr simplify(const Condition_ptr& cond);
+
+        protected:
+            void _accept(const NotCondition* element) override;
+            void _accept(const AndCondition* element) override;
+            void _accept(const OrCondition* element) override;
+            void _accept(const LessThanCondition* element) override;
+            void _accept(const LessThanOrEqualCondition* element) override;
+            void _accept(const EqualCondition* element) override;
+            void _accept(const NotEqualCondition* element) override;
+            void _accept(const DeadlockCondition* element) override;
+
+            void _accept(const ControlCondition* element) override;
+            void _accept(const EFCondition* element) override;
+            void _accept(const EGCondition* element) override;
+            void _accept(const AGCondition* element) override;
+            void _accept(const AFCondition* element) override;
+            void _accept(const EXCondition* element) override;
+            void _accept(const AXCondition* element) override;
+            void _accept(const EUCondition* element) override;
+            void _accept(const AUCondition* element) override;
+            void _accept(const PFCondition* element) override;
+            void _accept(const PGCondition* element) override;
+
+            void _accept(const KSafeCondition* element) override;
+            void _accept(const BooleanCondition* element) override;
+            void _accept(const ShallowCondition* element) override;
+
+            void _accept(const UnfoldedIdentifierExpr* element) override;
+            void _accept(const LiteralExpr* element) override;
+            void _accept(const PlusExpr* element) override;
+            void _accept(const MultiplyExpr* element) override;
+            void _accept(const MinusExpr* element) override;
+            void _accept(const SubtractExpr* element) override;
+            void _accept(const IdentifierExpr* element) override;
+
+        private:
+            // the values an expression can take, saturated at +-INF
+            struct Range {
+                int64_t lower;
+                int64_t upper;
+            };
+
+            struct Simplified {
+                Expr_ptr source;
+                Expr_ptr expr;
+                Range range;
+            };
+
+            const Simplified& simplify(const Expr_ptr& expr);
+            void logical(const LogicalCondition* element, bool conjunction);
+            template<typename T>
+            void compare(const CompareCondition* element);
+            template<typename T>
+            void quantifier(const SimpleQuantifierCondition* element);
+            template<typename T>
+            void until(const UntilCondition* element);
+            template<typename T>
+            void proba(const ProbaCondition* element);
+
+            const PlaceBounds* _bounds = nullptr;
+            // shared subexpressions, such as the expansions of colored places,
+            // are simplified once and stay shared
+            std::unordered_map<const Expr*, Simplified> _exprs;
+            // operands of conjunctions and disjunctions are compared by their
+            // node, each simplified condition is numbered once
+            QuerySet _operands;
+            Condition_ptr _current;
+            Expr_ptr _current_expr;
+            Condition_ptr _cond;
+            Simplified _expr;
+        };
+    }
+}
+
+#endif /* QUERYSIMPLIFIER_H */
@@ -21,29 +21,41 @@
 #define VERIFYPN_XMLPRINTER_H
 
 #include <iostream>
+#include <string>
+#include <string_view>
 #include "Visitor.h"
 
 namespace unfoldtacpn {
     namespace PQL {
+        // Output is collected in a buffer which is written to the stream when it
+        // fills up and when the printer is destroyed. Without newlines the XML
+        // is printed compactly, without any whitespace between tags.
         class XMLPrinter : public Visitor {
         public:
-            XMLPrinter(std::ostream& os, uint32_t init_tabs = 0, uint32_t tab_size = 2, bool print_newlines = true) :
-                os(os), tabs(init_tabs), tab_size(tab_size),
-                        print_newlines(print_newlines) {}
+            XMLPrinter(std::ostream& os, uint32_t init_tabs = 0, uint32_t tab_size = 2, bool print_newlines = true);
+            ~XMLPrinter();
+
+            void flush();
 
         protected:
             std::ostream& os;
+            std::string buffer;
             uint32_t tabs;
             const uint32_t tab_size;
             const bool print_newlines;
-            static constexpr char single_tab = ' ';
+            static constexpr size_t buffer_size = 64*1024;
+
+            void generateTabs();
+            void newline();
 
-            std::ostream& generateTabs();
-            std::ostream& newline();
+            void write(std::string_view text) {
+                buffer.append(text);
+            }
 
-            void openXmlTag(const std::string& tag);
-            void closeXmlTag(const std::string &tag);
-            void outputLine(const std::string &line);
+            void openXmlTag(std::string_view tag);
+            void closeXmlTag(std::string_view tag);
+            void outputLine(std::string_view line);
+            void outputPlace(const std::string& place);
 
             void _accept(const NotCondition *element) override;
 
@@ -0,0 +1,50 @@
+/*
+ * File:   ParallelFor.h
+ *
+ * Runs independent iterations on a fixed number of threads, each thread
+ * takes one contiguous chunk of the index range.
+ */
+
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <algorithm>
+#include <exception>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+namespace unfoldtacpn {
+    // calls body(i) for every i in [0, n). If an iteration throws, the
+    // exception of the lowest chunk is rethrown once all threads are done.
+    template<typename F>
+    void parallelFor(size_t n, size_t threads, F&& body) {
+        threads = std::min(threads, n);
+        if (threads <= 1) {
+            for (size_t i = 0; i < n; ++i)
+                body(i);
+            return;
+        }
+        size_t chunk = (n + threads - 1) / threads;
+        std::vector<std::exception_ptr> errors(threads);
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                try {
+                    for (size_t i = t * chunk; i < std::min(n, (t + 1) * chunk); ++i)
+                        body(i);
+                } catch (...) {
+                    errors[t] = std::current_exception();
+                }
+            });
+        }
+        for (auto& w : workers)
+            w.join();
+        for (auto& e : errors)
+            if (e)
+                std::rethrow_exception(e);
+    }
+}
+
+#endif /* PARALLELFOR_H */
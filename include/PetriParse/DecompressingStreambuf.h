@@ -0,0 +1,57 @@
+/*
+ * File:   DecompressingStreambuf.h
+ *
+ * Reads a stream which may be gzip or xz compressed, the format is detected
+ * from its first bytes. Compressed input is decompressed as it is read, other
+ * input is passed through unchanged. gzip needs zlib (HAVE_ZLIB) and xz
+ * needs liblzma (HAVE_LZMA) at build time.
+ */
+
+#ifndef DECOMPRESSINGSTREAMBUF_H
+#define DECOMPRESSINGSTREAMBUF_H
+
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <vector>
+
+namespace unfoldtacpn {
+class DecompressingStreambuf : public std::streambuf {
+public:
+    enum Format {
+        Plain,
+        Gzip,
+        Xz
+    };
+
+    // one per compressed format, defined with the implementation
+    class Decoder;
+
+    DecompressingStreambuf(std::istream& in, size_t window = 64*1024);
+    ~DecompressingStreambuf();
+
+    Format format() const {
+        return _format;
+    }
+
+    // the format of a stream starting with the given bytes, 6 bytes are enough
+    static Format detect(const char* data, size_t length);
+
+protected:
+    int_type underflow() override;
+
+private:
+    bool fill();
+
+    std::istream& _in;
+    std::vector<char> _input;
+    std::vector<char> _output;
+    size_t _pos = 0;
+    size_t _length = 0;
+    Format _format;
+    bool _done = false;
+    std::unique_ptr<Decoder> _decoder;
+};
+}
+
+#endif /* DECOMPRESSINGSTREAMBUF_H */
@@ -34,6 +34,9 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <memory>
+#include <functional>
+#include <mutex>
 #include <rapidxml.hpp>
 
 namespace unfoldtacpn {
@@ -44,24 +47,65 @@ public:
     typedef std::unordered_map<std::string, const unfoldtacpn::Colored::Variable*> VariableMap;
     typedef std::vector<rapidxml::xml_node<>*> node_vector_t;
 
+    // an element read by the streaming parser, parsed on its own
+    struct XMLFragment {
+        std::vector<char> text;
+        rapidxml::xml_document<> doc;
+
+        XMLFragment(std::vector<char>&& xml) : text(std::move(xml)) {
+            doc.parse<0>(text.data());
+        }
+
+        rapidxml::xml_node<>* node() {
+            return doc.first_node();
+        }
+    };
+    typedef std::shared_ptr<XMLFragment> fragment_ptr;
+    // hands a parsed element over to the builder
+    typedef std::function<void()> commit_t;
+
 public:
     PNMLParser() {
         _builder = nullptr;
     }
 
+    // number of threads used to parse the elements of the net, they are
+    // still added to the builder in document order
+    void setParseThreads(size_t threads) {
+        _threads = threads;
+    }
+
     void parse(std::istream& xml,
         ColoredPetriNetBuilder* builder);
 
+    // parses the file in place, memory-mapped where the platform allows it
+    void parseFile(const std::string& path,
+        ColoredPetriNetBuilder* builder);
+
+    // parses elements as they are read instead of building a DOM of the whole document
+    void parseStreaming(std::istream& xml,
+        ColoredPetriNetBuilder* builder);
+
 private:
+    void parseBuffer(char* text, ColoredPetriNetBuilder* builder);
+    void parseNodes(const node_vector_t& nodes, const std::function<commit_t(rapidxml::xml_node<>*)>& parser);
+    void beginParse(ColoredPetriNetBuilder* builder);
+    void endParse();
+    void parseConstant(rapidxml::xml_node<>* element);
+    void dispatchStreamed(const fragment_ptr& fragment, size_t seq);
+    const char* missingEndpoint(rapidxml::xml_node<>* element);
+    void releaseDeferred(const std::string& id);
     int parseWeight(rapidxml::xml_node<>* element);
     unfoldtacpn::Colored::ArcExpression_ptr parseHLInscriptions(rapidxml::xml_node<>* element, const Colored::ColorType* type);
     std::vector<Colored::TimeInterval> parseTimeGuard(rapidxml::xml_node<>* element);
+    Colored::TimeInterval parseInterval(const char* text, const Colored::Color& color);
+    Colored::TimeInvariant parseInvariant(const char* text, const Colored::Color& color);
     void findNodes(rapidxml::xml_node<>* element, node_vector_t& colored_arc, node_vector_t& regular_arcs, node_vector_t& inhib_arcs, node_vector_t& trans_arcs, node_vector_t& transitions, node_vector_t& places);
-    void parsePlace(rapidxml::xml_node<>* element);
-    std::pair<std::string, std::vector<const unfoldtacpn::Colored::Color*>> parseTimeConstraint(rapidxml::xml_node<> *element);
-    void parseArc(rapidxml::xml_node<>* element, bool inhibitor = false);
-    void handleArc(rapidxml::xml_node<>* element);
-    void parseTransition(rapidxml::xml_node<>* element);
+    commit_t parsePlace(rapidxml::xml_node<>* element);
+    std::pair<const char*, std::vector<unfoldtacpn::Colored::Color>> parseTimeConstraint(rapidxml::xml_node<> *element);
+    commit_t parseArc(rapidxml::xml_node<>* element, bool inhibitor = false);
+    commit_t handleArc(rapidxml::xml_node<>* element, const fragment_ptr& owner = nullptr);
+    commit_t parseTransition(rapidxml::xml_node<>* element);
     void parseDeclarations(rapidxml::xml_node<>* element);
     void parseNamedSort(rapidxml::xml_node<>* element);
     unfoldtacpn::Colored::ArcExpression_ptr parseArcExpression(rapidxml::xml_node<>* element, const Colored::ColorType* type);
@@ -75,8 +119,8 @@ private:
     const std::vector<std::vector<unfoldtacpn::Colored::ColorExpression_ptr>>& collectedColors, uint32_t numberof, const Colored::ColorType* type);
     std::vector<std::vector<unfoldtacpn::Colored::ColorExpression_ptr>> cartesianProduct(const std::vector<unfoldtacpn::Colored::ColorExpression_ptr>& rightSet, const std::vector<unfoldtacpn::Colored::ColorExpression_ptr>& leftSet);
     std::vector<std::vector<unfoldtacpn::Colored::ColorExpression_ptr>> cartesianProduct(const std::vector<std::vector<unfoldtacpn::Colored::ColorExpression_ptr>>& rightSet, const std::vector<unfoldtacpn::Colored::ColorExpression_ptr>& leftSet);
-    void parseTransportArc(rapidxml::xml_node<>* element);
-    void parseSingleTransportArc(rapidxml::xml_node<>* element);
+    commit_t parseTransportArc(rapidxml::xml_node<>* element);
+    void parseSingleTransportArc(rapidxml::xml_node<>* element, const fragment_ptr& owner);
     void parseValue(rapidxml::xml_node<>* element, std::string& text);
     uint32_t parseNumberConstant(rapidxml::xml_node<>* element);
     void parsePosition(rapidxml::xml_node<>* element, double& x, double& y);
@@ -88,9 +132,18 @@ private:
     VariableMap _variables;
     ColorTypeMap _place_types;
     std::unordered_map<std::string, uint32_t> constantValues;
-    std::map<std::pair<std::string,std::string>, rapidxml::xml_node<>*> _transportArcs;
+    // parsed time constraints by their text, dropped when a constant is declared
+    std::unordered_map<std::string, Colored::TimeInterval> _intervals;
+    std::unordered_map<std::string, Colored::TimeInvariant> _invariants;
+    std::mutex _constraint_lock;
+    // unmatched halves of transport arcs, streamed ones keep their fragment alive
+    std::map<std::pair<std::string,std::string>, std::pair<rapidxml::xml_node<>*, fragment_ptr>> _transportArcs;
+    // streaming only, arcs waiting for one of their endpoints to be declared
+    std::unordered_map<std::string, std::vector<std::pair<size_t, fragment_ptr>>> _deferred_arcs;
+    std::unordered_set<std::string> _transition_ids;
     std::unordered_set<std::string> _used_keywords;
     Colored::ScopeType _global_scope;
+    size_t _threads = 1;
 };
 }
 #endif // PNMLPARSER_H
@@ -25,6 +25,7 @@
 #include <memory>
 #include <sstream>
 #include <set>
+#include <functional>
 
 #include <rapidxml.hpp>
 
@@ -43,9 +44,24 @@ public:
 
     bool parse(std::istream& xml, const std::set<size_t>& );
 
+    // receives the properties in the order of the file, those which are not
+    // selected are left empty
+    typedef std::function<void(QueryItem&& item)> QueryHandler;
+
+    // reads the file without building a DOM of it. Properties which are not
+    // selected are skipped as they are read and every selected one is parsed
+    // on its own, so only the largest property is ever held in memory.
+    bool parse(std::istream& xml, const std::set<size_t>&, const QueryHandler& handler);
+
+    // number of threads used to parse the properties, the queries keep the
+    // order of the file
+    void setParseThreads(size_t threads) {
+        _threads = threads;
+    }
+
 private:
     bool parsePropertySet(rapidxml::xml_node<>* element, const std::set<size_t>&);
-    bool parseProperty(rapidxml::xml_node<>*  element);
+    bool parseProperty(rapidxml::xml_node<>*  element, QueryItem& queryItem);
     bool parseTags(rapidxml::xml_node<>*  element);
     Condition_ptr parseFormula(rapidxml::xml_node<>*  element);
     Condition_ptr parseBooleanFormula(rapidxml::xml_node<>*  element);
@@ -54,7 +70,11 @@ private:
     Condition_ptr parseSmcFormula(SMCSettings settings, rapidxml::xml_node<>* element);
     Expr_ptr parseIntegerExpression(rapidxml::xml_node<>*  element);
     std::string parsePlace(rapidxml::xml_node<>*  element);
-    void fatal_error(const std::string& token);
+    Expr_ptr parsePlaceIdentifier(rapidxml::xml_node<>*  element);
+    // aborts the parse, which then fails
+    [[noreturn]] void fatal_error(const std::string& token);
+
+    size_t _threads = 1;
 };
 
 #endif /* QUERYXMLPARSER_H */
@@ -0,0 +1,48 @@
+/*
+ * File:   XMLFragmentReader.h
+ *
+ * Reads an xml document from a stream without building a DOM. Elements
+ * selected by a policy are handed over as standalone xml text, such that
+ * they can be parsed on their own, everything else is discarded as it is read.
+ */
+
+#ifndef XMLFRAGMENTREADER_H
+#define XMLFRAGMENTREADER_H
+
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace unfoldtacpn {
+class XMLFragmentReader {
+public:
+    enum Action {
+        Descend,    // read the children of the element
+        Capture,    // hand the element and its children to the handler
+        Skip        // discard the element and its children
+    };
+
+    // decides what to do with an element, the root element has depth 0
+    typedef std::function<Action(const std::string& name, size_t depth)> Policy;
+    // receives a captured element as nul-terminated xml text
+    typedef std::function<void(const std::string& name, std::vector<char>&& text)> Handler;
+
+    XMLFragmentReader(std::istream& in, size_t window = 64*1024);
+
+    // returns false if the stream ends inside of markup
+    bool read(const Policy& policy, const Handler& handler);
+
+private:
+    int get();
+    bool readMarkup(std::string& token);
+    bool readUntil(std::string& token, const char* end);
+
+    std::istream& _in;
+    std::vector<char> _buffer;
+    size_t _pos = 0;
+    size_t _length = 0;
+};
+}
+
+#endif /* XMLFRAGMENTREADER_H */
@@ -8,6 +8,8 @@
 #ifndef ERRORCODES_H
 #define ERRORCODES_H
 
+#include <stdexcept>
+
 /** Enumeration of return values from VerifyPN */
 enum ReturnValue {
     SuccessCode = 0,
@@ -17,6 +19,13 @@ enum ReturnValue {
     ContinueCode = 4
 };
 
+/** Thrown instead of exiting with ErrorCode by code which may run on a worker
+ * thread, the thread which started the work prints it and exits */
+class FatalError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
 
 #endif /* ERRORCODES_H */
 
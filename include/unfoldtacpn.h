@@ -2,15 +2,36 @@
 #define LIBUNFOLDTACPN_H
 
 #include "PQL/PQL.h"
+#include "TAPNBuilderInterface.h"
 
 #include <vector>
 #include <set>
 
 namespace unfoldtacpn {
     class ColoredPetriNetBuilder;
+    namespace PQL {
+        class PlaceBounds;
+    }
     std::vector<std::pair<PQL::Condition_ptr,std::string>> parse_string_queries(const ColoredPetriNetBuilder& builder, std::istream& qfile);
     std::vector<std::pair<PQL::Condition_ptr, std::string>> parse_xml_queries(const ColoredPetriNetBuilder& builder,
-            std::istream& qfile, const std::set<size_t>& to_parse);
+            std::istream& qfile, const std::set<size_t>& to_parse, size_t threads = 1);
+
+    // the same, but without resolving place names, such that the queries can
+    // select what to unfold. Call analyze_queries once the net is unfolded.
+    // Properties are parsed and analyzed by up to threads threads, the
+    // queries are returned in the order of the query file.
+    std::vector<std::pair<PQL::Condition_ptr,std::string>> parse_string_queries(std::istream& qfile);
+    std::vector<std::pair<PQL::Condition_ptr, std::string>> parse_xml_queries(std::istream& qfile, const std::set<size_t>& to_parse, size_t threads = 1);
+    void analyze_queries(const ColoredPetriNetBuilder& builder, const std::vector<std::pair<PQL::Condition_ptr,std::string>>& queries, size_t threads = 1);
+
+    // unfolds the part of the net the queries depend on, or all of it if
+    // one of them is not a reachability property
+    void unfold_for_queries(ColoredPetriNetBuilder& cpnBuilder, TAPNBuilderInterface& builder,
+            const std::vector<std::pair<PQL::Condition_ptr,std::string>>& queries);
+
+    // replaces the analyzed queries by smaller equivalent ones, deciding
+    // comparisons from the bounds collected while unfolding the net
+    void simplify_queries(std::vector<std::pair<PQL::Condition_ptr,std::string>>& queries, const PQL::PlaceBounds& bounds);
 }
 
 #endif
@@ -0,0 +1,38 @@
+/*
+ * File:   Arena.cpp
+ */
+
+#include "Colored/Arena.h"
+
+#include <algorithm>
+#include <stdint.h>
+
+namespace unfoldtacpn {
+    namespace Colored {
+        Arena::Arena(size_t blockSize) : _blockSize(blockSize) {
+        }
+
+        Arena::~Arena() {
+            // objects may refer to each other, destroy them in reverse order of creation
+            for (auto it = _destructors.rbegin(); it != _destructors.rend(); ++it)
+                it->second(it->first);
+        }
+
+        void* Arena::allocate(size_t size, size_t align) {
+            auto aligned = [align](char* p) {
+                return (char*)(((uintptr_t)p + align - 1) & ~(uintptr_t)(align - 1));
+            };
+            char* mem = _next == nullptr ? nullptr : aligned(_next);
+            if (mem == nullptr || mem + size > _end) {
+                size_t length = std::max(_blockSize, size + align);
+                _blocks.emplace_back(new char[length]);
+                _next = _blocks.back().get();
+                _end = _next + length;
+                mem = aligned(_next);
+            }
+            _next = mem + size;
+            _allocated += size;
+            return mem;
+        }
+    }
+}
@@ -15,15 +15,18 @@
 
 namespace unfoldtacpn {
     ColoredPetriNetBuilder::ColoredPetriNetBuilder(std::stringstream *output_stream):
+    _arena(std::make_shared<Colored::Arena>()),
+    _expressions(std::make_shared<Colored::ExpressionInterner>(*_arena)),
     _output_stream(output_stream)
     {
     
     }
 
     ColoredPetriNetBuilder::ColoredPetriNetBuilder(const ColoredPetriNetBuilder& orig)
-    : _placenames(orig._placenames), _transitionnames(orig._transitionnames),
+    : _arena(orig._arena), _expressions(orig._expressions), _placenames(orig._placenames), _transitionnames(orig._transitionnames),
        _placelocations(orig._placelocations), _transitionlocations(orig._transitionlocations),
-       _transitions(orig._transitions), _places(orig._places)
+       _transitions(orig._transitions), _places(orig._places), _colors(orig._colors),
+       _constants(orig._constants), _bindings(orig._bindings), _keepBindings(orig._keepBindings), _parse_threads(orig._parse_threads), _output_stream(orig._output_stream)
     {
 
     }
@@ -33,9 +36,21 @@ namespace unfoldtacpn {
 
     void ColoredPetriNetBuilder::parseNet(std::istream& stream) {
         PNMLParser parser;
+        parser.setParseThreads(_parse_threads);
         parser.parse(stream, this);
     }
 
+    void ColoredPetriNetBuilder::parseNetFile(const std::string& path) {
+        PNMLParser parser;
+        parser.setParseThreads(_parse_threads);
+        parser.parseFile(path, this);
+    }
+
+    void ColoredPetriNetBuilder::parseNetStreaming(std::istream& stream) {
+        PNMLParser parser;
+        parser.parseStreaming(stream, this);
+    }
+
     void ColoredPetriNetBuilder::addPlace(const std::string &name,
                                           unfoldtacpn::Colored::Multiset &&tokens,
                                           const Colored::ColorType* type,
@@ -122,8 +137,8 @@ namespace unfoldtacpn {
         arc.expr = expr;
         if(arc.expr == nullptr)
         {
-            std::vector<Colored::ColorExpression_ptr> colors{std::make_shared<Colored::DotConstantExpression>()};
-            arc.expr = std::make_shared<Colored::NumberOfExpression>(
+            std::vector<Colored::ColorExpression_ptr> colors{_expressions->make<Colored::DotConstantExpression>()};
+            arc.expr = _expressions->make<Colored::NumberOfExpression>(
                                                 std::move(colors), weight);
         }
         arc.input = (&source) == (&place);
@@ -135,6 +150,7 @@ namespace unfoldtacpn {
             _places[p].inhibiting = true;
         } else {
             _transitions[t].arcs.emplace_back(std::move(arc));
+            _bindings.erase(t);
         }
     }
 
@@ -177,25 +193,55 @@ namespace unfoldtacpn {
 
         if(transportArc.in_expr == nullptr)
         {
-            std::vector<Colored::ColorExpression_ptr> colors{std::make_shared<Colored::DotConstantExpression>()};
-            transportArc.in_expr = std::make_shared<Colored::NumberOfExpression>(
+            std::vector<Colored::ColorExpression_ptr> colors{_expressions->make<Colored::DotConstantExpression>()};
+            transportArc.in_expr = _expressions->make<Colored::NumberOfExpression>(
                                                 std::move(colors), weight);
         }
         if(transportArc.out_expr == nullptr)
         {
-            std::vector<Colored::ColorExpression_ptr> colors{std::make_shared<Colored::DotConstantExpression>()};
-            transportArc.out_expr = std::make_shared<Colored::NumberOfExpression>(
+            std::vector<Colored::ColorExpression_ptr> colors{_expressions->make<Colored::DotConstantExpression>()};
+            transportArc.out_expr = _expressions->make<Colored::NumberOfExpression>(
                                                 std::move(colors), weight);
         }
         _transitions[t].transport.emplace_back(std::move(transportArc));
+        _bindings.erase(t);
     }
 
     void ColoredPetriNetBuilder::addColorType(const std::string& id, const Colored::ColorType* type) {
         _colors[id] = type;
+        _bindings.clear();
+    }
+
+    void ColoredPetriNetBuilder::addConstant(const std::string& name, uint32_t value) {
+        _constants[name] = value;
+    }
+
+    void ColoredPetriNetBuilder::setConstants(const std::unordered_map<std::string, uint32_t>& values) {
+        for (auto& [name, value] : values) {
+            auto it = _constants.find(name);
+            if (it == _constants.end()) {
+                std::cerr << "ERROR: Unknown constant " << name << std::endl;
+                std::exit(ErrorCode);
+            }
+            it->second = value;
+        }
+        _keepBindings = true;
+        for (auto& place : _places)
+            for (auto& invariant : place.invariants)
+                invariant.instantiate(_constants);
+        for (auto& transition : _transitions) {
+            for (auto& arc : transition.arcs)
+                for (auto& interval : arc.interval)
+                    interval.instantiate(_constants);
+            for (auto& arc : transition.transport)
+                for (auto& interval : arc.interval)
+                    interval.instantiate(_constants);
+        }
     }
 
     void ColoredPetriNetBuilder::unfold(TAPNBuilderInterface& builder) {
         clear();
+        findSumPlaces();
         auto start = std::chrono::high_resolution_clock::now();
         for (auto& place : _places) {
             unfoldPlace(builder, place);
@@ -218,6 +264,112 @@ namespace unfoldtacpn {
         _time = (std::chrono::duration_cast<std::chrono::microseconds>(end - start).count())*0.000001;
     }
 
+    void ColoredPetriNetBuilder::unfoldConeOfInfluence(TAPNBuilderInterface& builder, const std::unordered_set<std::string>& places) {
+        clear();
+        findSumPlaces();
+        auto start = std::chrono::high_resolution_clock::now();
+
+        // transitions which change the marking of a place
+        std::vector<std::vector<uint32_t>> changing(_places.size());
+        for (uint32_t t = 0; t < _transitions.size(); ++t) {
+            for (auto& arc : _transitions[t].arcs)
+                changing[arc.place].push_back(t);
+            for (auto& arc : _transitions[t].transport) {
+                changing[arc.source].push_back(t);
+                changing[arc.destination].push_back(t);
+            }
+        }
+
+        std::vector<bool> inPlaces(_places.size()), inTransitions(_transitions.size());
+        std::vector<uint32_t> waiting;
+        auto addPlace = [&](uint32_t p) {
+            if (!inPlaces[p]) {
+                inPlaces[p] = true;
+                waiting.push_back(p);
+            }
+        };
+        for (auto& name : places) {
+            auto it = _placenames.find(name);
+            if (it != _placenames.end())
+                addPlace(it->second);
+        }
+        // invariants and urgency stop time for the whole net
+        for (uint32_t p = 0; p < _places.size(); ++p)
+            for (auto& inv : _places[p].invariants)
+                if (inv.getBound() != std::numeric_limits<int>::max())
+                    addPlace(p);
+        auto addTransition = [&](uint32_t t) {
+            if (inTransitions[t])
+                return;
+            inTransitions[t] = true;
+            for (auto& arc : _transitions[t].arcs)
+                if (arc.input)
+                    addPlace(arc.place);
+            for (auto& arc : _transitions[t].transport)
+                addPlace(arc.source);
+            auto inhibitors = _inhibitorArcs.find(t);
+            if (inhibitors != _inhibitorArcs.end())
+                for (auto& arc : inhibitors->second)
+                    addPlace(arc.place);
+        };
+        for (uint32_t t = 0; t < _transitions.size(); ++t)
+            if (_transitions[t].urgent)
+                addTransition(t);
+        while (!waiting.empty()) {
+            auto p = waiting.back();
+            waiting.pop_back();
+            for (auto t : changing[p])
+                addTransition(t);
+        }
+
+        // places the kept transitions produce to are needed as well, their marking is irrelevant
+        std::vector<bool> emitted = inPlaces;
+        for (uint32_t t = 0; t < _transitions.size(); ++t) {
+            if (!inTransitions[t])
+                continue;
+            for (auto& arc : _transitions[t].arcs)
+                emitted[arc.place] = true;
+            for (auto& arc : _transitions[t].transport)
+                emitted[arc.destination] = true;
+        }
+
+        for (uint32_t p = 0; p < _places.size(); ++p)
+            if (emitted[p])
+                unfoldPlace(builder, _places[p]);
+
+        if (_output_stream) {
+            (*_output_stream) << "\nBINDINGS FOR EACH UNFOLDED TRANSITION\n";
+            (*_output_stream) << "<bindings>\n";
+        }
+
+        for (uint32_t t = 0; t < _transitions.size(); ++t)
+            if (inTransitions[t])
+                unfoldTransition(builder, _transitions[t]);
+
+        if (_output_stream) {
+            (*_output_stream) << "</bindings>\n";
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        _time = (std::chrono::duration_cast<std::chrono::microseconds>(end - start).count())*0.000001;
+    }
+
+    // A token of any color in a place inhibits a weight one inhibitor arc,
+    // which is said by one inhibitor arc on each unfolded place as well.
+    // Heavier inhibitors, and places with many colors, keep a place with
+    // the sum of the colors instead, which every arc on the place updates.
+    void ColoredPetriNetBuilder::findSumPlaces() {
+        const size_t maxInhibitedColors = 16;
+        _sumPlaces.assign(_places.size(), false);
+        for (auto& [transition, inhibitors] : _inhibitorArcs) {
+            for (auto& arc : inhibitors) {
+                auto* type = _places[arc.place].type;
+                if (type != nullptr && type->size() != 1 && (arc.weight > 1 || type->size() > maxInhibitedColors))
+                    _sumPlaces[arc.place] = true;
+            }
+        }
+    }
+
     void ColoredPetriNetBuilder::unfoldPlace(TAPNBuilderInterface& builder, const Colored::Place& place) {
         uint32_t index = _placenames[place.name];
         auto placePos = _placelocations[index];
@@ -230,16 +382,16 @@ namespace unfoldtacpn {
                 double x = std::get<0>(placePos);
                 double y = std::get<1>(placePos);
                 std::string name = place.name + "__" + std::to_string(i);
-                const Colored::Color* color = &place.type->operator[](i);
+                Colored::Color color = (*place.type)[i];
                 Colored::TimeInvariant invariant = getTimeInvariantForPlace(place.invariants, color); //TODO:: this does not take the correct time invariant
                 auto r = place.marking[color];
                 builder.addPlace(name, r, invariant.isBoundStrict(), invariant.getBound(), x, y + offset);
 
-                _ptplacenames[place.name][color->getId()] = std::move(name);
+                _ptplacenames[place.name][color.getId()] = std::move(name);
                 offset += 15;
             }
 
-            if(place.inhibiting)
+            if(_sumPlaces[index])
             {
                 double x = std::get<0>(placePos);
                 double y = std::get<1>(placePos);
@@ -251,40 +403,21 @@ namespace unfoldtacpn {
         else
         {
             _ptplacenames[place.name][0] = place.name;
-            const unfoldtacpn::Colored::Color* color = &(*place.type)[0];
+            Colored::Color color = (*place.type)[0];
             Colored::TimeInvariant invariant = getTimeInvariantForPlace(place.invariants, color);
             builder.addPlace(place.name, place.marking.size(), invariant.isBoundStrict(), invariant.getBound(),
                 std::get<0>(placePos), std::get<1>(placePos));
         }
     }
 
-    const Colored::TimeInvariant& ColoredPetriNetBuilder::getTimeInvariantForPlace(const std::vector< Colored::TimeInvariant>& time_invariants, const Colored::Color* color) const {
-        if(color != nullptr)
-        {
-            for (const Colored::TimeInvariant& element : time_invariants) {
-                if(element.getColor().getColorType() == Colored::StarColorType::starColorType())
-                {
-                    continue;
-                }
-                if (!element.getColor().isTuple()) {
-                    if (element.getColor().getId() == color->getId()) {
-                        return element;
-                    }
-                } else {
-                    bool matches = true;
-                    Colored::Color color = element.getColor();
-                    const auto& colors = color.getTuple();
-                    if (colors.size() == color.getTuple().size()) {
-                        for(uint32_t i = 0;i < colors.size(); i++) {
-                            if (colors[i]->getId() != color.getTuple()[i]->getId())
-                                matches = false;
-                        }
-                        if (matches)
-                        {
-                            return element;
-                        }
-                    }
-                }
+    const Colored::TimeInvariant& ColoredPetriNetBuilder::getTimeInvariantForPlace(const std::vector< Colored::TimeInvariant>& time_invariants, const Colored::Color& color) const {
+        for (const Colored::TimeInvariant& element : time_invariants) {
+            if(element.getColor().getColorType() == Colored::StarColorType::starColorType())
+            {
+                continue;
+            }
+            if (element.getColor().getId() == color.getId()) {
+                return element;
             }
         }
         for (uint32_t j = 0; j < time_invariants.size(); ++j) {
@@ -295,24 +428,58 @@ namespace unfoldtacpn {
         exit(ErrorCode);
     }
 
-    void ColoredPetriNetBuilder::unfoldTransition(TAPNBuilderInterface& builder, const Colored::Transition& transition) {
+    void ColoredPetriNetBuilder::forEachBinding(uint32_t transitionId,
+            const std::function<void(const std::string&, const Colored::ExpressionContext::BindingMap&)>& f) {
+        auto& transition = _transitions[transitionId];
+        // only bindings which are not all first colors are numbered
+        size_t i = 0;
+        auto name = [&](bool initial) {
+            return initial ? transition.name : transition.name + "__" + std::to_string(i++);
+        };
+        // the bindings do not depend on time constraints, so they survive new values of the constants
+        auto it = _bindings.find(transitionId);
+        if (it != _bindings.end()) {
+            auto& variables = it->second.variables;
+            auto color = it->second.colors.begin();
+            Colored::ExpressionContext::BindingMap binding;
+            for (size_t b = 0; b < it->second.count; ++b) {
+                bool initial = true;
+                for (auto* var : variables) {
+                    binding[var->name] = (*var->colorType)[*color];
+                    initial &= *color++ == 0;
+                }
+                f(name(initial), binding);
+            }
+            return;
+        }
         BindingGenerator gen(transition, _colors);
+        bindings_t* kept = nullptr;
+        if (_keepBindings) {
+            kept = &_bindings[transitionId];
+            kept->variables = gen.variables();
+        }
+        for (auto& b : gen) {
+            if (kept != nullptr) {
+                for (auto* var : kept->variables)
+                    kept->colors.push_back(b.at(var->name).getId());
+                ++kept->count;
+            }
+            f(name(gen.isInitial()), b);
+        }
+    }
+
+    void ColoredPetriNetBuilder::unfoldTransition(TAPNBuilderInterface& builder, const Colored::Transition& transition) {
         double offset = 0;
         uint32_t transitionId = _transitionnames[transition.name];
         auto transitionPos = _transitionlocations[transitionId];
-        size_t i = 0;
-        for (auto& b : gen) {
-           
-            std::string name = transition.name;
-            if(!gen.isInitial())
-                name += "__" + std::to_string(i++);
+        forEachBinding(transitionId, [&](const std::string& name, const Colored::ExpressionContext::BindingMap& b) {
 
             // Print bindings for each transition if output stream exists
             if (_output_stream) {     
                 (*_output_stream) << "   <transition id=\"" << name << "\">\n";    
                 for(auto const &var: b) {
                     (*_output_stream) << "      <variable id=\"" << var.first << "\">\n";
-                    (*_output_stream) << "         <color>" << var.second->getColorName() << "</color>\n";
+                    (*_output_stream) << "         <color>" << var.second.getColorName() << "</color>\n";
                     (*_output_stream) << "      </variable>\n";
                 }
                 (*_output_stream) << "   </transition>\n";
@@ -330,14 +497,22 @@ namespace unfoldtacpn {
             }
             unfoldInhibitorArc(builder, transitionId, name);
             offset += 15;
-        }
+        });
     }
 
     void ColoredPetriNetBuilder::unfoldInhibitorArc(TAPNBuilderInterface& builder, uint32_t transition, const std::string &newname) {
         for (auto& inhibitor : _inhibitorArcs[transition]) {
             auto& place = findSumName(inhibitor.place);
+            auto* type = _places[inhibitor.place].type;
+            auto unfolded = _ptplacenames.find(_places[inhibitor.place].name);
             if(place.size() != 0)
                 builder.addInputArc(place, newname, true, inhibitor.weight, false, true, 0, std::numeric_limits<int>::max());
+            else if(type != nullptr && type->size() != 1 && unfolded != std::end(_ptplacenames))
+            {
+                for (size_t i = 0; i < type->size(); ++i)
+                    builder.addInputArc(findPlaceName(inhibitor.place, (*type)[i]), newname, true, inhibitor.weight,
+                        false, true, 0, std::numeric_limits<int>::max());
+            }
             else
                 builder.addInputArc(_places[inhibitor.place].name, newname, true, inhibitor.weight, false, true, 0, std::numeric_limits<int>::max());
         }
@@ -351,7 +526,7 @@ namespace unfoldtacpn {
         const auto& out_color = *out_ms.begin();
         for(auto oc : in_ms)
         {
-            if(*oc.first != *in_color.first)
+            if(oc.first != in_color.first)
             {
                 std::cerr << "ERROR: Ill-formed transport-arc color" << std::endl;
                 std::exit(ErrorCode);
@@ -359,7 +534,7 @@ namespace unfoldtacpn {
         }
         for(auto oc : out_ms)
         {
-            if(*oc.first != *out_color.first)
+            if(oc.first != out_color.first)
             {
                 std::cerr << "ERROR: Ill-formed transport-arc color" << std::endl;
                 std::exit(ErrorCode);
@@ -388,7 +563,7 @@ namespace unfoldtacpn {
             }
             auto& out_sum = findSumName(arc.destination);
             if(out_sum.size() > 0)
-                builder.addOutputArc(out_sum, findSumName(arc.destination), out_color.second);
+                builder.addOutputArc(tName, out_sum, out_color.second);
         }
     }
 
@@ -402,14 +577,32 @@ namespace unfoldtacpn {
             return it->second;
     }
 
-    const std::string& ColoredPetriNetBuilder::findPlaceName(const std::string& place, const Colored::Color* color) const
+    std::vector<std::string> ColoredPetriNetBuilder::getPlaceColorNames(const std::string& place, uint32_t color) const
+    {
+        std::vector<std::string> names;
+        auto it = _placenames.find(place);
+        if (it == std::end(_placenames))
+            return names;
+        auto* type = _places[it->second].type;
+        if (type == nullptr || color >= type->size())
+            return names;
+        if (type->tupleSize() > 1) {
+            for (size_t i = 0; i < type->tupleSize(); ++i)
+                names.push_back(type->getTupleElement(color, i).getColorName());
+        } else {
+            names.push_back(type->getColorName(color));
+        }
+        return names;
+    }
+
+    const std::string& ColoredPetriNetBuilder::findPlaceName(const std::string& place, const Colored::Color& color) const
     {
         auto it = _ptplacenames.find(place);
         if(it == std::end(_ptplacenames))
             return place;
         else
         {
-            auto pit = it->second.find(color->getId());
+            auto pit = it->second.find(color.getId());
             if(pit == std::end(it->second))
             {
                 std::cerr << "ERROR: No match on id of color for place " << place << std::endl;
@@ -430,7 +623,7 @@ namespace unfoldtacpn {
                 continue;
             }
             sumWeight += color.second;
-            is_singular &= color.first->getColorType()->size() == 1;
+            is_singular &= color.first.getColorType()->size() == 1;
             auto& pName = findPlaceName(arc.place, color.first);
             if (!arc.input) {
                 builder.addOutputArc(tName, pName, color.second);
@@ -460,26 +653,12 @@ namespace unfoldtacpn {
     }
 
     const Colored::TimeInterval& ColoredPetriNetBuilder::getTimeIntervalForArc(const std::vector< Colored::TimeInterval>& timeIntervals,
-        const Colored::Color* color) const {
+        const Colored::Color& color) const {
         for (const auto& element : timeIntervals) {
             if(element.getColor().getColorType() == Colored::StarColorType::starColorType())
                 continue;
-            if (!element.getColor().isTuple()) {
-                if (element.getColor().getId() == color->getId()) {
-                    return element;
-                }
-            } else {
-                bool matches = true;
-                std::vector<const Colored::Color*> colors = element.getColor().getTuple();
-
-                if (colors.size() == color->getTuple().size()) {
-                    for(uint32_t i = 0; i < colors.size(); i++) {
-                        if (colors[i]->getId() != color->getTuple()[i]->getId())
-                            matches = false;
-                    }
-                    if (matches)
-                        return element;
-                }
+            if (element.getColor().getId() == color.getId()) {
+                return element;
             }
         }
         for (uint32_t j = 0; j < timeIntervals.size(); ++j) { // If there is no timeinterval for the specific color, we use the default * interval
@@ -545,7 +724,8 @@ namespace unfoldtacpn {
             arc.out_expr->getVariables(variables);
         }
         for (auto& var : variables) {
-            _bindings[var->name] = &var->colorType->operator[](0);
+            _bindings[var->name] = (*var->colorType)[0];
+            _variables.push_back(var);
         }
 
         if (!eval())
@@ -565,8 +745,8 @@ namespace unfoldtacpn {
         bool test = false;
         while (!test) {
             for (auto& _binding : _bindings) {
-                _binding.second = &_binding.second->operator++();
-                if (_binding.second->getId() != 0) {
+                _binding.second = ++_binding.second;
+                if (_binding.second.getId() != 0) {
                     break;
                 }
             }
@@ -585,7 +765,7 @@ namespace unfoldtacpn {
 
     bool BindingGenerator::isInitial() const {
         for (auto& b : _bindings) {
-            if (b.second->getId() != 0) return false;
+            if (b.second.getId() != 0) return false;
         }
         return true;
     }
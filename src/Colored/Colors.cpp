@@ -10,26 +10,8 @@
 #include <string>
 #include <iostream>
 #include <algorithm>
-#include <iterator>
 #include <cassert>
-
-//@{
-// From: https://stackoverflow.com/a/236803
-template<typename Out>
-void split(const std::string &s, char delim, Out result) {
-    std::stringstream ss(s);
-    std::string item;
-    while (std::getline(ss, item, delim)) {
-        *(result++) = item;
-    }
-}
-
-std::vector<std::string> split(const std::string &s, char delim) {
-    std::vector<std::string> elems;
-    split(s, delim, std::back_inserter(elems));
-    return elems;
-}
-//}@
+#include <cerrno>
 
 namespace unfoldtacpn {
     namespace Colored {
@@ -38,103 +20,91 @@ namespace unfoldtacpn {
             return stream;
         }
 
-        Color::Color() {
-            _id = 0;
-            _colorName = "*";
-            _colorType = StarColorType::starColorType();
+        Color::Color()
+                : _colorType(StarColorType::starColorType()), _id(0)
+        {
         }
 
-        Color::Color(const ColorType* colorType, uint32_t id, const std::vector<const Color*>& colors)
-                : _tuple(colors), _colorType(colorType), _colorName(""), _id(id)
+        Color::Color(const ColorType* colorType, uint32_t id)
+                : _colorType(colorType), _id(id)
         {
             if (colorType != nullptr)
-                assert(id <= colorType->size());
+                assert(id < colorType->size());
         }
 
-        Color::Color(const ColorType* colorType, uint32_t id, const char* color)
-                : _tuple(), _colorType(colorType), _colorName(color), _id(id)
-        {
-            if (colorType != nullptr)
-                assert(id <= colorType->size());
+        bool Color::isTuple() const {
+            return _colorType->tupleSize() > 1;
+        }
+
+        std::vector<Color> Color::getTuple() const {
+            std::vector<Color> colors;
+            if (isTuple()) {
+                colors.reserve(_colorType->tupleSize());
+                for (size_t i = 0; i < _colorType->tupleSize(); ++i)
+                    colors.push_back(_colorType->getTupleElement(_id, i));
+            }
+            return colors;
         }
 
+        std::string Color::getColorName() const {
+            if (isTuple()) {
+                throw "Cannot get color from a tuple color.";
+            }
+            return _colorType->getColorName(_id);
+        }
 
-        const Color* Color::operator[] (size_t index) const {
+        Color Color::operator[] (size_t index) const {
             if (!this->isTuple()) {
                 throw "Cannot access tuple if not a tuple color";
             }
-            return _tuple[index];
+            return _colorType->getTupleElement(_id, index);
         }
 
         bool Color::operator< (const Color& other) const {
-            if (_colorType == other._colorType) {
+            if (_colorType != other._colorType)
                 throw "Cannot compare colors from different types";
-            }
             return _id < other._id;
         }
 
         bool Color::operator> (const Color& other) const {
-            if (_colorType == other._colorType) {
-                throw "Cannot compare colors from different types";
-            }
-            return _id > other._id;
+            return other < *this;
         }
 
         bool Color::operator<= (const Color& other) const {
-            if (_colorType == other._colorType) {
-                throw "Cannot compare colors from different types";
-            }
-            return _id <= other._id;
+            return !(other < *this);
         }
 
         bool Color::operator>= (const Color& other) const {
-            if (_colorType == other._colorType) {
-                throw "Cannot compare colors from different types";
-            }
-            return _id >= other._id;
+            return !(*this < other);
         }
 
-        const Color& Color::operator++ () const {
-            if (_id >= _colorType->size() - 1) {
-                return (*_colorType)[0];
-            }
-            assert(_id + 1 < _colorType->size());
-            return (*_colorType)[_id + 1];
+        Color Color::operator++ () const {
+            auto size = _colorType->size();
+            return Color(_colorType, _id + 1 >= size ? 0 : _id + 1);
         }
 
-        const Color& Color::operator-- () const {
-            if (_id <= 0) {
-                return (*_colorType)[_colorType->size() - 1];
-            }
-            assert(_id - 1 >= 0);
-            return (*_colorType)[_id - 1];
+        Color Color::operator-- () const {
+            return Color(_colorType, _id == 0 ? _colorType->size() - 1 : _id - 1);
         }
 
         std::string Color::toString() const {
-            return toString(this);
+            return toString(*this);
         }
 
-        std::string Color::toString(const Color* color) {
-            if (color->isTuple()) {
-                std::ostringstream oss;
-                oss << "(";
-                for (size_t i = 0; i < color->_tuple.size(); i++) {
-                    oss << color->_tuple[i]->toString();
-                    if (i < color->_tuple.size() - 1) oss << ",";
-                }
-                oss << ")";
-                return oss.str();
+        std::string Color::toString(const Color& color) {
+            if (color.isTuple()) {
+                return toString(color.getTuple());
             }
-            return std::string(color->_colorName);
+            return color.getColorName();
         }
 
-        std::string Color::toString(const std::vector<const Color*>& colors) {
+        std::string Color::toString(const std::vector<Color>& colors) {
             std::ostringstream oss;
             if (colors.size() > 1)
                 oss << "(";
 
             for (size_t i = 0; i < colors.size(); i++) {
-                oss << colors[i]->toString();
+                oss << colors[i].toString();
                 if (i < colors.size() - 1) oss << ",";
             }
 
@@ -144,112 +114,181 @@ namespace unfoldtacpn {
         }
 
 
-        const Color* Color::dotConstant() {
-            static ColorType* _instance = nullptr;
-            if(_instance == nullptr){
-                _instance = new ColorType("dot");
-                _instance->addColor("dot");
-            }
-            return &(*_instance)[0];
+        // the values of two colors of int ranges, which may be different ranges
+        static bool rangeValues(const Color& a, const Color& b, int64_t& va, int64_t& vb) {
+            auto* at = a.getColorType();
+            auto* bt = b.getColorType();
+            if (at == nullptr || bt == nullptr || !at->isIntRange() || !bt->isIntRange())
+                return false;
+            va = static_cast<const FiniteIntRangeType*>(at)->valueOf(a.getId());
+            vb = static_cast<const FiniteIntRangeType*>(bt)->valueOf(b.getId());
+            return true;
+        }
+
+        bool Color::equalValues(const Color& a, const Color& b) {
+            if (a.getColorType() == b.getColorType())
+                return a.getId() == b.getId();
+            int64_t va, vb;
+            return rangeValues(a, b, va, vb) && va == vb;
+        }
+
+        bool Color::lessValue(const Color& a, const Color& b) {
+            if (a.getColorType() == b.getColorType())
+                return a.getId() < b.getId();
+            int64_t va, vb;
+            if (rangeValues(a, b, va, vb))
+                return va < vb;
+            throw "Cannot compare colors from different types";
+        }
+
+        Color Color::dotConstant() {
+            static ColorType* _instance = [] {
+                auto* type = new ColorType("dot");
+                type->addColor("dot");
+                return type;
+            }();
+            return (*_instance)[0];
         }
 
         StarColorType::StarColorType() : ColorType("*") {
 
         }
 
+        std::string StarColorType::getColorName(uint32_t id) const {
+            return "*";
+        }
+
         void ColorType::addColor(const char* colorName) {
-            auto nid = _colors.size();
-            _colors.emplace_back(this, nid, colorName);
-            for(size_t i = 0; i < _colors.size(); ++i)
-                assert(i == _colors[i].getId());
+            uint32_t nid = _names.size();
+            _names.emplace_back(colorName);
+            _index.emplace(colorName, nid);
+        }
+
+        void ColorType::addColor(const std::vector<Color>& colors) {
+            uint32_t nid = _names.size();
+            _names.emplace_back(Color::toString(colors));
+            _index.emplace(_names.back(), nid);
+        }
+
+        std::optional<Color> ColorType::findColor(const std::string& name) const {
+            auto it = _index.find(name);
+            if (it == _index.end())
+                return std::nullopt;
+            return (*this)[it->second];
         }
 
-        void ColorType::addColor(std::vector<const Color*>& colors) {
-            auto nid = _colors.size();
-            _colors.emplace_back(this, nid, colors);
-            for(size_t i = 0; i < _colors.size(); ++i)
-                assert(i == _colors[i].getId());
+        Color ColorType::operator[] (const char* index) const {
+            if (auto c = findColor(index))
+                return *c;
+            throw FatalError(std::string("ERROR: Couldn't find color '") + index + "'");
         }
 
-        const Color& ColorType::operator[] (const char* index) const {
-            for (size_t i = 0; i < _colors.size(); i++) {
-                if (strcmp(operator[](i).toString().c_str(), index) == 0)
-                    return operator[](i);
+        void ScopeType::addType(const ColorType* type)
+        {
+            if (!_constituents.insert(type).second)
+                return;
+            if (type->isIntRange()) {
+                _ranges.push_back(type);
+                return;
+            }
+            // tuples cannot be referenced by name from the scope
+            if (dynamic_cast<const ProductType*>(type) != nullptr)
+                return;
+            for (auto c : *type)
+            {
+                if (c.isTuple()) continue;
+                _names.emplace(c.getColorName(), c);
             }
-            std::cerr << "ERROR: Couldn't find color '" << index << "'";
-            std::exit(ErrorCode);
         }
 
-        const Color& ScopeType::operator[] (const char* index) const
+        std::optional<Color> ScopeType::findColor(const std::string& name) const
         {
-            for(auto& type : _constituents)
+            auto it = _names.find(name);
+            if (it != _names.end())
+                return it->second;
+            for (auto* type : _ranges)
             {
-                for(auto& c: *type)
-                {
-                    if(c.isTuple()) continue;
-                    if(c.getColorName() == index)
-                        return c;
-                }
+                if (auto c = type->findColor(name))
+                    return c;
             }
-            std::cerr << "ERROR: Couldn't find color '" << index << "'";
-            std::exit(ErrorCode);
+            return std::nullopt;
         }
 
-        const Color& ProductType::operator[](size_t index) const {
-            if (cache.count(index) < 1) {
-                size_t mod = 1;
-                size_t div = 1;
+        std::optional<Color> FiniteIntRangeType::findColor(const std::string& name) const {
+            char* end = nullptr;
+            errno = 0;
+            auto value = strtoll(name.c_str(), &end, 10);
+            if (end == name.c_str() || *end != '\0' || errno != 0)
+                return std::nullopt;
+            if (value < (int64_t)_start || value > (int64_t)_end)
+                return std::nullopt;
+            return (*this)[(size_t)(value - _start)];
+        }
 
-                std::vector<const Color*> colors;
-                for (auto & constituent : constituents) {
-                    mod = constituents.size();
-                    colors.push_back(&(*constituent)[(index / div) % mod]);
-                    div *= mod;
-                }
+        std::string FiniteIntRangeType::getColorName(uint32_t id) const {
+            assert(id < _size);
+            return std::to_string(valueOf(id));
+        }
 
-                cache.emplace(index, Color(this, index, colors));
-            }
+        Color ProductType::getTupleElement(uint32_t id, size_t index) const {
+            // inverse of getColor, the first constituent is the least significant
+            size_t div = 1;
+            for (size_t i = 0; i < index; ++i)
+                div *= constituents[i]->size();
+            auto* type = constituents[index];
+            return (*type)[(id / div) % type->size()];
+        }
 
-            return cache.at(index);
+        std::string ProductType::getColorName(uint32_t id) const {
+            if (constituents.size() != 1)
+                throw "Cannot get color from a tuple color.";
+            return getTupleElement(id, 0).getColorName();
         }
 
-        const Color* ProductType::getColor(const std::vector<const Color*>& colors) const {
+        std::optional<Color> ProductType::getColor(const std::vector<Color>& colors) const {
             size_t product = 1;
             size_t sum = 0;
 
-            if (constituents.size() != colors.size()) return nullptr;
+            if (constituents.size() != colors.size()) return std::nullopt;
 
             for (size_t i = 0; i < constituents.size(); ++i) {
-                if (!(*colors[i]->getColorType() == *constituents[i]))
-                    return nullptr;
+                if (!(*colors[i].getColorType() == *constituents[i]))
+                    return std::nullopt;
 
-                sum += product * colors[i]->getId();
+                sum += product * colors[i].getId();
                 product *= constituents[i]->size();
             }
-            return &operator[](sum);
-        }
-
-        const Color& ProductType::operator[](const char* index) const {
-            return operator[](std::string(index));
+            return (*this)[sum];
         }
 
-        const Color& ProductType::operator[](const std::string& index) const {
-            std::string str(index.empty() || index[0] != '(' ? index : index.substr(1, index.size() - 2));
-            std::vector<std::string> parts = split(str, ',');
-
-            if (parts.size() != constituents.size()) {
-                std::cerr << "ERROR: Zero color constituents" << std::endl;
-                std::exit(ErrorCode);
+        std::optional<Color> ProductType::findColor(const std::string& name) const {
+            size_t begin = 0;
+            size_t end = name.size();
+            if (!name.empty() && name[0] == '(') {
+                ++begin;
+                --end;
             }
 
             size_t sum = 0;
             size_t mult = 1;
-            for (size_t i = 0; i < parts.size(); ++i) {
-                sum += mult * (*constituents[i])[parts[i]].getId();
+            std::string part;
+            for (size_t i = 0; i < constituents.size(); ++i) {
+                if (begin > end)
+                    return std::nullopt;
+                auto next = name.find(',', begin);
+                if (next == std::string::npos || next > end)
+                    next = end;
+                part.assign(name, begin, next - begin);
+                auto c = constituents[i]->findColor(part);
+                if (!c)
+                    return std::nullopt;
+                sum += mult * c->getId();
                 mult *= constituents[i]->size();
+                begin = next + 1;
             }
-
-            return operator[](sum);
+            if (begin <= end)
+                return std::nullopt;
+            return (*this)[sum];
         }
 
     }
@@ -1,15 +1,16 @@
 
 #include "Colored/Expressions.h"
+#include "Colored/ExpressionVisitor.h"
 #include "errorcodes.h"
 
 
 namespace unfoldtacpn {
 namespace Colored {
-    const Color* ExpressionContext::findColor(const std::string& color) const {
+    Color ExpressionContext::findColor(const std::string& color) const {
         if (color.compare("dot") == 0)
            return Color::dotConstant();
        for (auto& elem : colorTypes) {
-           return &(*elem.second)[color];
+           return (*elem.second)[color];
        }
        printf("Could not find color: %s\nCANNOT_COMPUTE\n", color.c_str());
        exit(ErrorCode);
@@ -24,5 +25,93 @@ namespace Colored {
         }
         return nullptr;
     }
+
+    void DotConstantExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void VariableExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void UserOperatorExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void UserSortExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void NumberConstantExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void SuccessorExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void PredecessorExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void TupleExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void LessThanExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void GreaterThanExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void LessThanEqExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void GreaterThanEqExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void EqualityExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void InequalityExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void NotExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void AndExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void OrExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void AllExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void NumberOfExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void AddExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void SubtractExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+
+    void ScalarProductExpression::visit(ExpressionVisitor& visitor) const {
+        visitor.accept<decltype(this)>(this);
+    }
+}
 }
-}
\ No newline at end of file
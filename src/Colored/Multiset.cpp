@@ -28,17 +28,17 @@ namespace unfoldtacpn {
             type = orig.type;
         }
 
-        Multiset::Multiset(const Color* color, uint32_t count)
+        Multiset::Multiset(const Color& color, uint32_t count)
         : _set(), type(nullptr) {
             (*this)[color] = count;
         }
 
-        Multiset::Multiset(const std::pair<const Color*,uint32_t> el)
+        Multiset::Multiset(const std::pair<Color,uint32_t> el)
         : _set(), type(nullptr) {
             (*this)[el.first] = el.second;
         }
 
-        Multiset::Multiset(const std::vector<std::pair<const Color*,uint32_t>>& colors)
+        Multiset::Multiset(const std::vector<std::pair<Color,uint32_t>>& colors)
                 : _set(), type(nullptr)
         {
             for (auto& c : colors) {
@@ -74,9 +74,7 @@ namespace unfoldtacpn {
                 throw "You cannot add Multisets over different sets";
             }
             for (auto c : other._set) {
-                const Color* color = Color::dotConstant();
-                if (type != nullptr)
-                    color = &((*type)[c.first]);
+                Color color = type != nullptr ? (*type)[c.first] : Color::dotConstant();
                 (*this)[color] += c.second;
             }
         }
@@ -89,9 +87,7 @@ namespace unfoldtacpn {
                 throw "You cannot add Multisets over different sets";
             }
             for (auto c : _set) {
-                const Color* color = Color::dotConstant();
-                if (type != nullptr)
-                    color = &((*type)[c.first]);
+                Color color = type != nullptr ? (*type)[c.first] : Color::dotConstant();
                 (*this)[color] = std::min(c.second - other[color], c.second);
             }
         }
@@ -102,10 +98,10 @@ namespace unfoldtacpn {
             }
         }
 
-        uint32_t Multiset::operator [](const Color* color) const {
-            if (type != nullptr && type->getId() == color->getColorType()->getId()) {
+        uint32_t Multiset::operator [](const Color& color) const {
+            if (type != nullptr && type->getId() == color.getColorType()->getId()) {
                 for (auto c : _set) {
-                    if (c.first == color->getId())
+                    if (c.first == color.getId())
                         return c.second;
                 }
             }
@@ -113,19 +109,19 @@ namespace unfoldtacpn {
             return 0;
         }
 
-        uint32_t& Multiset::operator [](const Color* color) {
+        uint32_t& Multiset::operator [](const Color& color) {
             if (type == nullptr) {
-                type = color->getColorType();
+                type = color.getColorType();
             }
-            if (color->getColorType() != nullptr && type->getId() != color->getColorType()->getId()) {
+            if (color.getColorType() != nullptr && type->getId() != color.getColorType()->getId()) {
                 throw "You cannot access a Multiset with a color from a different color type";
             }
             for (auto & i : _set) {
-                if (i.first == color->getId())
+                if (i.first == color.getId())
                     return i.second;
             }
 
-            _set.emplace_back(color->getId(), 0);
+            _set.emplace_back(color.getId(), 0);
             return _set.back().second;
         }
 
@@ -165,17 +161,15 @@ namespace unfoldtacpn {
             return *this;
         }
 
-        std::pair<const Color *, uint32_t> Multiset::Iterator::operator++(int) {
+        std::pair<Color, uint32_t> Multiset::Iterator::operator++(int) {
             auto old = **this;
             ++index;
             return old;
         }
 
-        std::pair<const Color *, uint32_t> Multiset::Iterator::operator*() {
+        std::pair<Color, uint32_t> Multiset::Iterator::operator*() {
             auto& item = ms->_set[index];
-            const Color* color = Color::dotConstant();
-            if (ms->type != nullptr)
-                color = &(*ms->type)[item.first];
+            Color color = ms->type != nullptr ? (*ms->type)[item.first] : Color::dotConstant();
             return {color, uint32_t{item.second}};
         }
 
@@ -0,0 +1,812 @@
+/*
+ * File:   Snapshot.cpp
+ *
+ * Binary image of a parsed colored net. Types, variables and expressions
+ * are numbered in the order they are written, the net refers to them by
+ * number. Integers are stored in host byte order, a snapshot is only meant
+ * to be read back on the machine that wrote it.
+ */
+
+#include "Colored/ColoredPetriNetBuilder.h"
+#include "Colored/ExpressionInterner.h"
+#include "Colored/ExpressionVisitor.h"
+
+#include <cstring>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <type_traits>
+
+namespace unfoldtacpn {
+    namespace {
+        using namespace Colored;
+
+        const char MAGIC[8] = {'T', 'A', 'C', 'P', 'N', 'S', 'N', '2'};
+        const uint32_t BYTE_ORDER_MARK = 0x01020304;
+        const uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+        enum TypeKind : uint8_t {
+            PlainKind, ProductKind, RangeKind, DotKind, StarKind
+        };
+
+        enum ExpressionKind : uint8_t {
+            DotConstant, VariableRef, UserOperator, UserSort, NumberConstant,
+            Successor, Predecessor, Tuple,
+            LessThan, GreaterThan, LessThanEq, GreaterThanEq, Equality, Inequality,
+            Not, And, Or,
+            All, NumberOf, Add, Subtract, ScalarProduct
+        };
+
+        struct SnapshotError {};
+
+        class Encoder {
+        public:
+            std::string data;
+
+            template<typename T>
+            void put(T value) {
+                static_assert(std::is_trivially_copyable<T>::value, "only plain values can be written");
+                data.append((const char*)&value, sizeof(T));
+            }
+
+            void put(const std::string& value) {
+                put<uint32_t>(value.size());
+                data.append(value);
+            }
+        };
+
+        class Decoder {
+        public:
+            Decoder(const std::string& data) : _pos(data.data()), _end(data.data() + data.size()) {}
+
+            template<typename T>
+            T get() {
+                if ((size_t)(_end - _pos) < sizeof(T))
+                    throw SnapshotError();
+                T value;
+                memcpy(&value, _pos, sizeof(T));
+                _pos += sizeof(T);
+                return value;
+            }
+
+            std::string getString() {
+                auto size = get<uint32_t>();
+                if ((size_t)(_end - _pos) < size)
+                    throw SnapshotError();
+                std::string value(_pos, size);
+                _pos += size;
+                return value;
+            }
+
+            bool done() const {
+                return _pos == _end;
+            }
+
+        private:
+            const char* _pos;
+            const char* _end;
+        };
+
+        class SnapshotWriter : public ExpressionVisitor {
+        public:
+            Encoder types, variables, expressions, net;
+
+            uint32_t type(const ColorType* type) {
+                if (type == nullptr)
+                    return NONE;
+                auto it = _types.find(type);
+                if (it != _types.end())
+                    return it->second;
+                if (auto* range = dynamic_cast<const FiniteIntRangeType*>(type)) {
+                    types.put(RangeKind);
+                    types.put(type->getName());
+                    types.put(range->lowerBound());
+                    types.put(range->upperBound());
+                } else if (auto* product = dynamic_cast<const ProductType*>(type)) {
+                    // constituents are written first
+                    std::vector<uint32_t> constituents;
+                    for (size_t i = 0; i < product->tupleSize(); ++i)
+                        constituents.push_back(this->type(product->getType(i)));
+                    types.put(ProductKind);
+                    types.put(type->getName());
+                    types.put<uint32_t>(constituents.size());
+                    for (auto c : constituents)
+                        types.put(c);
+                } else if (type == Color::dotConstant().getColorType()) {
+                    types.put(DotKind);
+                } else if (type == StarColorType::starColorType()) {
+                    types.put(StarKind);
+                } else if (dynamic_cast<const ScopeType*>(type)) {
+                    throw "Cannot write a scope type to a snapshot";
+                } else {
+                    types.put(PlainKind);
+                    types.put(type->getName());
+                    types.put<uint32_t>(type->size());
+                    for (uint32_t i = 0; i < type->size(); ++i)
+                        types.put(type->getColorName(i));
+                }
+                uint32_t id = _types.size();
+                _types.emplace(type, id);
+                return id;
+            }
+
+            uint32_t variable(const Variable* variable) {
+                auto it = _variables.find(variable);
+                if (it != _variables.end())
+                    return it->second;
+                auto t = type(variable->colorType);
+                variables.put(variable->name);
+                variables.put(t);
+                uint32_t id = _variables.size();
+                _variables.emplace(variable, id);
+                return id;
+            }
+
+            void color(Encoder& out, const Color& color) {
+                out.put(type(color.getColorType()));
+                out.put(color.getId());
+            }
+
+            uint32_t expression(const Expression* expr) {
+                if (expr == nullptr)
+                    return NONE;
+                if (expr->id() == NONE)
+                    throw "Cannot write an expression which is not interned to a snapshot";
+                return expr->id();
+            }
+
+            void interval(const TimeInterval& interval) {
+                net.put<uint8_t>(interval.isLowerBoundStrict());
+                net.put(interval.getLowerBound());
+                net.put(interval.getUpperBound());
+                net.put<uint8_t>(interval.isUpperBoundStrict());
+                color(net, interval.getColor());
+                net.put(interval.getLowerConstant());
+                net.put(interval.getUpperConstant());
+            }
+
+            void intervals(const std::vector<TimeInterval>& intervals) {
+                net.put<uint32_t>(intervals.size());
+                for (auto& i : intervals)
+                    interval(i);
+            }
+
+            void arc(const Arc& arc) {
+                net.put(arc.place);
+                net.put(arc.transition);
+                net.put(expression(arc.expr));
+                net.put<uint8_t>(arc.input);
+                net.put<uint8_t>(arc.inhibitor);
+                net.put<int32_t>(arc.weight);
+                intervals(arc.interval);
+            }
+
+        protected:
+            void binary(ExpressionKind kind, const Expression* left, const Expression* right) {
+                auto l = expression(left), r = expression(right);
+                expressions.put(kind);
+                expressions.put(l);
+                expressions.put(r);
+            }
+
+            void list(const std::vector<const ColorExpression*>& elements) {
+                expressions.put<uint32_t>(elements.size());
+                for (auto* e : elements)
+                    expressions.put(expression(e));
+            }
+
+            void _accept(const DotConstantExpression*) override {
+                expressions.put(DotConstant);
+            }
+
+            void _accept(const VariableExpression* element) override {
+                auto v = variable(element->variable());
+                expressions.put(VariableRef);
+                expressions.put(v);
+            }
+
+            void _accept(const UserOperatorExpression* element) override {
+                expressions.put(UserOperator);
+                color(expressions, element->userOperator());
+            }
+
+            void _accept(const UserSortExpression* element) override {
+                auto t = type(element->userSort());
+                expressions.put(UserSort);
+                expressions.put(t);
+            }
+
+            void _accept(const NumberConstantExpression* element) override {
+                expressions.put(NumberConstant);
+                expressions.put(element->number());
+            }
+
+            void _accept(const SuccessorExpression* element) override {
+                expressions.put(Successor);
+                expressions.put(expression(element->color()));
+            }
+
+            void _accept(const PredecessorExpression* element) override {
+                expressions.put(Predecessor);
+                expressions.put(expression(element->color()));
+            }
+
+            void _accept(const TupleExpression* element) override {
+                auto t = type(element->getColorType());
+                expressions.put(Tuple);
+                expressions.put(t);
+                list(element->colors());
+            }
+
+            void _accept(const LessThanExpression* element) override {
+                binary(LessThan, element->left(), element->right());
+            }
+
+            void _accept(const GreaterThanExpression* element) override {
+                binary(GreaterThan, element->left(), element->right());
+            }
+
+            void _accept(const LessThanEqExpression* element) override {
+                binary(LessThanEq, element->left(), element->right());
+            }
+
+            void _accept(const GreaterThanEqExpression* element) override {
+                binary(GreaterThanEq, element->left(), element->right());
+            }
+
+            void _accept(const EqualityExpression* element) override {
+                binary(Equality, element->left(), element->right());
+            }
+
+            void _accept(const InequalityExpression* element) override {
+                binary(Inequality, element->left(), element->right());
+            }
+
+            void _accept(const NotExpression* element) override {
+                expressions.put(Not);
+                expressions.put(expression(element->expr()));
+            }
+
+            void _accept(const AndExpression* element) override {
+                binary(And, element->left(), element->right());
+            }
+
+            void _accept(const OrExpression* element) override {
+                binary(Or, element->left(), element->right());
+            }
+
+            void _accept(const AllExpression* element) override {
+                auto t = type(element->sort());
+                expressions.put(All);
+                expressions.put(t);
+            }
+
+            void _accept(const NumberOfExpression* element) override {
+                expressions.put(NumberOf);
+                expressions.put(element->number());
+                expressions.put(expression(element->all()));
+                list(element->colors());
+            }
+
+            void _accept(const AddExpression* element) override {
+                expressions.put(Add);
+                expressions.put<uint32_t>(element->constituents().size());
+                for (auto* e : element->constituents())
+                    expressions.put(expression(e));
+            }
+
+            void _accept(const SubtractExpression* element) override {
+                binary(Subtract, element->left(), element->right());
+            }
+
+            void _accept(const ScalarProductExpression* element) override {
+                expressions.put(ScalarProduct);
+                expressions.put(element->scalar());
+                expressions.put(expression(element->expr()));
+            }
+
+        public:
+            uint32_t typeCount() const {
+                return _types.size();
+            }
+
+            uint32_t variableCount() const {
+                return _variables.size();
+            }
+
+        private:
+            std::unordered_map<const ColorType*, uint32_t> _types;
+            std::unordered_map<const Variable*, uint32_t> _variables;
+        };
+
+        class SnapshotReader {
+        public:
+            SnapshotReader(const std::string& data, Arena& arena, ExpressionInterner& interner)
+            : in(data), _arena(arena), _interner(interner) {}
+
+            Decoder in;
+
+            void readTypes() {
+                auto n = in.get<uint32_t>();
+                for (uint32_t i = 0; i < n; ++i) {
+                    switch (in.get<uint8_t>()) {
+                        case PlainKind: {
+                            auto* t = _arena.make<ColorType>(in.getString());
+                            auto colors = in.get<uint32_t>();
+                            for (uint32_t c = 0; c < colors; ++c)
+                                t->addColor(in.getString().c_str());
+                            _types.push_back(t);
+                            break;
+                        }
+                        case ProductKind: {
+                            auto* t = _arena.make<ProductType>(in.getString());
+                            auto constituents = in.get<uint32_t>();
+                            for (uint32_t c = 0; c < constituents; ++c)
+                                t->addType(type());
+                            _types.push_back(t);
+                            break;
+                        }
+                        case RangeKind: {
+                            auto name = in.getString();
+                            auto start = in.get<uint32_t>();
+                            auto end = in.get<uint32_t>();
+                            _types.push_back(_arena.make<FiniteIntRangeType>(name, start, end));
+                            break;
+                        }
+                        case DotKind:
+                            _types.push_back(Color::dotConstant().getColorType());
+                            break;
+                        case StarKind:
+                            _types.push_back(StarColorType::starColorType());
+                            break;
+                        default:
+                            throw SnapshotError();
+                    }
+                }
+            }
+
+            void readVariables() {
+                // kept in one block, such that they have the same relative order in memory as when written
+                auto n = in.get<uint32_t>();
+                auto* variables = _arena.make<std::vector<Variable>>();
+                variables->reserve(n);
+                for (uint32_t i = 0; i < n; ++i) {
+                    auto name = in.getString();
+                    variables->push_back(Variable{name, type()});
+                }
+                for (auto& v : *variables)
+                    _variables.push_back(&v);
+            }
+
+            void readExpressions() {
+                auto n = in.get<uint32_t>();
+                for (uint32_t i = 0; i < n; ++i)
+                    _expressions.push_back(readExpression());
+            }
+
+            const ColorType* type() {
+                auto id = in.get<uint32_t>();
+                if (id == NONE)
+                    return nullptr;
+                if (id >= _types.size())
+                    throw SnapshotError();
+                return _types[id];
+            }
+
+            // like color, but also accepts the star color of time constraints
+            Color colorValue() {
+                auto* t = type();
+                auto id = in.get<uint32_t>();
+                if (t == StarColorType::starColorType() && id == 0)
+                    return Color();
+                if (t == nullptr || id >= t->size())
+                    throw SnapshotError();
+                return Color(t, id);
+            }
+
+            Color color() {
+                auto* t = type();
+                auto id = in.get<uint32_t>();
+                if (t == nullptr || id >= t->size())
+                    throw SnapshotError();
+                return (*t)[(size_t)id];
+            }
+
+            template<typename T>
+            const T* expression() {
+                auto id = in.get<uint32_t>();
+                if (id == NONE)
+                    return nullptr;
+                if (id >= _expressions.size())
+                    throw SnapshotError();
+                auto* e = dynamic_cast<const T*>(_expressions[id]);
+                if (e == nullptr)
+                    throw SnapshotError();
+                return e;
+            }
+
+            template<typename T>
+            const T* required() {
+                auto* e = expression<T>();
+                if (e == nullptr)
+                    throw SnapshotError();
+                return e;
+            }
+
+            std::vector<TimeInterval> intervals() {
+                std::vector<TimeInterval> res;
+                auto n = in.get<uint32_t>();
+                for (uint32_t i = 0; i < n; ++i) {
+                    bool leftStrict = in.get<uint8_t>();
+                    auto lower = in.get<uint32_t>();
+                    auto upper = in.get<uint32_t>();
+                    bool rightStrict = in.get<uint8_t>();
+                    res.emplace_back(leftStrict, lower, upper, rightStrict, colorValue());
+                    auto lowerConstant = in.getString();
+                    res.back().setConstants(lowerConstant, in.getString());
+                }
+                return res;
+            }
+
+            Arc arc() {
+                Arc arc;
+                arc.place = in.get<uint32_t>();
+                arc.transition = in.get<uint32_t>();
+                arc.expr = required<ArcExpression>();
+                arc.input = in.get<uint8_t>();
+                arc.inhibitor = in.get<uint8_t>();
+                arc.weight = in.get<int32_t>();
+                arc.interval = intervals();
+                return arc;
+            }
+
+        private:
+            std::vector<const ColorExpression*> colorList() {
+                std::vector<const ColorExpression*> res;
+                auto n = in.get<uint32_t>();
+                for (uint32_t i = 0; i < n; ++i)
+                    res.push_back(required<ColorExpression>());
+                return res;
+            }
+
+            template<typename T, typename E>
+            const Expression* binary() {
+                auto* left = required<E>();
+                auto* right = required<E>();
+                return _interner.make<T>(left, right);
+            }
+
+            const Expression* readExpression() {
+                switch (in.get<uint8_t>()) {
+                    case DotConstant:
+                        return _interner.make<DotConstantExpression>();
+                    case VariableRef: {
+                        auto id = in.get<uint32_t>();
+                        if (id >= _variables.size())
+                            throw SnapshotError();
+                        return _interner.make<VariableExpression>(_variables[id]);
+                    }
+                    case UserOperator:
+                        return _interner.make<UserOperatorExpression>(color());
+                    case UserSort: {
+                        auto* t = type();
+                        if (t == nullptr)
+                            throw SnapshotError();
+                        return _interner.make<UserSortExpression>(const_cast<ColorType*>(t));
+                    }
+                    case NumberConstant:
+                        return _interner.make<NumberConstantExpression>(in.get<uint32_t>());
+                    case Successor:
+                        return _interner.make<SuccessorExpression>(required<ColorExpression>());
+                    case Predecessor:
+                        return _interner.make<PredecessorExpression>(required<ColorExpression>());
+                    case Tuple: {
+                        auto* t = type();
+                        if (t != nullptr && dynamic_cast<const ProductType*>(t) == nullptr)
+                            throw SnapshotError();
+                        return _interner.make<TupleExpression>(colorList(), t);
+                    }
+                    case LessThan:
+                        return binary<LessThanExpression, ColorExpression>();
+                    case GreaterThan:
+                        return binary<GreaterThanExpression, ColorExpression>();
+                    case LessThanEq:
+                        return binary<LessThanEqExpression, ColorExpression>();
+                    case GreaterThanEq:
+                        return binary<GreaterThanEqExpression, ColorExpression>();
+                    case Equality:
+                        return binary<EqualityExpression, ColorExpression>();
+                    case Inequality:
+                        return binary<InequalityExpression, ColorExpression>();
+                    case Not:
+                        return _interner.make<NotExpression>(required<GuardExpression>());
+                    case And:
+                        return binary<AndExpression, GuardExpression>();
+                    case Or:
+                        return binary<OrExpression, GuardExpression>();
+                    case All: {
+                        auto* t = type();
+                        if (t == nullptr)
+                            throw SnapshotError();
+                        return _interner.make<AllExpression>(t);
+                    }
+                    case NumberOf: {
+                        auto number = in.get<uint32_t>();
+                        auto* all = expression<AllExpression>();
+                        auto colors = colorList();
+                        if (all != nullptr)
+                            return _interner.make<NumberOfExpression>(all, number);
+                        return _interner.make<NumberOfExpression>(std::move(colors), number);
+                    }
+                    case Add: {
+                        std::vector<const ArcExpression*> constituents;
+                        auto n = in.get<uint32_t>();
+                        for (uint32_t i = 0; i < n; ++i)
+                            constituents.push_back(required<ArcExpression>());
+                        return _interner.make<AddExpression>(std::move(constituents));
+                    }
+                    case Subtract:
+                        return binary<SubtractExpression, ArcExpression>();
+                    case ScalarProduct: {
+                        auto scalar = in.get<uint32_t>();
+                        return _interner.make<ScalarProductExpression>(required<ArcExpression>(), scalar);
+                    }
+                    default:
+                        throw SnapshotError();
+                }
+            }
+
+            Arena& _arena;
+            ExpressionInterner& _interner;
+            std::vector<const ColorType*> _types;
+            std::vector<const Variable*> _variables;
+            std::vector<const Expression*> _expressions;
+        };
+    }
+
+    void ColoredPetriNetBuilder::writeSnapshot(std::ostream& out) const {
+        SnapshotWriter writer;
+        auto& net = writer.net;
+
+        // bindings are enumerated in the order of the variables in memory, so they are written in that order
+        std::set<const Colored::Variable*> variables;
+        for (size_t i = 0; i < _expressions->size(); ++i)
+            if (auto* var = dynamic_cast<const Colored::VariableExpression*>((*_expressions)[i]))
+                variables.insert(var->variable());
+        for (auto* var : variables)
+            writer.variable(var);
+
+        for (size_t i = 0; i < _expressions->size(); ++i)
+            (*_expressions)[i]->visit(writer);
+
+        net.put<uint32_t>(_colors.size());
+        for (auto& [name, type] : _colors) {
+            net.put(name);
+            net.put(writer.type(type));
+        }
+
+        net.put<uint32_t>(_constants.size());
+        for (auto& [name, value] : _constants) {
+            net.put(name);
+            net.put(value);
+        }
+
+        net.put<uint32_t>(_places.size());
+        for (size_t i = 0; i < _places.size(); ++i) {
+            auto& place = _places[i];
+            net.put(place.name);
+            net.put(writer.type(place.type));
+            auto marking = place.marking;
+            net.put<uint32_t>(marking.distinctSize());
+            for (auto [color, count] : marking) {
+                writer.color(net, color);
+                net.put(count);
+            }
+            net.put<uint32_t>(place.invariants.size());
+            for (auto& inv : place.invariants) {
+                net.put<uint8_t>(inv.isBoundStrict());
+                net.put<int32_t>(inv.getBound());
+                writer.color(net, inv.getColor());
+                net.put(inv.getBoundConstant());
+            }
+            net.put<uint8_t>(place.inhibiting);
+            net.put(std::get<0>(_placelocations[i]));
+            net.put(std::get<1>(_placelocations[i]));
+        }
+
+        net.put<uint32_t>(_transitions.size());
+        for (size_t i = 0; i < _transitions.size(); ++i) {
+            auto& transition = _transitions[i];
+            net.put(transition.name);
+            net.put(writer.expression(transition.guard));
+            net.put<int32_t>(transition.player);
+            net.put<uint8_t>(transition.urgent);
+            net.put<uint32_t>(transition.distribution);
+            net.put<uint32_t>(transition.distributionParams.size());
+            for (auto p : transition.distributionParams)
+                net.put(p);
+            net.put(transition.weight);
+            net.put<uint32_t>(transition.firingMode);
+            net.put(std::get<0>(_transitionlocations[i]));
+            net.put(std::get<1>(_transitionlocations[i]));
+            net.put<uint32_t>(transition.arcs.size());
+            for (auto& arc : transition.arcs)
+                writer.arc(arc);
+            net.put<uint32_t>(transition.transport.size());
+            for (auto& arc : transition.transport) {
+                net.put(arc.source);
+                net.put(arc.transition);
+                net.put(arc.destination);
+                net.put(writer.expression(arc.in_expr));
+                net.put(writer.expression(arc.out_expr));
+                net.put<int32_t>(arc.weight);
+                writer.intervals(arc.interval);
+            }
+        }
+
+        net.put<uint32_t>(_inhibitorArcs.size());
+        for (auto& [transition, arcs] : _inhibitorArcs) {
+            net.put(transition);
+            net.put<uint32_t>(arcs.size());
+            for (auto& arc : arcs)
+                writer.arc(arc);
+        }
+
+        Encoder header;
+        header.data.append(MAGIC, sizeof(MAGIC));
+        header.put(BYTE_ORDER_MARK);
+        header.put(writer.typeCount());
+        header.data.append(writer.types.data);
+        header.put(writer.variableCount());
+        header.data.append(writer.variables.data);
+        header.put<uint32_t>(_expressions->size());
+        out.write(header.data.data(), header.data.size());
+        out.write(writer.expressions.data.data(), writer.expressions.data.size());
+        out.write(net.data.data(), net.data.size());
+    }
+
+    bool ColoredPetriNetBuilder::readSnapshot(std::istream& stream) {
+        if (!_places.empty() || !_transitions.empty() || _expressions->size() != 0)
+            return false;
+        std::stringstream ss;
+        ss << stream.rdbuf();
+        auto data = ss.str();
+        if (data.size() < sizeof(MAGIC) || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)
+            return false;
+        data.erase(0, sizeof(MAGIC));
+
+        // expressions are decoded into their own arena, which only replaces
+        // the one of the builder once the whole snapshot is valid
+        auto arena = std::make_shared<Colored::Arena>();
+        auto expressions = std::make_shared<Colored::ExpressionInterner>(*arena);
+        SnapshotReader reader(data, *arena, *expressions);
+        auto& in = reader.in;
+        ColorTypeMap colors;
+        ConstantMap constants;
+        std::vector<Colored::Place> places;
+        std::vector<std::tuple<double, double>> placelocations;
+        std::vector<Colored::Transition> transitions;
+        std::vector<std::tuple<double, double>> transitionlocations;
+        std::map<uint32_t, std::vector<Colored::Arc>> inhibitorArcs;
+        try {
+            if (in.get<uint32_t>() != BYTE_ORDER_MARK)
+                return false;
+            reader.readTypes();
+            reader.readVariables();
+            reader.readExpressions();
+
+            auto n = in.get<uint32_t>();
+            for (uint32_t i = 0; i < n; ++i) {
+                auto name = in.getString();
+                colors[name] = reader.type();
+            }
+
+            n = in.get<uint32_t>();
+            for (uint32_t i = 0; i < n; ++i) {
+                auto name = in.getString();
+                constants[name] = in.get<uint32_t>();
+            }
+
+            n = in.get<uint32_t>();
+            for (uint32_t i = 0; i < n; ++i) {
+                Colored::Place place;
+                place.name = in.getString();
+                place.type = reader.type();
+                std::vector<std::pair<Color, uint32_t>> marking;
+                auto m = in.get<uint32_t>();
+                for (uint32_t j = 0; j < m; ++j) {
+                    auto color = reader.color();
+                    marking.emplace_back(color, in.get<uint32_t>());
+                }
+                place.marking = Colored::Multiset(marking);
+                m = in.get<uint32_t>();
+                for (uint32_t j = 0; j < m; ++j) {
+                    bool strict = in.get<uint8_t>();
+                    auto bound = in.get<int32_t>();
+                    place.invariants.emplace_back(strict, bound, reader.colorValue());
+                    place.invariants.back().setBoundConstant(in.getString());
+                }
+                place.inhibiting = in.get<uint8_t>();
+                auto x = in.get<double>();
+                auto y = in.get<double>();
+                places.emplace_back(std::move(place));
+                placelocations.emplace_back(x, y);
+            }
+
+            auto check = [&](uint32_t place, uint32_t transition) {
+                if (place >= places.size() || transition >= n)
+                    throw SnapshotError();
+            };
+            n = in.get<uint32_t>();
+            for (uint32_t i = 0; i < n; ++i) {
+                Colored::Transition transition;
+                transition.name = in.getString();
+                transition.guard = reader.expression<Colored::GuardExpression>();
+                transition.player = in.get<int32_t>();
+                transition.urgent = in.get<uint8_t>();
+                transition.distribution = (Colored::SMC::Distribution)in.get<uint32_t>();
+                auto m = in.get<uint32_t>();
+                for (uint32_t j = 0; j < m; ++j)
+                    transition.distributionParams.push_back(in.get<double>());
+                transition.weight = in.get<double>();
+                transition.firingMode = (Colored::SMC::FiringMode)in.get<uint32_t>();
+                auto x = in.get<double>();
+                auto y = in.get<double>();
+                m = in.get<uint32_t>();
+                for (uint32_t j = 0; j < m; ++j) {
+                    transition.arcs.emplace_back(reader.arc());
+                    check(transition.arcs.back().place, transition.arcs.back().transition);
+                }
+                m = in.get<uint32_t>();
+                for (uint32_t j = 0; j < m; ++j) {
+                    Colored::TransportArc arc;
+                    arc.source = in.get<uint32_t>();
+                    arc.transition = in.get<uint32_t>();
+                    arc.destination = in.get<uint32_t>();
+                    arc.in_expr = reader.expression<Colored::ArcExpression>();
+                    arc.out_expr = reader.expression<Colored::ArcExpression>();
+                    arc.weight = in.get<int32_t>();
+                    arc.interval = reader.intervals();
+                    check(arc.source, arc.transition);
+                    check(arc.destination, arc.transition);
+                    transition.transport.emplace_back(std::move(arc));
+                }
+                transitions.emplace_back(std::move(transition));
+                transitionlocations.emplace_back(x, y);
+            }
+
+            auto m = in.get<uint32_t>();
+            for (uint32_t i = 0; i < m; ++i) {
+                auto transition = in.get<uint32_t>();
+                if (transition >= transitions.size())
+                    throw SnapshotError();
+                auto& arcs = inhibitorArcs[transition];
+                auto k = in.get<uint32_t>();
+                for (uint32_t j = 0; j < k; ++j) {
+                    arcs.emplace_back(reader.arc());
+                    check(arcs.back().place, arcs.back().transition);
+                }
+            }
+            if (!in.done())
+                return false;
+        } catch (SnapshotError&) {
+            return false;
+        }
+
+        _arena = std::move(arena);
+        _expressions = std::move(expressions);
+        _colors = std::move(colors);
+        _constants = std::move(constants);
+        _places = std::move(places);
+        _placelocations = std::move(placelocations);
+        _transitions = std::move(transitions);
+        _transitionlocations = std::move(transitionlocations);
+        _inhibitorArcs = std::move(inhibitorArcs);
+        for (uint32_t i = 0; i < _places.size(); ++i)
+            _placenames[_places[i].name] = i;
+        for (uint32_t i = 0; i < _transitions.size(); ++i)
+            _transitionnames[_transitions[i].name] = i;
+        return true;
+    }
+}
@@ -0,0 +1,284 @@
+/*
+ * File:   Symmetry.cpp
+ *
+ * Detection of symmetric sorts, see Symmetry.h. The checks are syntactic and
+ * only ever miss symmetries, they never report a sort which is not one.
+ */
+
+#include "Colored/ColoredPetriNetBuilder.h"
+#include "Colored/ExpressionVisitor.h"
+#include "Colored/Symmetry.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace unfoldtacpn {
+    namespace {
+        using namespace Colored;
+
+        // collects the sorts whose colors an expression tells apart
+        class OrderFinder : public ExpressionVisitor {
+        public:
+            OrderFinder(std::unordered_set<const ColorType*>& broken,
+                        const std::vector<const FiniteIntRangeType*>& ranges)
+            : _broken(broken), _ranges(ranges) {}
+
+            void walk(const Expression* expr) {
+                if (expr != nullptr && _seen.insert(expr).second)
+                    expr->visit(*this);
+            }
+
+        protected:
+            void _accept(const DotConstantExpression*) override {}
+            void _accept(const VariableExpression*) override {}
+            void _accept(const UserSortExpression*) override {}
+            void _accept(const NumberConstantExpression*) override {}
+
+            void _accept(const UserOperatorExpression* element) override {
+                auto* type = element->userOperator().getColorType();
+                breaks(type);
+                // the parser may give a range constant any sort with its bounds
+                if (type != nullptr && type->isIntRange())
+                    overlaps(type);
+            }
+
+            void _accept(const SuccessorExpression* element) override {
+                breaks(element->getColorType());
+                walk(element->color());
+            }
+
+            void _accept(const PredecessorExpression* element) override {
+                breaks(element->getColorType());
+                walk(element->color());
+            }
+
+            void _accept(const TupleExpression* element) override {
+                for (auto* c : element->colors())
+                    walk(c);
+            }
+
+            void _accept(const LessThanExpression* element) override { ordered(element); }
+            void _accept(const GreaterThanExpression* element) override { ordered(element); }
+            void _accept(const LessThanEqExpression* element) override { ordered(element); }
+            void _accept(const GreaterThanEqExpression* element) override { ordered(element); }
+
+            void _accept(const EqualityExpression* element) override { equality(element); }
+            void _accept(const InequalityExpression* element) override { equality(element); }
+
+            void _accept(const NotExpression* element) override {
+                walk(element->expr());
+            }
+
+            void _accept(const AndExpression* element) override {
+                walk(element->left());
+                walk(element->right());
+            }
+
+            void _accept(const OrExpression* element) override {
+                walk(element->left());
+                walk(element->right());
+            }
+
+            void _accept(const AllExpression*) override {}
+
+            void _accept(const NumberOfExpression* element) override {
+                walk(element->all());
+                for (auto* c : element->colors())
+                    walk(c);
+            }
+
+            void _accept(const AddExpression* element) override {
+                for (auto* c : element->constituents())
+                    walk(c);
+            }
+
+            void _accept(const SubtractExpression* element) override {
+                walk(element->left());
+                walk(element->right());
+            }
+
+            void _accept(const ScalarProductExpression* element) override {
+                walk(element->expr());
+            }
+
+        private:
+            // guards compare colors of different int ranges by value, which
+            // relates those sorts to every range sharing some of the values
+            template<typename T>
+            void equality(const T* element) {
+                auto* left = element->left()->getColorType();
+                auto* right = element->right()->getColorType();
+                if (left != right && left != nullptr && right != nullptr &&
+                    left->isIntRange() && right->isIntRange()) {
+                    overlaps(left);
+                    overlaps(right);
+                }
+                walk(element->left());
+                walk(element->right());
+            }
+
+            template<typename T>
+            void ordered(const T* element) {
+                breaks(element->left()->getColorType());
+                breaks(element->right()->getColorType());
+                walk(element->left());
+                walk(element->right());
+            }
+
+            void breaks(const ColorType* type) {
+                if (type == nullptr)
+                    return;
+                _broken.insert(type);
+                if (auto* product = dynamic_cast<const ProductType*>(type))
+                    for (size_t i = 0; i < product->tupleSize(); ++i)
+                        _broken.insert(product->getType(i));
+            }
+
+            void overlaps(const ColorType* type) {
+                auto* range = static_cast<const FiniteIntRangeType*>(type);
+                for (auto* other : _ranges)
+                    if (other->lowerBound() <= range->upperBound() && range->lowerBound() <= other->upperBound())
+                        _broken.insert(other);
+            }
+
+            std::unordered_set<const ColorType*>& _broken;
+            const std::vector<const FiniteIntRangeType*>& _ranges;
+            std::unordered_set<const Expression*> _seen;
+        };
+
+        bool involves(const ColorType* type, const ColorType* sort) {
+            if (type == sort)
+                return true;
+            if (auto* product = dynamic_cast<const ProductType*>(type))
+                for (size_t i = 0; i < product->tupleSize(); ++i)
+                    if (product->getType(i) == sort)
+                        return true;
+            return false;
+        }
+
+        // the image of a color of a type involving sort, when the colors of
+        // sort are permuted by perm
+        Color permute(const Color& color, const ColorType* sort, const std::vector<uint32_t>& perm) {
+            auto* type = color.getColorType();
+            if (type == sort)
+                return (*sort)[perm[color.getId()]];
+            auto* product = dynamic_cast<const ProductType*>(type);
+            if (product == nullptr)
+                return color;
+            auto tuple = color.getTuple();
+            for (auto& c : tuple)
+                if (c.getColorType() == sort)
+                    c = (*sort)[perm[c.getId()]];
+            return *product->getColor(tuple);
+        }
+
+        template<typename T>
+        bool colorSpecific(const std::vector<T>& constraints) {
+            for (auto& c : constraints)
+                if (c.getColor().getColorType() != StarColorType::starColorType())
+                    return true;
+            return false;
+        }
+    }
+
+    std::vector<Colored::SortSymmetry> ColoredPetriNetBuilder::getSymmetries() const {
+        std::unordered_set<const Colored::ColorType*> broken;
+        std::vector<const Colored::FiniteIntRangeType*> ranges;
+        for (auto& [name, sort] : _colors)
+            if (auto* range = dynamic_cast<const Colored::FiniteIntRangeType*>(sort))
+                ranges.push_back(range);
+        OrderFinder finder(broken, ranges);
+        for (auto& transition : _transitions) {
+            finder.walk(transition.guard);
+            for (auto& arc : transition.arcs)
+                finder.walk(arc.expr);
+            for (auto& arc : transition.transport) {
+                finder.walk(arc.in_expr);
+                finder.walk(arc.out_expr);
+            }
+        }
+        for (auto& [transition, arcs] : _inhibitorArcs)
+            for (auto& arc : arcs)
+                finder.walk(arc.expr);
+
+        std::vector<Colored::SortSymmetry> symmetries;
+        for (auto& [name, sort] : _colors) {
+            if (sort == nullptr || sort->size() < 2 || broken.count(sort) > 0 ||
+                sort == Colored::StarColorType::starColorType() ||
+                dynamic_cast<const Colored::ProductType*>(sort) != nullptr)
+                continue;
+
+            // time constraints for single colors are ordered by the arcs and
+            // places they are given on, so any of them on the sort breaks it
+            bool symmetric = true;
+            for (auto& place : _places) {
+                if (involves(place.type, sort) && colorSpecific(place.invariants))
+                    symmetric = false;
+            }
+            auto specific = [&](uint32_t place, const std::vector<Colored::TimeInterval>& intervals) {
+                return involves(_places[place].type, sort) && colorSpecific(intervals);
+            };
+            for (auto& transition : _transitions) {
+                for (auto& arc : transition.arcs)
+                    if (specific(arc.place, arc.interval))
+                        symmetric = false;
+                for (auto& arc : transition.transport)
+                    if (specific(arc.source, arc.interval) || specific(arc.destination, arc.interval))
+                        symmetric = false;
+            }
+            if (!symmetric)
+                continue;
+
+            std::vector<std::vector<uint32_t>> perms;
+            std::vector<uint32_t> swap(sort->size()), rotate(sort->size());
+            for (uint32_t i = 0; i < sort->size(); ++i) {
+                swap[i] = i;
+                rotate[i] = (i + 1) % sort->size();
+            }
+            std::swap(swap[0], swap[1]);
+            perms.push_back(std::move(swap));
+            // for two colors the rotation is the swap
+            if (sort->size() > 2)
+                perms.push_back(std::move(rotate));
+
+            // each generator has to preserve the initial marking
+            for (auto& place : _places) {
+                if (!involves(place.type, sort))
+                    continue;
+                Colored::Multiset marking = place.marking;
+                const Colored::Multiset& initial = place.marking;
+                for (auto& perm : perms)
+                    for (auto [color, count] : marking)
+                        if (initial[permute(color, sort, perm)] != count)
+                            symmetric = false;
+            }
+            if (!symmetric)
+                continue;
+
+            Colored::SortSymmetry symmetry;
+            symmetry.sort = name;
+            for (uint32_t i = 0; i < sort->size(); ++i)
+                symmetry.colors.push_back(sort->getColorName(i));
+            for (auto& perm : perms) {
+                std::unordered_map<std::string, std::string> generator;
+                for (uint32_t p = 0; p < _places.size(); ++p) {
+                    auto* type = _places[p].type;
+                    if (!involves(type, sort))
+                        continue;
+                    for (uint32_t c = 0; c < type->size(); ++c) {
+                        auto color = (*type)[c];
+                        auto& from = findPlaceName(p, color);
+                        auto& to = findPlaceName(p, permute(color, sort, perm));
+                        if (from != to)
+                            generator.emplace(from, to);
+                    }
+                }
+                symmetry.generators.push_back(std::move(generator));
+            }
+            symmetries.push_back(std::move(symmetry));
+        }
+        std::sort(symmetries.begin(), symmetries.end(),
+                  [](const Colored::SortSymmetry& a, const Colored::SortSymmetry& b) { return a.sort < b.sort; });
+        return symmetries;
+    }
+}
@@ -5,51 +5,70 @@
 #include "Colored/Colors.h"
 #include "Colored/TimeInvariant.h"
 
+#include "errorcodes.h"
+
+#include <charconv>
 #include <vector>
 #include <sstream>
 
 namespace unfoldtacpn {
     namespace Colored {
-        TimeInterval TimeInterval::createFor(const std::string &interval, std::vector<const Colored::Color*> colors, std::unordered_map<std::string, uint32_t> constantValues) {
-            Colored::Color color = Colored::TimeInvariant::createColor(colors);
-            bool leftStrict = false;
-            if(interval.find("(") != std::string::npos){
-                leftStrict = true;
+        namespace {
+            std::string_view trimmed(std::string_view s) {
+                while (!s.empty() && std::isspace((unsigned char)s.front()))
+                    s.remove_prefix(1);
+                while (!s.empty() && std::isspace((unsigned char)s.back()))
+                    s.remove_suffix(1);
+                return s;
             }
+        }
 
-            bool rightStrict = false;
-            if(interval.find(")") != std::string::npos) {
-                rightStrict = true;
+        uint32_t TimeInterval::parseBound(std::string_view text, const std::unordered_map<std::string, uint32_t>& constantValues, std::string& constant) {
+            text = trimmed(text);
+            uint32_t value = 0;
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (error == std::errc() && end == text.data() + text.size())
+                return value;
+            auto it = constantValues.find(std::string(text));
+            if (it == constantValues.end()) {
+                throw FatalError("ERROR: Invalid bound '" + std::string(text) + "' in time constraint");
             }
+            constant = it->first;
+            return it->second;
+        }
 
-            std::string strLowerBound = interval.substr(0, interval.find(","));
-            trim(strLowerBound);
-            strLowerBound = strLowerBound.substr(1, strLowerBound.size());
-            std::string strUpperBound = interval.substr(interval.find(","), interval.size()-1);
-            trim(strUpperBound);
-            if(rightStrict == true){
-                strUpperBound = strUpperBound.substr(1, strUpperBound.find(")")-1);
-            } else{
-                strUpperBound = strUpperBound.substr(1, strUpperBound.find("]")-1);
+        TimeInterval TimeInterval::createFor(std::string_view interval, const std::vector<Colored::Color>& colors, const std::unordered_map<std::string, uint32_t>& constantValues) {
+            Colored::Color color = Colored::TimeInvariant::createColor(colors);
+            bool leftStrict = interval.find('(') != std::string_view::npos;
+            bool rightStrict = interval.find(')') != std::string_view::npos;
+
+            auto comma = interval.find(',');
+            auto close = interval.find_first_of(")]", comma);
+            if (comma == std::string_view::npos || close == std::string_view::npos) {
+                throw FatalError("ERROR: Invalid time interval '" + std::string(interval) + "'");
             }
+            // the brackets are the first and last non-blank characters
+            auto lower = trimmed(interval.substr(0, comma));
+            lower.remove_prefix(std::min<size_t>(1, lower.size()));
+            auto upper = trimmed(interval.substr(comma + 1, close - comma - 1));
 
-            int lowerBound;
-            int upperBound;
-            if (constantValues.find(strLowerBound) == constantValues.end())
-                lowerBound = std::stoi(strLowerBound);
-            else
-                lowerBound = constantValues[strLowerBound];
+            std::string lowerConstant, upperConstant;
+            uint32_t lowerBound = parseBound(lower, constantValues, lowerConstant);
+            uint32_t upperBound = upper == "inf" ? std::numeric_limits<int>().max()
+                                                 : parseBound(upper, constantValues, upperConstant);
 
-            if(strUpperBound.compare("inf") == 0 )
-                upperBound = std::numeric_limits<int>().max();
-            else {
-                if (constantValues.find(strUpperBound) == constantValues.end())
-                    upperBound = std::stoi(strUpperBound);
-                else
-                    upperBound = constantValues[strUpperBound];
-            }
+            TimeInterval res(leftStrict, lowerBound, upperBound, rightStrict, color);
+            res.setConstants(lowerConstant, upperConstant);
+            return res;
+        }
 
-            return TimeInterval(leftStrict, lowerBound, upperBound, rightStrict, color);
+        void TimeInterval::instantiate(const std::unordered_map<std::string, uint32_t>& constantValues) {
+            auto lower = constantValues.find(lowerConstant);
+            if (!lowerConstant.empty() && lower != constantValues.end())
+                lowerBound = lower->second;
+            auto upper = constantValues.find(upperConstant);
+            if (!upperConstant.empty() && upper != constantValues.end())
+                upperBound = upper->second;
         }
 
         void TimeInterval::print(std::ostream &out) const
@@ -73,12 +92,10 @@ namespace unfoldtacpn {
                 upperBound = upperBound / divider;
             }
         }
-        Colored::Color TimeInterval::createColor(std::vector<const Colored::Color*> colors) {
-            if (colors.size() == 1 ) {
-                return Color(colors.front()->getColorType(), colors.front()->getId(), colors.front()->getColorName().c_str());
-            } else {
-                return Color(colors.front()->getColorType(), colors.front()->getId(), colors);
-            }
+        Colored::Color TimeInterval::createColor(std::vector<Colored::Color> colors) {
+            // tuple constraints are resolved to a color of the product type by the parser
+            assert(colors.size() == 1);
+            return colors.front();
         }
     }
 }
@@ -10,39 +10,32 @@
 namespace unfoldtacpn {
     namespace Colored {
 
-        TimeInvariant TimeInvariant::createFor(const std::string& invariant, const std::vector<const Colored::Color*>& colors, const std::unordered_map<std::string, uint32_t>& constants){
+        TimeInvariant TimeInvariant::createFor(std::string_view invariant, const std::vector<Colored::Color>& colors, const std::unordered_map<std::string, uint32_t>& constants){
             Colored::Color color = createColor(colors);
-            if(invariant.empty())
+            if(invariant.empty() || invariant.find("inf") != std::string_view::npos)
                 return TimeInvariant(std::move(color));
-            bool strict = invariant.find("<=") == std::string::npos;
-            int bound = std::numeric_limits<int>().max();
+            bool strict = invariant.find("<=") == std::string_view::npos;
+            invariant.remove_prefix(std::min<size_t>(strict ? 1 : 2, invariant.size()));
 
-            int pos = strict ? 1 : 2;
-            std::string number = invariant.substr(pos);
-            TimeInterval::trim(number);
-
-            bool foundInf = invariant.find("inf") != std::string::npos;
-
-            if(foundInf == false) {
-                if (constants.find(number) == constants.end())
-                    bound = std::stoi(number);
-                else
-                    bound = constants.find(number)->second;
-            }
-
-
-            if (bound == std::numeric_limits<int>().max())
+            std::string constant;
+            int bound = TimeInterval::parseBound(invariant, constants, constant);
+            if (constant.empty() && bound == std::numeric_limits<int>().max())
                 return TimeInvariant(std::move(color));
-            else
-                return TimeInvariant(strict, bound, std::move(color));
+            TimeInvariant res(strict, bound, std::move(color));
+            res.setBoundConstant(constant);
+            return res;
+        }
+
+        void TimeInvariant::instantiate(const std::unordered_map<std::string, uint32_t>& constants) {
+            auto it = constants.find(boundConstant);
+            if (!boundConstant.empty() && it != constants.end())
+                bound = it->second;
         }
 
-        Colored::Color TimeInvariant::createColor(const std::vector<const Colored::Color*>& colors) {
-            if (colors.size() == 1 ) {
-                return Color(colors.front()->getColorType(), colors.front()->getId(), colors.front()->getColorName().c_str());
-            } else {
-                return Color(colors.front()->getColorType(), colors.front()->getId(), colors);
-            }
+        Colored::Color TimeInvariant::createColor(const std::vector<Colored::Color>& colors) {
+            // tuple constraints are resolved to a color of the product type by the parser
+            assert(colors.size() == 1);
+            return colors.front();
         }
 
         void TimeInvariant::print(std::ostream& out) const
@@ -0,0 +1,410 @@
+/*
+ * File:   UnfoldCache.cpp
+ *
+ * Incremental unfolding, see UnfoldCache.h. Fingerprints are structural,
+ * such that they can be compared between nets parsed independently.
+ */
+
+#include "Colored/ColoredPetriNetBuilder.h"
+#include "Colored/ExpressionVisitor.h"
+#include "Colored/UnfoldCache.h"
+
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <map>
+
+namespace unfoldtacpn {
+    namespace {
+        using namespace Colored;
+
+        typedef UnfoldCache::Fingerprint fingerprint_t;
+
+        inline uint64_t combine(uint64_t h, uint64_t v) {
+            return h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+        }
+
+        // splitmix64 over a multiplicative combination, independent of combine
+        inline uint64_t scramble(uint64_t h, uint64_t v) {
+            uint64_t z = h * 0x100000001b3ULL + v;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        inline uint64_t fnv(const std::string& s) {
+            uint64_t h = 0xcbf29ce484222325ULL;
+            for (unsigned char c : s)
+                h = (h ^ c) * 0x100000001b3ULL;
+            return h;
+        }
+
+        inline fingerprint_t mix(const fingerprint_t& h, uint64_t v) {
+            return {combine(h.first, v), scramble(h.second, v)};
+        }
+
+        inline fingerprint_t mix(const fingerprint_t& h, const fingerprint_t& v) {
+            return {combine(h.first, v.first), scramble(h.second, v.second)};
+        }
+
+        inline fingerprint_t mix(const fingerprint_t& h, const std::string& s) {
+            return {combine(h.first, std::hash<std::string>()(s)), scramble(h.second, fnv(s))};
+        }
+
+        inline fingerprint_t mix(const fingerprint_t& h, double d) {
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            return mix(h, bits);
+        }
+
+        class Fingerprinter : public ExpressionVisitor {
+        public:
+            Fingerprinter(const ColoredPetriNetBuilder::ColorTypeMap& colors) : _colors(colors) {}
+
+            fingerprint_t type(const ColorType* type) {
+                if (type == nullptr)
+                    return 0;
+                auto it = _types.find(type);
+                if (it != _types.end())
+                    return it->second;
+                fingerprint_t h = mix(fingerprint_t(1), type->getName());
+                if (type == StarColorType::starColorType()) {
+                    h = mix(h, (uint64_t)2);
+                } else if (auto* range = dynamic_cast<const FiniteIntRangeType*>(type)) {
+                    h = mix(mix(mix(h, (uint64_t)3), (uint64_t)range->lowerBound()), (uint64_t)range->upperBound());
+                } else if (auto* product = dynamic_cast<const ProductType*>(type)) {
+                    h = mix(h, (uint64_t)4);
+                    for (size_t i = 0; i < product->tupleSize(); ++i)
+                        h = mix(h, this->type(product->getType(i)));
+                } else {
+                    for (uint32_t i = 0; i < type->size(); ++i)
+                        h = mix(h, type->getColorName(i));
+                }
+                _types.emplace(type, h);
+                return h;
+            }
+
+            fingerprint_t color(const Color& color) {
+                return mix(type(color.getColorType()), (uint64_t)color.getId());
+            }
+
+            fingerprint_t expression(const Expression* expr) {
+                if (expr == nullptr)
+                    return 0;
+                auto it = _expressions.find(expr);
+                if (it != _expressions.end())
+                    return it->second;
+                expr->visit(*this);
+                _expressions.emplace(expr, _result);
+                return _result;
+            }
+
+            fingerprint_t intervals(const std::vector<TimeInterval>& intervals) {
+                fingerprint_t h((uint64_t)intervals.size());
+                for (auto& i : intervals) {
+                    h = mix(h, (uint64_t)i.isLowerBoundStrict());
+                    h = mix(h, (uint64_t)i.getLowerBound());
+                    h = mix(h, (uint64_t)i.getUpperBound());
+                    h = mix(h, (uint64_t)i.isUpperBoundStrict());
+                    h = mix(h, color(i.getColor()));
+                }
+                return h;
+            }
+
+        protected:
+            fingerprint_t node(uint64_t kind, std::initializer_list<fingerprint_t> values) {
+                fingerprint_t h(kind);
+                for (auto v : values)
+                    h = mix(h, v);
+                return h;
+            }
+
+            template<typename T>
+            fingerprint_t list(fingerprint_t h, const std::vector<T>& elements) {
+                h = mix(h, (uint64_t)elements.size());
+                for (auto* e : elements)
+                    h = mix(h, expression(e));
+                return h;
+            }
+
+            // tuples are matched against every product type of the net
+            fingerprint_t productTypes() {
+                if (_products == fingerprint_t()) {
+                    std::map<std::string, const ColorType*> sorted(_colors.begin(), _colors.end());
+                    _products = 1;
+                    for (auto& [name, t] : sorted)
+                        if (dynamic_cast<const ProductType*>(t))
+                            _products = mix(mix(_products, name), type(t));
+                }
+                return _products;
+            }
+
+            void _accept(const DotConstantExpression*) override {
+                _result = node(1, {});
+            }
+
+            void _accept(const VariableExpression* element) override {
+                auto* var = element->variable();
+                _result = mix(node(2, {type(var->colorType)}), var->name);
+            }
+
+            void _accept(const UserOperatorExpression* element) override {
+                _result = node(3, {color(element->userOperator())});
+            }
+
+            void _accept(const UserSortExpression* element) override {
+                _result = node(4, {type(element->userSort())});
+            }
+
+            void _accept(const NumberConstantExpression* element) override {
+                _result = node(5, {element->number()});
+            }
+
+            void _accept(const SuccessorExpression* element) override {
+                _result = node(6, {expression(element->color())});
+            }
+
+            void _accept(const PredecessorExpression* element) override {
+                _result = node(7, {expression(element->color())});
+            }
+
+            void _accept(const TupleExpression* element) override {
+                _result = list(node(8, {type(element->getColorType()), productTypes()}), element->colors());
+            }
+
+            void _accept(const LessThanExpression* element) override {
+                _result = node(9, {expression(element->left()), expression(element->right())});
+            }
+
+            void _accept(const GreaterThanExpression* element) override {
+                _result = node(10, {expression(element->left()), expression(element->right())});
+            }
+
+            void _accept(const LessThanEqExpression* element) override {
+                _result = node(11, {expression(element->left()), expression(element->right())});
+            }
+
+            void _accept(const GreaterThanEqExpression* element) override {
+                _result = node(12, {expression(element->left()), expression(element->right())});
+            }
+
+            void _accept(const EqualityExpression* element) override {
+                _result = node(13, {expression(element->left()), expression(element->right())});
+            }
+
+            void _accept(const InequalityExpression* element) override {
+                _result = node(14, {expression(element->left()), expression(element->right())});
+            }
+
+            void _accept(const NotExpression* element) override {
+                _result = node(15, {expression(element->expr())});
+            }
+
+            void _accept(const AndExpression* element) override {
+                _result = node(16, {expression(element->left()), expression(element->right())});
+            }
+
+            void _accept(const OrExpression* element) override {
+                _result = node(17, {expression(element->left()), expression(element->right())});
+            }
+
+            void _accept(const AllExpression* element) override {
+                _result = node(18, {type(element->sort())});
+            }
+
+            void _accept(const NumberOfExpression* element) override {
+                _result = list(node(19, {element->number(), expression(element->all())}), element->colors());
+            }
+
+            void _accept(const AddExpression* element) override {
+                _result = list(node(20, {}), element->constituents());
+            }
+
+            void _accept(const SubtractExpression* element) override {
+                _result = node(21, {expression(element->left()), expression(element->right())});
+            }
+
+            void _accept(const ScalarProductExpression* element) override {
+                _result = node(22, {element->scalar(), expression(element->expr())});
+            }
+
+        private:
+            const ColoredPetriNetBuilder::ColorTypeMap& _colors;
+            std::unordered_map<const ColorType*, fingerprint_t> _types;
+            std::unordered_map<const Expression*, fingerprint_t> _expressions;
+            fingerprint_t _products;
+            fingerprint_t _result;
+        };
+
+        // forwards to another builder and remembers the calls, such that they can be replayed
+        class RecordingBuilder : public TAPNBuilderInterface {
+        public:
+            RecordingBuilder(TAPNBuilderInterface& builder, UnfoldCache::calls_t& calls)
+            : _builder(builder), _calls(calls) {}
+
+            void addPlace(const std::string& name, int tokens, bool strict, int bound,
+                          double x, double y) override {
+                _builder.addPlace(name, tokens, strict, bound, x, y);
+                _calls.emplace_back([=](TAPNBuilderInterface& b) {
+                    b.addPlace(name, tokens, strict, bound, x, y);
+                });
+            }
+
+            void addTransition(const std::string& name, int player, bool urgent, double x, double y,
+                               int distrib, std::vector<double> params, double weight, int firingMode) override {
+                _builder.addTransition(name, player, urgent, x, y, distrib, params, weight, firingMode);
+                _calls.emplace_back([=](TAPNBuilderInterface& b) {
+                    b.addTransition(name, player, urgent, x, y, distrib, params, weight, firingMode);
+                });
+            }
+
+            void addInputArc(const std::string& place, const std::string& transition, bool inhibitor,
+                             int weight, bool lstrict, bool ustrict, int lower, int upper) override {
+                _builder.addInputArc(place, transition, inhibitor, weight, lstrict, ustrict, lower, upper);
+                _calls.emplace_back([=](TAPNBuilderInterface& b) {
+                    b.addInputArc(place, transition, inhibitor, weight, lstrict, ustrict, lower, upper);
+                });
+            }
+
+            void addOutputArc(const std::string& transition, const std::string& place, int weight) override {
+                _builder.addOutputArc(transition, place, weight);
+                _calls.emplace_back([=](TAPNBuilderInterface& b) {
+                    b.addOutputArc(transition, place, weight);
+                });
+            }
+
+            void addTransportArc(const std::string& source, const std::string& transition,
+                                 const std::string& target, int weight,
+                                 bool lstrict, bool ustrict, int lower, int upper) override {
+                _builder.addTransportArc(source, transition, target, weight, lstrict, ustrict, lower, upper);
+                _calls.emplace_back([=](TAPNBuilderInterface& b) {
+                    b.addTransportArc(source, transition, target, weight, lstrict, ustrict, lower, upper);
+                });
+            }
+
+        private:
+            TAPNBuilderInterface& _builder;
+            UnfoldCache::calls_t& _calls;
+        };
+    }
+
+    void ColoredPetriNetBuilder::unfold(TAPNBuilderInterface& builder, Colored::UnfoldCache& cache) {
+        clear();
+        findSumPlaces();
+        auto start = std::chrono::high_resolution_clock::now();
+        Fingerprinter fp(_colors);
+        std::unordered_map<std::string, Colored::UnfoldCache::PlaceEntry> places;
+        std::unordered_map<std::string, Colored::UnfoldCache::TransitionEntry> transitions;
+        cache._replayedPlaces = cache._replayedTransitions = 0;
+        cache._unfoldedPlaces.clear();
+        cache._unfoldedTransitions.clear();
+
+        // what a transition needs to know about the places it is connected to
+        std::vector<Colored::UnfoldCache::Fingerprint> placeFacts(_places.size());
+        for (uint32_t i = 0; i < _places.size(); ++i) {
+            auto& place = _places[i];
+            placeFacts[i] = mix(mix(fp.type(place.type), place.name), (uint64_t)place.inhibiting);
+            placeFacts[i] = mix(placeFacts[i], (uint64_t)_sumPlaces[i]);
+
+            auto h = placeFacts[i];
+            auto marking = place.marking;
+            for (auto [color, count] : marking)
+                h = mix(mix(h, fp.color(color)), (uint64_t)count);
+            for (auto& inv : place.invariants)
+                h = mix(mix(mix(h, (uint64_t)inv.isBoundStrict()), (uint64_t)inv.getBound()), fp.color(inv.getColor()));
+            h = mix(mix(h, std::get<0>(_placelocations[i])), std::get<1>(_placelocations[i]));
+
+            auto it = cache._places.find(place.name);
+            if (it != cache._places.end() && it->second.fingerprint == h) {
+                auto& entry = it->second;
+                for (auto& call : entry.calls)
+                    call(builder);
+                _ptplacenames[place.name] = entry.names;
+                if (!entry.sumName.empty())
+                    _sumPlacesNames[place.name] = entry.sumName;
+                places.emplace(place.name, std::move(entry));
+                ++cache._replayedPlaces;
+                continue;
+            }
+            Colored::UnfoldCache::PlaceEntry entry;
+            entry.fingerprint = h;
+            RecordingBuilder recorder(builder, entry.calls);
+            unfoldPlace(recorder, place);
+            cache._unfoldedPlaces.push_back(place.name);
+            entry.names = _ptplacenames[place.name];
+            entry.sumName = findSumName(place.name);
+            places.emplace(place.name, std::move(entry));
+        }
+
+        if (_output_stream) {
+            (*_output_stream) << "\nBINDINGS FOR EACH UNFOLDED TRANSITION\n";
+            (*_output_stream) << "<bindings>\n";
+        }
+
+        for (uint32_t i = 0; i < _transitions.size(); ++i) {
+            auto& transition = _transitions[i];
+            auto h = mix(fp.expression(transition.guard), transition.name);
+            h = mix(mix(h, (uint64_t)transition.player), (uint64_t)transition.urgent);
+            h = mix(mix(h, (uint64_t)transition.distribution), (uint64_t)transition.firingMode);
+            for (auto p : transition.distributionParams)
+                h = mix(h, p);
+            h = mix(h, transition.weight);
+            h = mix(mix(h, std::get<0>(_transitionlocations[i])), std::get<1>(_transitionlocations[i]));
+            for (auto& arc : transition.arcs) {
+                h = mix(mix(h, placeFacts[arc.place]), fp.expression(arc.expr));
+                h = mix(mix(mix(h, (uint64_t)arc.input), (uint64_t)arc.inhibitor), (uint64_t)arc.weight);
+                h = mix(h, fp.intervals(arc.interval));
+            }
+            for (auto& arc : transition.transport) {
+                h = mix(mix(h, placeFacts[arc.source]), placeFacts[arc.destination]);
+                h = mix(mix(h, fp.expression(arc.in_expr)), fp.expression(arc.out_expr));
+                h = mix(mix(h, (uint64_t)arc.weight), fp.intervals(arc.interval));
+            }
+            auto inhibitors = _inhibitorArcs.find(i);
+            if (inhibitors != _inhibitorArcs.end())
+                for (auto& arc : inhibitors->second)
+                    h = mix(mix(h, placeFacts[arc.place]), (uint64_t)arc.weight);
+
+            auto it = cache._transitions.find(transition.name);
+            if (it != cache._transitions.end() && it->second.fingerprint == h &&
+                (_output_stream == nullptr || it->second.hasBindings)) {
+                auto& entry = it->second;
+                for (auto& call : entry.calls)
+                    call(builder);
+                _pttransitionnames[transition.name] = entry.names;
+                if (_output_stream)
+                    (*_output_stream) << entry.bindings;
+                transitions.emplace(transition.name, std::move(entry));
+                ++cache._replayedTransitions;
+                continue;
+            }
+            Colored::UnfoldCache::TransitionEntry entry;
+            entry.fingerprint = h;
+            RecordingBuilder recorder(builder, entry.calls);
+            // the bindings are kept as well, such that they can be printed when replaying
+            auto* out = _output_stream;
+            std::stringstream bindings;
+            if (out)
+                _output_stream = &bindings;
+            unfoldTransition(recorder, transition);
+            if (out) {
+                _output_stream = out;
+                entry.hasBindings = true;
+                entry.bindings = bindings.str();
+                (*_output_stream) << entry.bindings;
+            }
+            entry.names = _pttransitionnames[transition.name];
+            cache._unfoldedTransitions.push_back(transition.name);
+            transitions.emplace(transition.name, std::move(entry));
+        }
+
+        if (_output_stream) {
+            (*_output_stream) << "</bindings>\n";
+        }
+
+        cache._places = std::move(places);
+        cache._transitions = std::move(transitions);
+        auto end = std::chrono::high_resolution_clock::now();
+        _time = (std::chrono::duration_cast<std::chrono::microseconds>(end - start).count())*0.000001;
+    }
+}
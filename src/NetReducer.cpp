@@ -0,0 +1,205 @@
+/*
+ * File:   NetReducer.cpp
+ */
+
+#include "NetReducer.h"
+#include "errorcodes.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+namespace unfoldtacpn {
+    void NetReducer::addPlace(const std::string& name, int tokens, bool strict, int bound,
+                              double x, double y) {
+        _places.push_back(Place{name, tokens, strict, bound, x, y});
+    }
+
+    void NetReducer::addTransition(const std::string& name, int player, bool urgent,
+                                   double x, double y, int distrib, std::vector<double> distribParam1,
+                                   double weight, int firingMode) {
+        _transitions.push_back(Transition{name, player, urgent, x, y, distrib, std::move(distribParam1), weight, firingMode});
+    }
+
+    void NetReducer::addInputArc(const std::string& place, const std::string& transition,
+                                 bool inhibitor, int weight,
+                                 bool lstrict, bool ustrict, int lower, int upper) {
+        _arcs.push_back(Arc{Arc::Input, place, transition, "", inhibitor, weight, lstrict, ustrict, lower, upper});
+    }
+
+    void NetReducer::addOutputArc(const std::string& transition, const std::string& place, int weight) {
+        _arcs.push_back(Arc{Arc::Output, place, transition, "", false, weight, false, false, 0, 0});
+    }
+
+    void NetReducer::addTransportArc(const std::string& source, const std::string& transition,
+                                     const std::string& target, int weight,
+                                     bool lstrict, bool ustrict, int lower, int upper) {
+        _arcs.push_back(Arc{Arc::Transport, source, transition, target, false, weight, lstrict, ustrict, lower, upper});
+    }
+
+    const std::vector<std::string>& NetReducer::mergedTransitions(const std::string& transition) const {
+        static const std::vector<std::string> none;
+        auto it = _merged.find(transition);
+        return it == _merged.end() ? none : it->second;
+    }
+
+    void NetReducer::reduce() {
+        std::unordered_map<std::string, uint32_t> placeIds, transitionIds;
+        for (uint32_t p = 0; p < _places.size(); ++p)
+            placeIds[_places[p].name] = p;
+        for (uint32_t t = 0; t < _transitions.size(); ++t)
+            transitionIds[_transitions[t].name] = t;
+        auto id = [](const std::unordered_map<std::string, uint32_t>& ids, const std::string& name) {
+            auto it = ids.find(name);
+            if (it == ids.end()) {
+                std::cerr << "ERROR: arc refers to the unknown place or transition " << name << std::endl;
+                exit(ErrorCode);
+            }
+            return it->second;
+        };
+
+        // a transition can fire once every place it takes tokens from can be
+        // marked, ignoring time, which over-approximates what can fire
+        std::vector<uint32_t> missing(_transitions.size(), 0);
+        std::vector<std::vector<uint32_t>> consumers(_places.size()), produces(_transitions.size());
+        for (auto& arc : _arcs) {
+            auto t = id(transitionIds, arc.transition);
+            auto p = id(placeIds, arc.place);
+            if (arc.kind == Arc::Output) {
+                if (arc.weight > 0)
+                    produces[t].push_back(p);
+            } else if (!arc.inhibitor && arc.weight > 0) {
+                consumers[p].push_back(t);
+                ++missing[t];
+                if (arc.kind == Arc::Transport)
+                    produces[t].push_back(id(placeIds, arc.target));
+            }
+        }
+
+        std::vector<bool> marked(_places.size(), false), live(_transitions.size(), false);
+        std::vector<uint32_t> waiting;
+        auto mark = [&](uint32_t p) {
+            if (!marked[p]) {
+                marked[p] = true;
+                waiting.push_back(p);
+            }
+        };
+        auto fire = [&](uint32_t t) {
+            live[t] = true;
+            for (auto p : produces[t])
+                mark(p);
+        };
+        for (uint32_t t = 0; t < _transitions.size(); ++t)
+            if (missing[t] == 0)
+                fire(t);
+        for (uint32_t p = 0; p < _places.size(); ++p)
+            if (_places[p].tokens > 0)
+                mark(p);
+        while (!waiting.empty()) {
+            auto p = waiting.back();
+            waiting.pop_back();
+            for (auto t : consumers[p])
+                if (--missing[t] == 0)
+                    fire(t);
+        }
+
+        // inhibitor arcs from places which are never marked always allow firing
+        std::vector<bool> keepArc(_arcs.size(), false), used(_places.size(), false);
+        std::vector<std::vector<uint32_t>> arcsOf(_transitions.size());
+        for (uint32_t a = 0; a < _arcs.size(); ++a) {
+            auto& arc = _arcs[a];
+            auto t = id(transitionIds, arc.transition);
+            auto p = id(placeIds, arc.place);
+            if (!live[t] || (arc.inhibitor && !marked[p]))
+                continue;
+            keepArc[a] = true;
+            arcsOf[t].push_back(a);
+            used[p] = true;
+            if (arc.kind == Arc::Transport)
+                used[id(placeIds, arc.target)] = true;
+        }
+
+        std::vector<bool> keepPlace(_places.size(), true);
+        for (uint32_t p = 0; p < _places.size(); ++p) {
+            auto& place = _places[p];
+            if (used[p] || (place.tokens > 0 && place.bound != std::numeric_limits<int>::max()))
+                continue;
+            keepPlace[p] = false;
+            _removedPlaces[place.name] = place.tokens;
+        }
+
+        // transitions are compared on their attributes and their sorted arcs
+        std::unordered_map<std::string, uint32_t> signatures;
+        std::vector<bool> keepTransition(live);
+        std::vector<double> weights(_transitions.size());
+        for (uint32_t t = 0; t < _transitions.size(); ++t) {
+            auto& transition = _transitions[t];
+            weights[t] = transition.weight;
+            if (!live[t]) {
+                _removedTransitions.push_back(transition.name);
+                continue;
+            }
+            if (transition.distrib != 0)
+                continue;
+            std::vector<std::string> arcs;
+            for (auto a : arcsOf[t]) {
+                auto& arc = _arcs[a];
+                std::string sig = std::to_string(arc.kind) + ',' + std::to_string(id(placeIds, arc.place));
+                if (arc.kind == Arc::Transport)
+                    sig += ',' + std::to_string(id(placeIds, arc.target));
+                sig += ',' + std::to_string(arc.inhibitor) + ',' + std::to_string(arc.weight);
+                if (arc.kind != Arc::Output)
+                    sig += ',' + std::to_string(arc.lstrict) + ',' + std::to_string(arc.ustrict) + ',' +
+                           std::to_string(arc.lower) + ',' + std::to_string(arc.upper);
+                arcs.push_back(std::move(sig));
+            }
+            std::sort(arcs.begin(), arcs.end());
+            std::string signature = std::to_string(transition.player) + ',' + std::to_string(transition.urgent) + ',' +
+                                    std::to_string(transition.firingMode) + ',' + std::to_string(transition.distribParams.size());
+            for (auto& param : transition.distribParams)
+                signature.append((const char*)&param, sizeof(param));
+            for (auto& arc : arcs)
+                signature += ';' + arc;
+            auto res = signatures.emplace(std::move(signature), t);
+            if (res.second)
+                continue;
+            auto kept = res.first->second;
+            keepTransition[t] = false;
+            weights[kept] += transition.weight;
+            _merged[_transitions[kept].name].push_back(transition.name);
+        }
+
+        for (uint32_t p = 0; p < _places.size(); ++p) {
+            if (!keepPlace[p])
+                continue;
+            auto& place = _places[p];
+            _builder.addPlace(place.name, place.tokens, place.strict, place.bound, place.x, place.y);
+        }
+        for (uint32_t t = 0; t < _transitions.size(); ++t) {
+            if (!keepTransition[t])
+                continue;
+            auto& transition = _transitions[t];
+            _builder.addTransition(transition.name, transition.player, transition.urgent, transition.x, transition.y,
+                                   transition.distrib, transition.distribParams, weights[t], transition.firingMode);
+        }
+        for (uint32_t a = 0; a < _arcs.size(); ++a) {
+            auto& arc = _arcs[a];
+            if (!keepArc[a] || !keepTransition[id(transitionIds, arc.transition)])
+                continue;
+            switch (arc.kind) {
+                case Arc::Input:
+                    _builder.addInputArc(arc.place, arc.transition, arc.inhibitor, arc.weight,
+                                         arc.lstrict, arc.ustrict, arc.lower, arc.upper);
+                    break;
+                case Arc::Output:
+                    _builder.addOutputArc(arc.transition, arc.place, arc.weight);
+                    break;
+                case Arc::Transport:
+                    _builder.addTransportArc(arc.place, arc.transition, arc.target, arc.weight,
+                                             arc.lstrict, arc.ustrict, arc.lower, arc.upper);
+                    break;
+            }
+        }
+    }
+}
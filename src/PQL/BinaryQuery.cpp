@@ -0,0 +1,385 @@
+/*
+ * File:   BinaryQuery.cpp
+ *
+ * Compact binary form of queries. Every node is a kind byte followed by its
+ * operands. Place names are numbered in the order they are first written and
+ * referred to by number afterwards, expansions of colored places shared by
+ * several queries are written once. Integers are stored in host byte order,
+ * the encoding is only meant to be read back in the process that wrote it.
+ */
+
+#include "PQL/PQL.h"
+#include "PQL/Visitor.h"
+
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+
+namespace unfoldtacpn {
+    namespace PQL {
+        namespace {
+            const char MAGIC[8] = {'T', 'A', 'P', 'N', 'Q', 'R', 'Y', '1'};
+
+            enum Kind : uint8_t {
+                Not, And, Or, LessThan, LessThanEq, Equal, NotEqual,
+                Deadlock, True, False,
+                Control, EF, EG, AG, AF, EX, AX, EU, AU, PF, PG,
+                Place, ColoredPlace, Literal, Plus, Multiply, Minus, Subtract,
+                Shared
+            };
+
+            struct BinaryQueryError {};
+
+            class Encoder : public Visitor {
+            public:
+                std::string& data;
+
+                Encoder(std::string& data) : data(data) {}
+
+                template<typename T>
+                void put(T value) {
+                    static_assert(std::is_trivially_copyable<T>::value, "only plain values can be written");
+                    data.append((const char*)&value, sizeof(T));
+                }
+
+                void put(const std::string& value) {
+                    put<uint32_t>(value.size());
+                    data.append(value);
+                }
+
+                void place(const std::string& name) {
+                    auto res = _places.emplace(name, _places.size());
+                    put<uint32_t>(res.first->second);
+                    if (res.second)
+                        put(name);
+                }
+
+            protected:
+                void unary(Kind kind, const Condition_ptr& cond) {
+                    put(kind);
+                    cond->visit(*this);
+                }
+
+                void binary(Kind kind, const Condition* cond) {
+                    auto compare = static_cast<const CompareCondition*>(cond);
+                    put(kind);
+                    (*compare)[0]->visit(*this);
+                    (*compare)[1]->visit(*this);
+                }
+
+                template<typename T>
+                void nary(Kind kind, const T* element) {
+                    put(kind);
+                    put<uint32_t>(std::distance(element->begin(), element->end()));
+                    for (auto& e : *element)
+                        e->visit(*this);
+                }
+
+                void proba(Kind kind, const ProbaCondition* element) {
+                    put(kind);
+                    put(element->settings());
+                    put<uint32_t>(element->getObservables().size());
+                    for (auto& obs : element->getObservables()) {
+                        put(std::get<0>(obs));
+                        std::get<1>(obs)->visit(*this);
+                    }
+                    (*element)[0]->visit(*this);
+                }
+
+                void _accept(const NotCondition* element) override { unary(Not, (*element)[0]); }
+                void _accept(const AndCondition* element) override { nary(And, element); }
+                void _accept(const OrCondition* element) override { nary(Or, element); }
+                void _accept(const LessThanCondition* element) override { binary(LessThan, element); }
+                void _accept(const LessThanOrEqualCondition* element) override { binary(LessThanEq, element); }
+                void _accept(const EqualCondition* element) override { binary(Equal, element); }
+                void _accept(const NotEqualCondition* element) override { binary(NotEqual, element); }
+                void _accept(const DeadlockCondition*) override { put(Deadlock); }
+
+                void _accept(const ControlCondition* element) override { unary(Control, (*element)[0]); }
+                void _accept(const EFCondition* element) override { unary(EF, (*element)[0]); }
+                void _accept(const EGCondition* element) override { unary(EG, (*element)[0]); }
+                void _accept(const AGCondition* element) override { unary(AG, (*element)[0]); }
+                void _accept(const AFCondition* element) override { unary(AF, (*element)[0]); }
+                void _accept(const EXCondition* element) override { unary(EX, (*element)[0]); }
+                void _accept(const AXCondition* element) override { unary(AX, (*element)[0]); }
+                void _accept(const PFCondition* element) override { proba(PF, element); }
+                void _accept(const PGCondition* element) override { proba(PG, element); }
+
+                void _accept(const EUCondition* element) override {
+                    put(EU);
+                    (*element)[0]->visit(*this);
+                    (*element)[1]->visit(*this);
+                }
+
+                void _accept(const AUCondition* element) override {
+                    put(AU);
+                    (*element)[0]->visit(*this);
+                    (*element)[1]->visit(*this);
+                }
+
+                void _accept(const KSafeCondition* element) override {
+                    _accept(static_cast<const ShallowCondition*>(element));
+                }
+
+                void _accept(const BooleanCondition* element) override {
+                    put(element->value() ? True : False);
+                }
+
+                void _accept(const ShallowCondition* element) override {
+                    if (!element->compiled())
+                        throw "Cannot encode a query which is not analyzed";
+                    element->compiled()->visit(*this);
+                }
+
+                void _accept(const UnfoldedIdentifierExpr* element) override {
+                    put(Place);
+                    place(element->name());
+                }
+
+                void _accept(const LiteralExpr* element) override {
+                    put(Literal);
+                    put<int32_t>(element->value());
+                }
+
+                void _accept(const PlusExpr* element) override {
+                    // sums are the expansions of colored places, which queries
+                    // share, the first occurrence is followed by the sum
+                    auto res = _shared.emplace(element, _shared.size());
+                    put(Shared);
+                    put<uint32_t>(res.first->second);
+                    if (res.second)
+                        nary(Plus, element);
+                }
+
+                void _accept(const MultiplyExpr* element) override { nary(Multiply, element); }
+                void _accept(const SubtractExpr* element) override { nary(Subtract, element); }
+
+                void _accept(const MinusExpr* element) override {
+                    put(Minus);
+                    (*element)[0]->visit(*this);
+                }
+
+                // only reached for identifiers which are not analyzed
+                void _accept(const IdentifierExpr* element) override {
+                    put(ColoredPlace);
+                    put(element->name());
+                    put<uint32_t>(element->color().size());
+                    for (auto& c : element->color())
+                        put(c);
+                }
+
+            private:
+                std::unordered_map<std::string, uint32_t> _places;
+                std::unordered_map<const Expr*, uint32_t> _shared;
+            };
+
+            class Decoder {
+            public:
+                Decoder(const char* begin, const char* end) : _pos(begin), _end(end) {}
+
+                template<typename T>
+                T get() {
+                    if ((size_t)(_end - _pos) < sizeof(T))
+                        throw BinaryQueryError();
+                    T value;
+                    memcpy(&value, _pos, sizeof(T));
+                    _pos += sizeof(T);
+                    return value;
+                }
+
+                std::string getString() {
+                    auto size = get<uint32_t>();
+                    if ((size_t)(_end - _pos) < size)
+                        throw BinaryQueryError();
+                    std::string value(_pos, size);
+                    _pos += size;
+                    return value;
+                }
+
+                // the number of elements that follow, each takes at least a
+                // byte so larger counts are rejected before allocating
+                uint32_t count() {
+                    auto n = get<uint32_t>();
+                    if ((size_t)(_end - _pos) < n)
+                        throw BinaryQueryError();
+                    return n;
+                }
+
+                bool done() const {
+                    return _pos == _end;
+                }
+
+                const std::string& place() {
+                    auto id = get<uint32_t>();
+                    if (id == _places.size())
+                        _places.push_back(getString());
+                    else if (id > _places.size())
+                        throw BinaryQueryError();
+                    return _places[id];
+                }
+
+                Condition_ptr condition() {
+                    auto kind = get<Kind>();
+                    switch (kind) {
+                        case Not:
+                            return std::make_shared<NotCondition>(condition());
+                        case And:
+                            return std::make_shared<AndCondition>(conditions());
+                        case Or:
+                            return std::make_shared<OrCondition>(conditions());
+                        case LessThan:
+                            return compare<LessThanCondition>();
+                        case LessThanEq:
+                            return compare<LessThanOrEqualCondition>();
+                        case Equal:
+                            return compare<EqualCondition>();
+                        case NotEqual:
+                            return compare<NotEqualCondition>();
+                        case Deadlock:
+                            return DeadlockCondition::DEADLOCK;
+                        case True:
+                        case False:
+                            return BooleanCondition::getShared(kind == True);
+                        case Control:
+                            return std::make_shared<ControlCondition>(condition());
+                        case EF:
+                            return std::make_shared<EFCondition>(condition());
+                        case EG:
+                            return std::make_shared<EGCondition>(condition());
+                        case AG:
+                            return std::make_shared<AGCondition>(condition());
+                        case AF:
+                            return std::make_shared<AFCondition>(condition());
+                        case EX:
+                            return std::make_shared<EXCondition>(condition());
+                        case AX:
+                            return std::make_shared<AXCondition>(condition());
+                        case EU: {
+                            auto first = condition();
+                            return std::make_shared<EUCondition>(first, condition());
+                        }
+                        case AU: {
+                            auto first = condition();
+                            return std::make_shared<AUCondition>(first, condition());
+                        }
+                        case PF:
+                            return proba<PFCondition>();
+                        case PG:
+                            return proba<PGCondition>();
+                        default:
+                            throw BinaryQueryError();
+                    }
+                }
+
+                Expr_ptr expression() {
+                    switch (get<Kind>()) {
+                        case Place:
+                            return std::make_shared<UnfoldedIdentifierExpr>(place());
+                        case ColoredPlace: {
+                            auto name = getString();
+                            std::vector<std::string> color(count());
+                            for (auto& c : color)
+                                c = getString();
+                            return std::make_shared<IdentifierExpr>(name, std::move(color));
+                        }
+                        case Literal:
+                            return std::make_shared<LiteralExpr>(get<int32_t>());
+                        case Plus:
+                            return std::make_shared<PlusExpr>(expressions());
+                        case Multiply:
+                            return std::make_shared<MultiplyExpr>(expressions());
+                        case Subtract:
+                            return std::make_shared<SubtractExpr>(expressions());
+                        case Minus:
+                            return std::make_shared<MinusExpr>(expression());
+                        case Shared: {
+                            auto id = get<uint32_t>();
+                            if (id == _shared.size()) {
+                                _shared.emplace_back();
+                                auto expr = expression();
+                                _shared[id] = expr;
+                                return expr;
+                            }
+                            if (id > _shared.size() || !_shared[id])
+                                throw BinaryQueryError();
+                            return _shared[id];
+                        }
+                        default:
+                            throw BinaryQueryError();
+                    }
+                }
+
+            private:
+                std::vector<Condition_ptr> conditions() {
+                    std::vector<Condition_ptr> conds(count());
+                    for (auto& c : conds)
+                        c = condition();
+                    return conds;
+                }
+
+                std::vector<Expr_ptr> expressions() {
+                    std::vector<Expr_ptr> exprs(count());
+                    for (auto& e : exprs)
+                        e = expression();
+                    return exprs;
+                }
+
+                template<typename T>
+                Condition_ptr compare() {
+                    auto first = expression();
+                    return std::make_shared<T>(first, expression());
+                }
+
+                template<typename T>
+                Condition_ptr proba() {
+                    auto settings = get<SMCSettings>();
+                    std::vector<Observable> observables(count());
+                    for (auto& obs : observables) {
+                        auto name = getString();
+                        obs = Observable(name, expression());
+                    }
+                    auto res = std::make_shared<T>(settings, condition());
+                    res->setObservables(std::move(observables));
+                    return res;
+                }
+
+                const char* _pos;
+                const char* _end;
+                std::vector<std::string> _places;
+                std::vector<Expr_ptr> _shared;
+            };
+        }
+
+        void to_binary(std::string& out, const std::vector<std::pair<Condition_ptr,std::string>>& queries) {
+            Encoder encoder(out);
+            out.append(MAGIC, sizeof(MAGIC));
+            encoder.put<uint32_t>(queries.size());
+            for (auto& q : queries) {
+                encoder.put(q.second);
+                encoder.put<uint8_t>(q.first != nullptr);
+                if (q.first)
+                    q.first->visit(encoder);
+            }
+        }
+
+        bool from_binary(const std::string& data, std::vector<std::pair<Condition_ptr,std::string>>& queries) {
+            if (data.size() < sizeof(MAGIC) || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)
+                return false;
+            Decoder decoder(data.data() + sizeof(MAGIC), data.data() + data.size());
+            try {
+                std::vector<std::pair<Condition_ptr,std::string>> res(decoder.count());
+                for (auto& q : res) {
+                    q.second = decoder.getString();
+                    if (decoder.get<uint8_t>())
+                        q.first = decoder.condition();
+                }
+                if (!decoder.done())
+                    return false;
+                queries = std::move(res);
+                return true;
+            } catch (const BinaryQueryError&) {
+                return false;
+            }
+        }
+    }
+}
@@ -3,32 +3,95 @@
  */
 
 #include "PQL/Contexts.h"
+#include "PQL/Expressions.h"
 
 
 
 namespace unfoldtacpn {
     namespace PQL {
 
-        bool NamingContext::resolvePlace(const std::string& place, std::unordered_map<uint32_t, std::string>& out)
+        const std::unordered_map<uint32_t, std::string>* NamingContext::resolvePlace(const std::string& place) const
         {
             auto it = _coloredPlaceNames.find(place);
-            if (it != _coloredPlaceNames.end()) {
-                out = it->second;
-                return true;
-            }
-            return false;
+            if (it != _coloredPlaceNames.end())
+                return &it->second;
+            return nullptr;
         }
 
-        bool NamingContext::resolveTransition(const std::string& transition, std::vector<std::string>& out)
+        const std::vector<std::string>* NamingContext::resolveTransition(const std::string& transition) const
         {
             auto it = _coloredTransitionNames.find(transition);
-            if (it != _coloredTransitionNames.end()) {
-                out = it->second;
-                return true;
+            if (it != _coloredTransitionNames.end())
+                return &it->second;
+            return nullptr;
+        }
+
+        template<typename F>
+        const Expr_ptr& NamingContext::cachedExpression(const std::string& key, F&& build)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_placeExpressionsLock);
+                auto it = _placeExpressions.find(key);
+                if (it != _placeExpressions.end())
+                    return it->second;
             }
-            return false;
+            // built without holding the lock, the first expansion stored is kept
+            auto expr = build();
+            std::lock_guard<std::mutex> lock(_placeExpressionsLock);
+            return _placeExpressions.emplace(key, std::move(expr)).first->second;
         }
 
+        const Expr_ptr& NamingContext::placeExpression(const std::string& place)
+        {
+            return cachedExpression(place, [&] { return expandPlace(place); });
+        }
 
+        const Expr_ptr& NamingContext::placeExpression(const std::string& place, const std::vector<std::string>& pattern)
+        {
+            if (pattern.empty())
+                return placeExpression(place);
+            // pattern parts cannot contain the separator, so keys do not collide
+            std::string key = place;
+            for (auto& p : pattern)
+                key += '\0' + p;
+            return cachedExpression(key, [&] { return expandPlace(place, pattern); });
+        }
+
+        Expr_ptr NamingContext::expandPlace(const std::string& place) const
+        {
+            auto names = resolvePlace(place);
+            if (names == nullptr)
+                return nullptr;
+            if (names->size() == 1)
+                return std::make_shared<UnfoldedIdentifierExpr>(names->begin()->second);
+            std::vector<Expr_ptr> identifiers;
+            identifiers.reserve(names->size());
+            for (auto& unfoldedName : *names)
+                identifiers.push_back(std::make_shared<UnfoldedIdentifierExpr>(unfoldedName.second));
+            return std::make_shared<PQL::PlusExpr>(std::move(identifiers));
+        }
+
+        Expr_ptr NamingContext::expandPlace(const std::string& place, const std::vector<std::string>& pattern) const
+        {
+            auto names = resolvePlace(place);
+            if (names == nullptr)
+                return nullptr;
+            std::vector<Expr_ptr> identifiers;
+            for (auto& unfoldedName : *names) {
+                auto color = placeColor(place, unfoldedName.first);
+                if (color.size() != pattern.size())
+                    continue;
+                bool match = true;
+                for (size_t i = 0; match && i < pattern.size(); ++i)
+                    match = pattern[i] == "*" || pattern[i] == color[i];
+                if (match)
+                    identifiers.push_back(std::make_shared<UnfoldedIdentifierExpr>(unfoldedName.second));
+            }
+            if (identifiers.empty())
+                return nullptr;
+            if (identifiers.size() == 1)
+                return identifiers[0];
+            return std::make_shared<PQL::PlusExpr>(std::move(identifiers));
+        }
     }
 }
\ No newline at end of file
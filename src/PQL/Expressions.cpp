@@ -22,6 +22,8 @@
 #include "errorcodes.h"
 #include "PQL/Visitor.h"
 
+#include <cctype>
+
 namespace unfoldtacpn {
     namespace PQL {
 
@@ -62,28 +64,51 @@ namespace unfoldtacpn {
             return;
         }
 
-        Expr_ptr generateUnfoldedIdentifierExpr(NamingContext& context, std::unordered_map<uint32_t,std::string>& names, uint32_t colorIndex) {
-            const std::string& place = names[colorIndex];
-            return std::make_shared<UnfoldedIdentifierExpr>(place);
-        }
-
         void IdentifierExpr::analyze(NamingContext &context) {
-
-            std::unordered_map<uint32_t,std::string> names;
-            if (!context.resolvePlace(_name, names)) {
-                ExprError error("Unable to resolve colored identifier \"" + _name + "\"");
+            _compiled = context.placeExpression(_name, _color);
+            if (!_compiled) {
+                if (context.resolvePlace(_name) == nullptr) {
+                    ExprError error("Unable to resolve colored identifier \"" + _name + "\"");
+                    throw error;
+                }
+                ExprError error("No color of \"" + _name + "\" matches " + colorToString(_color));
                 throw error;
             }
+        }
 
-            if (names.size() == 1) {
-                _compiled = generateUnfoldedIdentifierExpr(context, names, 0);
-            } else {
-                std::vector<Expr_ptr> identifiers;
-                for (auto& unfoldedName : names) {
-                    identifiers.push_back(generateUnfoldedIdentifierExpr(context,names,unfoldedName.first));
-                }
-                _compiled = std::make_shared<PQL::PlusExpr>(std::move(identifiers));
+        bool IdentifierExpr::parseColor(const std::string& text, std::vector<std::string>& color) {
+            color.clear();
+            std::string t;
+            for (char c : text)
+                if (!std::isspace((unsigned char)c))
+                    t += c;
+            bool tuple = t.size() >= 2 && t.front() == '(' && t.back() == ')';
+            if (tuple)
+                t = t.substr(1, t.size() - 2);
+            size_t start = 0;
+            while (true) {
+                auto end = t.find(',', start);
+                auto part = t.substr(start, end == std::string::npos ? end : end - start);
+                if (part.empty() || part.find_first_of("()") != std::string::npos)
+                    return false;
+                color.push_back(std::move(part));
+                if (end == std::string::npos)
+                    break;
+                start = end + 1;
+            }
+            return tuple || color.size() == 1;
+        }
+
+        std::string IdentifierExpr::colorToString(const std::vector<std::string>& color) {
+            if (color.size() == 1)
+                return color[0];
+            std::string res = "(";
+            for (size_t i = 0; i < color.size(); ++i) {
+                if (i != 0)
+                    res += ",";
+                res += color[i];
             }
+            return res + ")";
         }
 
         void UnfoldedIdentifierExpr::analyze(NamingContext& context) {
@@ -1,25 +1,34 @@
-%{
-#include <stdio.h>
+%code requires {
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "PQL/PQL.h"
+}
+
+%{
+#include <stdio.h>
+
 #include "PQL/Expressions.h"
 
 using namespace unfoldtacpn::PQL;
-
-std::shared_ptr<unfoldtacpn::PQL::Condition> result_query;
-extern int pqlqlex();
-void pqlqerror(const char *s) { printf("ERROR: %s\n", s); std::exit(-1); }
 %}
 
 %name-prefix "pqlq"
 %expect 2
 
+/* No global state, the scanner and the result are passed along such that
+   several queries can be parsed at once */
+%define api.pure full
+%lex-param {void* scanner}
+%parse-param {void* scanner} {std::shared_ptr<unfoldtacpn::PQL::Condition>& result}
+
 /* Possible data representation */
 %union {
 	unfoldtacpn::PQL::Expr* expr;
 	unfoldtacpn::PQL::Condition* cond;
 	std::string *string;
+	std::vector<std::string> *strings;
 	int token;
 }
 
@@ -30,7 +39,7 @@ void pqlqerror(const char *s) { printf("ERROR: %s\n", s); std::exit(-1); }
 %token <token> AND OR NOT
 %token <token> EQUAL NEQUAL LESS LESSEQUAL GREATER GREATEREQUAL
 %token <token> PLUS MINUS MULTIPLY
-%token <token> EF AG AF EG PF PG CONTROL COLON
+%token <token> EF AG AF EG PF PG CONTROL COLON COMMA
 
 /* Terminal associativity */
 %left AND OR
@@ -39,17 +48,27 @@ void pqlqerror(const char *s) { printf("ERROR: %s\n", s); std::exit(-1); }
 /* Nonterminal type definition */
 %type <expr> expr term factor
 %type <cond> logic compare query
+%type <string> colorname
+%type <strings> color colors
 
 /* Operator precedence, more possibly coming */
 
+/* Values left on the stack when a parse is aborted */
+%destructor { delete $$; } <expr> <cond> <string> <strings>
+
+%code {
+int pqlqlex(YYSTYPE* lval, void* scanner);
+// the parse is aborted after the message, such that pqlqparse fails
+void pqlqerror(void*, std::shared_ptr<unfoldtacpn::PQL::Condition>&, const char *s) { fprintf(stderr, "ERROR: %s\n", s); }
+}
+
 %start control_query
 
 %%
 
 control_query
-        : CONTROL COLON query { result_query = std::make_shared<ControlCondition>(Condition_ptr($3)); }
-        | query { result_query = Condition_ptr($1); }
-		| error { yyerrok; }
+        : CONTROL COLON query { result = std::make_shared<ControlCondition>(Condition_ptr($3)); }
+        | query { result = Condition_ptr($1); }
         ;
 
 query	: EF logic					{ $$ = new EFCondition(Condition_ptr($2)); }
@@ -89,4 +108,19 @@ term	: term MULTIPLY factor	{ $$ = new MultiplyExpr(std::vector<Expr_ptr>({Expr_
 factor	: LPAREN expr RPAREN	{ $$ = $2; }
 		| INT			{ $$ = new LiteralExpr(atol($1->c_str())); delete $1; }
 		| ID			{ $$ = new IdentifierExpr(*$1); delete $1; }
+		| ID LBRACK color RBRACK	{ $$ = new IdentifierExpr(*$1, std::move(*$3)); delete $1; delete $3; }
+		;
+
+/* P[a] or P[(a,*)] counts the tokens of P with a matching color */
+color	: colorname				{ $$ = new std::vector<std::string>({std::move(*$1)}); delete $1; }
+		| LPAREN colors RPAREN	{ $$ = $2; }
+		;
+
+colors	: colorname				{ $$ = new std::vector<std::string>({std::move(*$1)}); delete $1; }
+		| colors COMMA colorname	{ $1->push_back(std::move(*$3)); delete $3; $$ = $1; }
+		;
+
+colorname	: ID				{ $$ = $1; }
+		| INT					{ $$ = $1; }
+		| MULTIPLY				{ $$ = new std::string("*"); }
 		;
\ No newline at end of file
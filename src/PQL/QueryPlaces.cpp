@@ -0,0 +1,149 @@
+/*
+ * File:   QueryPlaces.cpp
+ */
+
+#include "PQL/QueryPlaces.h"
+
+namespace unfoldtacpn {
+    namespace PQL {
+        void QueryPlaces::reachability(const Condition_ptr& cond) {
+            // nested temporal operators are more than reachability
+            if (_in_quantifier) {
+                _whole_net = true;
+                return;
+            }
+            _in_quantifier = true;
+            cond->visit(*this);
+            _in_quantifier = false;
+        }
+
+        void QueryPlaces::_accept(const NotCondition* element) {
+            (*element)[0]->visit(*this);
+        }
+
+        void QueryPlaces::_accept(const AndCondition* element) {
+            for (auto& c : *element)
+                c->visit(*this);
+        }
+
+        void QueryPlaces::_accept(const OrCondition* element) {
+            for (auto& c : *element)
+                c->visit(*this);
+        }
+
+        void QueryPlaces::_accept(const LessThanCondition* element) {
+            (*element)[0]->visit(*this);
+            (*element)[1]->visit(*this);
+        }
+
+        void QueryPlaces::_accept(const LessThanOrEqualCondition* element) {
+            (*element)[0]->visit(*this);
+            (*element)[1]->visit(*this);
+        }
+
+        void QueryPlaces::_accept(const EqualCondition* element) {
+            (*element)[0]->visit(*this);
+            (*element)[1]->visit(*this);
+        }
+
+        void QueryPlaces::_accept(const NotEqualCondition* element) {
+            (*element)[0]->visit(*this);
+            (*element)[1]->visit(*this);
+        }
+
+        void QueryPlaces::_accept(const DeadlockCondition*) {
+            _whole_net = true;
+        }
+
+        void QueryPlaces::_accept(const EFCondition* element) {
+            reachability((*element)[0]);
+        }
+
+        void QueryPlaces::_accept(const AGCondition* element) {
+            reachability((*element)[0]);
+        }
+
+        // liveness, games and probabilities depend on every transition
+        void QueryPlaces::_accept(const ControlCondition*) {
+            _whole_net = true;
+        }
+
+        void QueryPlaces::_accept(const EGCondition*) {
+            _whole_net = true;
+        }
+
+        void QueryPlaces::_accept(const AFCondition*) {
+            _whole_net = true;
+        }
+
+        void QueryPlaces::_accept(const EXCondition*) {
+            _whole_net = true;
+        }
+
+        void QueryPlaces::_accept(const AXCondition*) {
+            _whole_net = true;
+        }
+
+        void QueryPlaces::_accept(const EUCondition*) {
+            _whole_net = true;
+        }
+
+        void QueryPlaces::_accept(const AUCondition*) {
+            _whole_net = true;
+        }
+
+        void QueryPlaces::_accept(const PFCondition*) {
+            _whole_net = true;
+        }
+
+        void QueryPlaces::_accept(const PGCondition*) {
+            _whole_net = true;
+        }
+
+        // bounds every place of the net
+        void QueryPlaces::_accept(const KSafeCondition*) {
+            _whole_net = true;
+        }
+
+        void QueryPlaces::_accept(const BooleanCondition*) {
+        }
+
+        void QueryPlaces::_accept(const ShallowCondition* element) {
+            if (element->compiled())
+                element->compiled()->visit(*this);
+            else
+                _whole_net = true;
+        }
+
+        // already unfolded, the colored place is not known
+        void QueryPlaces::_accept(const UnfoldedIdentifierExpr*) {
+            _whole_net = true;
+        }
+
+        void QueryPlaces::_accept(const LiteralExpr*) {
+        }
+
+        void QueryPlaces::_accept(const PlusExpr* element) {
+            for (auto& e : *element)
+                e->visit(*this);
+        }
+
+        void QueryPlaces::_accept(const MultiplyExpr* element) {
+            for (auto& e : *element)
+                e->visit(*this);
+        }
+
+        void QueryPlaces::_accept(const MinusExpr* element) {
+            (*element)[0]->visit(*this);
+        }
+
+        void QueryPlaces::_accept(const SubtractExpr* element) {
+            for (auto& e : *element)
+                e->visit(*this);
+        }
+
+        void QueryPlaces::_accept(const IdentifierExpr* element) {
+            _places.insert(element->name());
+        }
+    }
+}
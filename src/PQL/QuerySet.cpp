@@ -0,0 +1,312 @@
+/*
+ * File:   QuerySet.cpp
+ *
+ * Nodes are hash-consed on their kind, their own value and the numbers of
+ * their operands, which are themselves hash-consed first.
+ */
+
+#include "PQL/QuerySet.h"
+#include "PQL/Expressions.h"
+#include "PQL/Visitor.h"
+
+#include <cstring>
+
+namespace unfoldtacpn {
+    namespace PQL {
+        namespace {
+            enum Kind : uint8_t {
+                Not, And, Or, LessThan, LessThanEq, Equal, NotEqual,
+                Deadlock, True, False,
+                Control, EF, EG, AG, AF, EX, AX, EU, AU, PF, PG, Opaque,
+                Place, ColoredPlace, Literal, Plus, Multiply, Minus, Subtract
+            };
+        }
+
+        class QuerySet::Builder : public Visitor {
+        public:
+            Builder(QuerySet& set) : _set(set) {}
+
+            uint32_t add(const Condition_ptr& cond) {
+                auto it = _seen.find(cond.get());
+                if (it != _seen.end())
+                    return it->second.second;
+                _current = cond;
+                cond->visit(*this);
+                _seen.emplace(cond.get(), std::make_pair(cond, _id));
+                return _id;
+            }
+
+            uint32_t add(const Expr_ptr& expr) {
+                auto it = _seen.find(expr.get());
+                if (it != _seen.end())
+                    return it->second.second;
+                // identifiers are the expansion they resolve to
+                auto id = dynamic_cast<const IdentifierExpr*>(expr.get());
+                uint32_t res;
+                if (id && id->compiled()) {
+                    res = add(id->compiled());
+                } else {
+                    _current_expr = expr;
+                    expr->visit(*this);
+                    res = _id;
+                }
+                _seen.emplace(expr.get(), std::make_pair(expr, res));
+                return res;
+            }
+
+        protected:
+            void _accept(const NotCondition* element) override { quantifier<NotCondition>(Not, (*element)[0]); }
+            void _accept(const AndCondition* element) override { logical<AndCondition>(And, element); }
+            void _accept(const OrCondition* element) override { logical<OrCondition>(Or, element); }
+            void _accept(const LessThanCondition* element) override { compare<LessThanCondition>(LessThan, element); }
+            void _accept(const LessThanOrEqualCondition* element) override { compare<LessThanOrEqualCondition>(LessThanEq, element); }
+            void _accept(const EqualCondition* element) override { compare<EqualCondition>(Equal, element); }
+            void _accept(const NotEqualCondition* element) override { compare<NotEqualCondition>(NotEqual, element); }
+
+            void _accept(const DeadlockCondition*) override {
+                auto self = _current;
+                if (!find(key(Deadlock, {})))
+                    _id = insertAtom(self, {});
+            }
+
+            void _accept(const ControlCondition* element) override { quantifier<ControlCondition>(Control, (*element)[0]); }
+            void _accept(const EFCondition* element) override { quantifier<EFCondition>(EF, (*element)[0]); }
+            void _accept(const EGCondition* element) override { quantifier<EGCondition>(EG, (*element)[0]); }
+            void _accept(const AGCondition* element) override { quantifier<AGCondition>(AG, (*element)[0]); }
+            void _accept(const AFCondition* element) override { quantifier<AFCondition>(AF, (*element)[0]); }
+            void _accept(const EXCondition* element) override { quantifier<EXCondition>(EX, (*element)[0]); }
+            void _accept(const AXCondition* element) override { quantifier<AXCondition>(AX, (*element)[0]); }
+            void _accept(const EUCondition* element) override { until<EUCondition>(EU, element); }
+            void _accept(const AUCondition* element) override { until<AUCondition>(AU, element); }
+            void _accept(const PFCondition* element) override { proba<PFCondition>(PF, element); }
+            void _accept(const PGCondition* element) override { proba<PGCondition>(PG, element); }
+
+            void _accept(const KSafeCondition* element) override {
+                _accept(static_cast<const ShallowCondition*>(element));
+            }
+
+            void _accept(const BooleanCondition* element) override {
+                auto self = _current;
+                if (!find(key(element->value() ? True : False, {})))
+                    _id = insertAtom(self, {});
+            }
+
+            void _accept(const ShallowCondition* element) override {
+                if (element->compiled()) {
+                    _id = add(element->compiled());
+                    return;
+                }
+                // a query which is not analyzed is only shared by pointer
+                auto self = _current;
+                find(key(Opaque, {}, std::string((const char*)&element, sizeof(element))));
+                _id = insert(self, {});
+            }
+
+            void _accept(const UnfoldedIdentifierExpr* element) override {
+                auto self = _current_expr;
+                if (!find(key(Place, {}, element->name())))
+                    _id = insert(self, {});
+            }
+
+            void _accept(const LiteralExpr* element) override {
+                auto self = _current_expr;
+                auto value = element->value();
+                if (!find(key(Literal, {}, std::string((const char*)&value, sizeof(value)))))
+                    _id = insert(self, {});
+            }
+
+            void _accept(const PlusExpr* element) override { nary<PlusExpr>(Plus, element); }
+            void _accept(const MultiplyExpr* element) override { nary<MultiplyExpr>(Multiply, element); }
+            void _accept(const SubtractExpr* element) override { nary<SubtractExpr>(Subtract, element); }
+
+            void _accept(const MinusExpr* element) override {
+                auto self = _current_expr;
+                auto op = add((*element)[0]);
+                if (find(key(Minus, {op})))
+                    return;
+                auto& expr = _set._nodes[op].expression;
+                _id = insert(expr == (*element)[0] ? self : std::make_shared<MinusExpr>(expr), {op});
+            }
+
+            // only reached for identifiers which are not analyzed
+            void _accept(const IdentifierExpr* element) override {
+                auto self = _current_expr;
+                auto name = element->name();
+                for (auto& c : element->color())
+                    name += '\0' + c;
+                if (!find(key(ColoredPlace, {}, name)))
+                    _id = insert(self, {});
+            }
+
+        private:
+            std::string key(Kind kind, const std::vector<uint32_t>& operands, const std::string& value = "") {
+                std::string res(1, (char)kind);
+                res.append((const char*)operands.data(), operands.size() * sizeof(uint32_t));
+                res.append(value);
+                return res;
+            }
+
+            // sets _id to the node with the given key, or remembers the key
+            // for the insert that follows
+            bool find(std::string key) {
+                auto it = _nodes.find(key);
+                if (it != _nodes.end()) {
+                    _id = it->second;
+                    return true;
+                }
+                _key = std::move(key);
+                return false;
+            }
+
+            uint32_t insert(const Condition_ptr& cond, std::vector<uint32_t> operands) {
+                uint32_t id = _set._nodes.size();
+                _set._nodes.push_back({cond, nullptr, std::move(operands)});
+                _nodes.emplace(std::move(_key), id);
+                return id;
+            }
+
+            uint32_t insert(const Expr_ptr& expr, std::vector<uint32_t> operands) {
+                uint32_t id = _set._nodes.size();
+                _set._nodes.push_back({nullptr, expr, std::move(operands)});
+                _nodes.emplace(std::move(_key), id);
+                return id;
+            }
+
+            uint32_t insertAtom(const Condition_ptr& cond, std::vector<uint32_t> operands) {
+                auto id = insert(cond, std::move(operands));
+                _set._atoms.push_back(id);
+                return id;
+            }
+
+            template<typename T>
+            void quantifier(Kind kind, const Condition_ptr& operand) {
+                auto self = _current;
+                auto op = add(operand);
+                if (find(key(kind, {op})))
+                    return;
+                auto& cond = _set._nodes[op].condition;
+                _id = insert(cond == operand ? self : std::make_shared<T>(cond), {op});
+            }
+
+            template<typename T>
+            void logical(Kind kind, const LogicalCondition* element) {
+                auto self = _current;
+                std::vector<uint32_t> ops;
+                bool same = true;
+                for (auto& c : *element) {
+                    ops.push_back(add(c));
+                    same &= _set._nodes[ops.back()].condition == c;
+                }
+                if (find(key(kind, ops)))
+                    return;
+                if (same) {
+                    _id = insert(self, std::move(ops));
+                    return;
+                }
+                std::vector<Condition_ptr> conds;
+                for (auto op : ops)
+                    conds.push_back(_set._nodes[op].condition);
+                _id = insert(std::make_shared<T>(std::move(conds)), std::move(ops));
+            }
+
+            template<typename T>
+            void compare(Kind kind, const CompareCondition* element) {
+                auto self = _current;
+                auto first = add((*element)[0]);
+                auto second = add((*element)[1]);
+                if (find(key(kind, {first, second})))
+                    return;
+                auto& a = _set._nodes[first].expression;
+                auto& b = _set._nodes[second].expression;
+                if (a == (*element)[0] && b == (*element)[1])
+                    _id = insertAtom(self, {first, second});
+                else
+                    _id = insertAtom(std::make_shared<T>(a, b), {first, second});
+            }
+
+            template<typename T>
+            void until(Kind kind, const UntilCondition* element) {
+                auto self = _current;
+                auto first = add((*element)[0]);
+                auto second = add((*element)[1]);
+                if (find(key(kind, {first, second})))
+                    return;
+                auto& a = _set._nodes[first].condition;
+                auto& b = _set._nodes[second].condition;
+                if (a == (*element)[0] && b == (*element)[1])
+                    _id = insert(self, {first, second});
+                else
+                    _id = insert(std::make_shared<T>(a, b), {first, second});
+            }
+
+            template<typename T>
+            void proba(Kind kind, const ProbaCondition* element) {
+                // the settings and observables are not compared, so these
+                // are only shared by pointer
+                auto self = _current;
+                auto op = add((*element)[0]);
+                find(key(kind, {op}, std::string((const char*)&element, sizeof(element))));
+                auto& cond = _set._nodes[op].condition;
+                if (cond == (*element)[0]) {
+                    _id = insert(self, {op});
+                    return;
+                }
+                auto res = std::make_shared<T>(element->settings(), cond);
+                res->setObservables(element->getObservables());
+                _id = insert(res, {op});
+            }
+
+            template<typename T>
+            void nary(Kind kind, const NaryExpr* element) {
+                auto self = _current_expr;
+                std::vector<uint32_t> ops;
+                bool same = true;
+                for (auto& e : *element) {
+                    ops.push_back(add(e));
+                    same &= _set._nodes[ops.back()].expression == e;
+                }
+                if (find(key(kind, ops)))
+                    return;
+                if (same) {
+                    _id = insert(self, std::move(ops));
+                    return;
+                }
+                std::vector<Expr_ptr> exprs;
+                for (auto op : ops)
+                    exprs.push_back(_set._nodes[op].expression);
+                _id = insert(std::make_shared<T>(std::move(exprs)), std::move(ops));
+            }
+
+            QuerySet& _set;
+            std::unordered_map<std::string, uint32_t> _nodes;
+            // the pointers are kept alive, such that their addresses are not
+            // reused by conditions the set has not seen
+            std::unordered_map<const void*, std::pair<std::shared_ptr<const void>, uint32_t>> _seen;
+            std::string _key;
+            Condition_ptr _current;
+            Expr_ptr _current_expr;
+            uint32_t _id = NONE;
+        };
+
+        QuerySet::QuerySet() : _builder(std::make_unique<Builder>(*this)) {}
+
+        QuerySet::QuerySet(const std::vector<std::pair<Condition_ptr, std::string>>& queries) : QuerySet() {
+            for (auto& q : queries) {
+                if (q.first == nullptr) {
+                    _queries.emplace_back(nullptr, q.second);
+                    _roots.push_back(NONE);
+                    continue;
+                }
+                auto id = add(q.first);
+                _queries.emplace_back(_nodes[id].condition, q.second);
+                _roots.push_back(id);
+            }
+        }
+
+        QuerySet::~QuerySet() = default;
+
+        uint32_t QuerySet::add(const Condition_ptr& cond) {
+            return _builder->add(cond);
+        }
+    }
+}
@@ -0,0 +1,476 @@
+/*
+ * File:   QuerySimplifier.cpp
+ */
+
+#include "PQL/QuerySimplifier.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <type_traits>
+#include <unordered_set>
+
+namespace unfoldtacpn {
+    namespace PQL {
+        namespace {
+            // bounds at or beyond INF are unbounded, sums of two never overflow
+            constexpr int64_t INF = std::numeric_limits<int64_t>::max() / 4;
+
+            int64_t saturate(int64_t v) {
+                return std::max(-INF, std::min(INF, v));
+            }
+
+            int64_t add(int64_t a, int64_t b) {
+                return saturate(a + b);
+            }
+
+            int64_t multiply(int64_t a, int64_t b) {
+                if (a == 0 || b == 0)
+                    return 0;
+                auto sign = (a < 0) != (b < 0) ? -1 : 1;
+                auto abs_a = std::abs(a), abs_b = std::abs(b);
+                if (abs_a >= INF || abs_b >= INF || abs_a > INF / abs_b)
+                    return sign * INF;
+                return a * b;
+            }
+
+            bool fitsInt(int64_t v) {
+                return v >= std::numeric_limits<int>::min() && v <= std::numeric_limits<int>::max();
+            }
+
+            const LiteralExpr* asLiteral(const Expr_ptr& expr) {
+                return dynamic_cast<const LiteralExpr*>(expr.get());
+            }
+        }
+
+        void PlaceBounds::addPlace(const std::string& name, int tokens, bool strict, int bound,
+                                   double x, double y) {
+            _places[name].initial = tokens;
+            _builder.addPlace(name, tokens, strict, bound, x, y);
+        }
+
+        void PlaceBounds::addTransition(const std::string& name, int player, bool urgent,
+                                        double x, double y, int distrib, std::vector<double> distribParam1,
+                                        double weight, int firingMode) {
+            _builder.addTransition(name, player, urgent, x, y, distrib, std::move(distribParam1), weight, firingMode);
+        }
+
+        void PlaceBounds::addInputArc(const std::string& place, const std::string& transition,
+                                      bool inhibitor, int weight,
+                                      bool lstrict, bool ustrict, int lower, int upper) {
+            if (!inhibitor && weight > 0)
+                _places[place].loses = true;
+            _builder.addInputArc(place, transition, inhibitor, weight, lstrict, ustrict, lower, upper);
+        }
+
+        void PlaceBounds::addOutputArc(const std::string& transition, const std::string& place, int weight) {
+            if (weight > 0)
+                _places[place].gains = true;
+            _builder.addOutputArc(transition, place, weight);
+        }
+
+        void PlaceBounds::addTransportArc(const std::string& source, const std::string& transition,
+                                          const std::string& target, int weight,
+                                          bool lstrict, bool ustrict, int lower, int upper) {
+            if (source != target && weight > 0) {
+                _places[source].loses = true;
+                _places[target].gains = true;
+            }
+            _builder.addTransportArc(source, transition, target, weight, lstrict, ustrict, lower, upper);
+        }
+
+        std::pair<int64_t, int64_t> PlaceBounds::bounds(const std::string& place) const {
+            auto it = _places.find(place);
+            if (it == _places.end())
+                return {0, std::numeric_limits<int64_t>::max()};
+            auto& p = it->second;
+            return {p.loses ? 0 : p.initial,
+                    p.gains ? std::numeric_limits<int64_t>::max() : p.initial};
+        }
+
+        Condition_ptr QuerySimplifier::simplify(const Condition_ptr& cond) {
+            _current = cond;
+            cond->visit(*this);
+            return std::move(_cond);
+        }
+
+        const QuerySimplifier::Simplified& QuerySimplifier::simplify(const Expr_ptr& expr) {
+            auto it = _exprs.find(expr.get());
+            if (it != _exprs.end())
+                return it->second;
+            // identifiers resolve to the expansion shared between queries
+            auto id = dynamic_cast<const IdentifierExpr*>(expr.get());
+            if (id && id->compiled()) {
+                auto s = simplify(id->compiled());
+                s.source = expr;
+                return _exprs[expr.get()] = std::move(s);
+            }
+            _current_expr = expr;
+            expr->visit(*this);
+            _expr.source = expr;
+            // expressions with a single value become literals
+            if (_expr.range.lower == _expr.range.upper && fitsInt(_expr.range.lower) && !asLiteral(_expr.expr))
+                _expr.expr = std::make_shared<LiteralExpr>(_expr.range.lower);
+            return _exprs[expr.get()] = std::move(_expr);
+        }
+
+        void QuerySimplifier::_accept(const NotCondition* element) {
+            auto self = _current;
+            auto cond = simplify((*element)[0]);
+            if (auto b = dynamic_cast<const BooleanCondition*>(cond.get()))
+                _cond = BooleanCondition::getShared(!b->value());
+            else if (auto n = dynamic_cast<const NotCondition*>(cond.get()))
+                _cond = (*n)[0];
+            else if (cond == (*element)[0])
+                _cond = self;
+            else
+                _cond = std::make_shared<NotCondition>(cond);
+        }
+
+        void QuerySimplifier::logical(const LogicalCondition* element, bool conjunction) {
+            auto self = _current;
+            std::vector<Condition_ptr> conds;
+            std::unordered_set<uint32_t> seen;
+            bool changed = false;
+            auto add = [&](const Condition_ptr& cond) {
+                if (seen.insert(_operands.add(cond)).second)
+                    conds.push_back(cond);
+                else
+                    changed = true;
+            };
+            for (auto& c : *element) {
+                auto cond = simplify(c);
+                changed |= cond != c;
+                if (auto b = dynamic_cast<const BooleanCondition*>(cond.get())) {
+                    // false absorbs a conjunction, true a disjunction
+                    if (b->value() != conjunction) {
+                        _cond = cond;
+                        return;
+                    }
+                    changed = true;
+                    continue;
+                }
+                auto nested = dynamic_cast<const LogicalCondition*>(cond.get());
+                if (nested && (conjunction ? dynamic_cast<const AndCondition*>(nested) != nullptr
+                                           : dynamic_cast<const OrCondition*>(nested) != nullptr)) {
+                    for (auto& n : *nested)
+                        add(n);
+                    changed = true;
+                } else {
+                    add(cond);
+                }
+            }
+            if (conds.empty())
+                _cond = BooleanCondition::getShared(conjunction);
+            else if (conds.size() == 1)
+                _cond = conds[0];
+            else if (!changed)
+                _cond = self;
+            else if (conjunction)
+                _cond = std::make_shared<AndCondition>(std::move(conds));
+            else
+                _cond = std::make_shared<OrCondition>(std::move(conds));
+        }
+
+        void QuerySimplifier::_accept(const AndCondition* element) {
+            logical(element, true);
+        }
+
+        void QuerySimplifier::_accept(const OrCondition* element) {
+            logical(element, false);
+        }
+
+        template<typename T>
+        void QuerySimplifier::compare(const CompareCondition* element) {
+            auto self = _current;
+            auto a = simplify((*element)[0]);
+            auto b = simplify((*element)[1]);
+            auto& l = a.range;
+            auto& r = b.range;
+            // an upper bound of INF or a lower bound of -INF is infinite
+            bool finite = l.lower > -INF && l.upper < INF && r.lower > -INF && r.upper < INF;
+            bool alwaysLess = l.upper < r.lower;
+            bool neverLess = r.upper < INF && l.lower >= r.upper;
+            bool alwaysLessEq = l.upper < INF && l.upper <= r.lower;
+            bool neverLessEq = l.lower > r.upper;
+            bool alwaysEq = finite && l.lower == l.upper && r.lower == r.upper && l.lower == r.lower;
+            bool neverEq = l.upper < r.lower || r.upper < l.lower;
+            int decided = -1;
+            if (std::is_same<T, LessThanCondition>::value)
+                decided = alwaysLess ? 1 : neverLess ? 0 : -1;
+            else if (std::is_same<T, LessThanOrEqualCondition>::value)
+                decided = alwaysLessEq ? 1 : neverLessEq ? 0 : -1;
+            else if (std::is_same<T, EqualCondition>::value)
+                decided = alwaysEq ? 1 : neverEq ? 0 : -1;
+            else
+                decided = neverEq ? 1 : alwaysEq ? 0 : -1;
+            if (decided != -1)
+                _cond = BooleanCondition::getShared(decided == 1);
+            else if (a.expr == (*element)[0] && b.expr == (*element)[1])
+                _cond = self;
+            else
+                _cond = std::make_shared<T>(a.expr, b.expr);
+        }
+
+        void QuerySimplifier::_accept(const LessThanCondition* element) {
+            compare<LessThanCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const LessThanOrEqualCondition* element) {
+            compare<LessThanOrEqualCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const EqualCondition* element) {
+            compare<EqualCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const NotEqualCondition* element) {
+            compare<NotEqualCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const DeadlockCondition*) {
+            _cond = _current;
+        }
+
+        template<typename T>
+        void QuerySimplifier::quantifier(const SimpleQuantifierCondition* element) {
+            auto self = _current;
+            auto cond = simplify((*element)[0]);
+            _cond = cond == (*element)[0] ? self : std::make_shared<T>(cond);
+        }
+
+        template<typename T>
+        void QuerySimplifier::until(const UntilCondition* element) {
+            auto self = _current;
+            auto first = simplify((*element)[0]);
+            auto second = simplify((*element)[1]);
+            if (first == (*element)[0] && second == (*element)[1])
+                _cond = self;
+            else
+                _cond = std::make_shared<T>(first, second);
+        }
+
+        template<typename T>
+        void QuerySimplifier::proba(const ProbaCondition* element) {
+            auto self = _current;
+            auto cond = simplify((*element)[0]);
+            if (cond == (*element)[0]) {
+                _cond = self;
+                return;
+            }
+            auto res = std::make_shared<T>(element->settings(), cond);
+            res->setObservables(element->getObservables());
+            _cond = res;
+        }
+
+        void QuerySimplifier::_accept(const ControlCondition* element) {
+            quantifier<ControlCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const EFCondition* element) {
+            quantifier<EFCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const EGCondition* element) {
+            quantifier<EGCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const AGCondition* element) {
+            quantifier<AGCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const AFCondition* element) {
+            quantifier<AFCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const EXCondition* element) {
+            quantifier<EXCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const AXCondition* element) {
+            quantifier<AXCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const EUCondition* element) {
+            until<EUCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const AUCondition* element) {
+            until<AUCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const PFCondition* element) {
+            proba<PFCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const PGCondition* element) {
+            proba<PGCondition>(element);
+        }
+
+        void QuerySimplifier::_accept(const KSafeCondition* element) {
+            _accept(static_cast<const ShallowCondition*>(element));
+        }
+
+        void QuerySimplifier::_accept(const BooleanCondition*) {
+            _cond = _current;
+        }
+
+        void QuerySimplifier::_accept(const ShallowCondition* element) {
+            if (element->compiled())
+                _cond = simplify(element->compiled());
+            else
+                _cond = _current;
+        }
+
+        void QuerySimplifier::_accept(const UnfoldedIdentifierExpr* element) {
+            _expr.expr = _current_expr;
+            _expr.range = {0, INF};
+            if (_bounds) {
+                auto b = _bounds->bounds(element->name());
+                _expr.range = {saturate(b.first), saturate(b.second)};
+            }
+        }
+
+        void QuerySimplifier::_accept(const LiteralExpr* element) {
+            _expr.expr = _current_expr;
+            _expr.range = {element->value(), element->value()};
+        }
+
+        void QuerySimplifier::_accept(const PlusExpr* element) {
+            auto self = _current_expr;
+            std::vector<Expr_ptr> terms;
+            int64_t constant = 0;
+            size_t literals = 0;
+            Range range{0, 0};
+            bool changed = false;
+            auto addTerm = [&](const Expr_ptr& expr) {
+                if (auto lit = asLiteral(expr)) {
+                    constant += lit->value();
+                    ++literals;
+                } else {
+                    terms.push_back(expr);
+                }
+            };
+            for (auto& e : *element) {
+                auto& s = simplify(e);
+                changed |= s.expr != e;
+                range = {add(range.lower, s.range.lower), add(range.upper, s.range.upper)};
+                if (auto nested = dynamic_cast<const PlusExpr*>(s.expr.get())) {
+                    for (auto& n : *nested)
+                        addTerm(n);
+                    changed = true;
+                } else {
+                    addTerm(s.expr);
+                }
+            }
+            _expr.range = range;
+            // the literals are folded into one, unless that overflows
+            if (literals > 1 || (literals == 1 && constant == 0 && !terms.empty()))
+                changed = true;
+            if (!fitsInt(constant)) {
+                _expr.expr = self;
+                return;
+            }
+            if (constant != 0 || terms.empty())
+                terms.push_back(std::make_shared<LiteralExpr>(constant));
+            if (terms.size() == 1)
+                _expr.expr = terms[0];
+            else if (!changed)
+                _expr.expr = self;
+            else
+                _expr.expr = std::make_shared<PlusExpr>(std::move(terms));
+        }
+
+        void QuerySimplifier::_accept(const MultiplyExpr* element) {
+            auto self = _current_expr;
+            std::vector<Expr_ptr> factors;
+            int64_t constant = 1;
+            size_t literals = 0;
+            Range range{1, 1};
+            bool changed = false;
+            auto addFactor = [&](const Expr_ptr& expr) {
+                if (auto lit = asLiteral(expr)) {
+                    constant = multiply(constant, lit->value());
+                    ++literals;
+                } else {
+                    factors.push_back(expr);
+                }
+            };
+            for (auto& e : *element) {
+                auto& s = simplify(e);
+                changed |= s.expr != e;
+                int64_t products[] = {multiply(range.lower, s.range.lower), multiply(range.lower, s.range.upper),
+                                      multiply(range.upper, s.range.lower), multiply(range.upper, s.range.upper)};
+                range = {*std::min_element(products, products + 4), *std::max_element(products, products + 4)};
+                if (auto nested = dynamic_cast<const MultiplyExpr*>(s.expr.get())) {
+                    for (auto& n : *nested)
+                        addFactor(n);
+                    changed = true;
+                } else {
+                    addFactor(s.expr);
+                }
+            }
+            _expr.range = range;
+            if (constant == 0) {
+                _expr.range = {0, 0};
+                _expr.expr = std::make_shared<LiteralExpr>(0);
+                return;
+            }
+            if (literals > 1 || (literals == 1 && constant == 1 && !factors.empty()))
+                changed = true;
+            if (!fitsInt(constant)) {
+                _expr.expr = self;
+                return;
+            }
+            if (constant != 1 || factors.empty())
+                factors.push_back(std::make_shared<LiteralExpr>(constant));
+            if (factors.size() == 1)
+                _expr.expr = factors[0];
+            else if (!changed)
+                _expr.expr = self;
+            else
+                _expr.expr = std::make_shared<MultiplyExpr>(std::move(factors));
+        }
+
+        void QuerySimplifier::_accept(const MinusExpr* element) {
+            auto self = _current_expr;
+            auto& s = simplify((*element)[0]);
+            _expr.range = {-s.range.upper, -s.range.lower};
+            if (auto nested = dynamic_cast<const MinusExpr*>(s.expr.get()))
+                _expr.expr = (*nested)[0];
+            else if (s.expr == (*element)[0])
+                _expr.expr = self;
+            else
+                _expr.expr = std::make_shared<MinusExpr>(s.expr);
+        }
+
+        void QuerySimplifier::_accept(const SubtractExpr* element) {
+            auto self = _current_expr;
+            std::vector<Expr_ptr> exprs;
+            Range range{0, 0};
+            bool changed = false;
+            for (auto& e : *element) {
+                auto& s = simplify(e);
+                changed |= s.expr != e;
+                if (exprs.empty())
+                    range = s.range;
+                else
+                    range = {add(range.lower, -s.range.upper), add(range.upper, -s.range.lower)};
+                exprs.push_back(s.expr);
+            }
+            _expr.range = range;
+            _expr.expr = changed ? std::make_shared<SubtractExpr>(std::move(exprs)) : self;
+        }
+
+        void QuerySimplifier::_accept(const IdentifierExpr* element) {
+            if (element->compiled()) {
+                auto& s = simplify(element->compiled());
+                _expr.expr = s.expr;
+                _expr.range = s.range;
+            } else {
+                _expr.expr = _current_expr;
+                _expr.range = {0, INF};
+            }
+        }
+    }
+}
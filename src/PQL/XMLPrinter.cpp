@@ -18,35 +18,80 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "PQL/XMLPrinter.h"
+
+#include <algorithm>
+#include <charconv>
+
 namespace unfoldtacpn {
     namespace PQL {
-        std::ostream& XMLPrinter::generateTabs() {
-            for(uint32_t i = 0; i < tabs; i++) {
-                os << single_tab;
+        namespace {
+            // indentation is copied from here rather than written space by space
+            const std::string indentation(128, ' ');
+        }
+
+        XMLPrinter::XMLPrinter(std::ostream& os, uint32_t init_tabs, uint32_t tab_size, bool print_newlines) :
+            os(os), tabs(init_tabs), tab_size(tab_size), print_newlines(print_newlines) {
+            buffer.reserve(buffer_size + indentation.size());
+        }
+
+        XMLPrinter::~XMLPrinter() {
+            flush();
+        }
+
+        void XMLPrinter::flush() {
+            os.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+
+        void XMLPrinter::generateTabs() {
+            if (!print_newlines)
+                return;
+            for (uint32_t left = tabs; left > 0;) {
+                auto n = std::min<uint32_t>(left, indentation.size());
+                buffer.append(indentation, 0, n);
+                left -= n;
             }
-            return os;
         }
 
-        void XMLPrinter::openXmlTag(const std::string &tag) {
-            generateTabs() << "<" << tag << ">";
+        void XMLPrinter::openXmlTag(std::string_view tag) {
+            generateTabs();
+            buffer += '<';
+            write(tag);
+            buffer += '>';
             newline();
             tabs++;
         }
 
-        void XMLPrinter::closeXmlTag(const std::string &tag) {
+        void XMLPrinter::closeXmlTag(std::string_view tag) {
             tabs--;
-            generateTabs() << "</" << tag << ">";
+            generateTabs();
+            write("</");
+            write(tag);
+            buffer += '>';
             newline();
         }
 
-        void XMLPrinter::outputLine(const std::string &line) {
-            generateTabs() << line;
+        void XMLPrinter::outputLine(std::string_view line) {
+            generateTabs();
+            write(line);
+            newline();
+        }
+
+        void XMLPrinter::outputPlace(const std::string& place) {
+            openXmlTag("tokens-count");
+            generateTabs();
+            write("<place>");
+            write(place);
+            write("</place>");
             newline();
+            closeXmlTag("tokens-count");
         }
 
-        std::ostream& XMLPrinter::newline() {
-            os << '\n';
-            return os;
+        void XMLPrinter::newline() {
+            if (print_newlines)
+                buffer += '\n';
+            if (buffer.size() >= buffer_size)
+                flush();
         }
 
         void XMLPrinter::_accept(const NotCondition *element) {
@@ -249,13 +294,17 @@ namespace unfoldtacpn {
         }
 
         void XMLPrinter::_accept(const UnfoldedIdentifierExpr *element) {
-            openXmlTag("tokens-count");
-            outputLine("<place>" + element->name() + "</place>");
-            closeXmlTag("tokens-count");
+            outputPlace(element->name());
         }
 
         void XMLPrinter::_accept(const LiteralExpr *element) {
-            outputLine("<integer-constant>" + std::to_string(element->value()) + "</integer-constant>");
+            char value[16];
+            auto end = std::to_chars(value, value + sizeof(value), element->value()).ptr;
+            generateTabs();
+            write("<integer-constant>");
+            write(std::string_view(value, end - value));
+            write("</integer-constant>");
+            newline();
         }
 
         void XMLPrinter::_accept(const PlusExpr *element) {
@@ -294,8 +343,12 @@ namespace unfoldtacpn {
             }
             else
             {
+                if (element->color().empty()) {
+                    outputPlace(element->name());
+                    return;
+                }
                 openXmlTag("tokens-count");
-                outputLine("<place>" + element->name() + "</place>");
+                outputLine("<place color=\"" + IdentifierExpr::colorToString(element->color()) + "\">" + element->name() + "</place>");
                 closeXmlTag("tokens-count");
             }
         }
@@ -0,0 +1,202 @@
+/*
+ * File:   DecompressingStreambuf.cpp
+ */
+
+#include "PetriParse/DecompressingStreambuf.h"
+#include "errorcodes.h"
+
+#include <cstring>
+#include <iostream>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
+namespace unfoldtacpn {
+class DecompressingStreambuf::Decoder {
+public:
+    enum Status {
+        Ok,
+        End,
+        Error
+    };
+
+    virtual ~Decoder() {}
+
+    // decodes as much of in as fits into out, eof tells that no input follows
+    virtual Status decode(const char* in, size_t inLength, size_t& consumed,
+                          char* out, size_t outLength, size_t& produced, bool eof) = 0;
+};
+
+namespace {
+#ifdef HAVE_ZLIB
+    class GzipDecoder : public DecompressingStreambuf::Decoder {
+    public:
+        GzipDecoder() {
+            memset(&_stream, 0, sizeof(_stream));
+            // 16 selects the gzip wrapper
+            if (inflateInit2(&_stream, 16 + MAX_WBITS) != Z_OK) {
+                std::cerr << "ERROR: Could not initialize zlib" << std::endl;
+                exit(ErrorCode);
+            }
+        }
+
+        ~GzipDecoder() {
+            inflateEnd(&_stream);
+        }
+
+        Status decode(const char* in, size_t inLength, size_t& consumed,
+                      char* out, size_t outLength, size_t& produced, bool eof) override {
+            if (_member_end && inLength == 0 && eof) {
+                consumed = produced = 0;
+                return End;
+            }
+            _member_end = false;
+            _stream.next_in = (Bytef*)in;
+            _stream.avail_in = inLength;
+            _stream.next_out = (Bytef*)out;
+            _stream.avail_out = outLength;
+            auto r = inflate(&_stream, Z_NO_FLUSH);
+            consumed = inLength - _stream.avail_in;
+            produced = outLength - _stream.avail_out;
+            if (r == Z_STREAM_END) {
+                // concatenated members are read as one stream
+                if (eof && _stream.avail_in == 0)
+                    return End;
+                inflateReset(&_stream);
+                _member_end = true;
+                return Ok;
+            }
+            if (r == Z_OK || (r == Z_BUF_ERROR && !eof))
+                return Ok;
+            return Error;
+        }
+
+    private:
+        z_stream _stream;
+        bool _member_end = false;
+    };
+#endif
+
+#ifdef HAVE_LZMA
+    class XzDecoder : public DecompressingStreambuf::Decoder {
+    public:
+        XzDecoder() {
+            if (lzma_stream_decoder(&_stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+                std::cerr << "ERROR: Could not initialize liblzma" << std::endl;
+                exit(ErrorCode);
+            }
+        }
+
+        ~XzDecoder() {
+            lzma_end(&_stream);
+        }
+
+        Status decode(const char* in, size_t inLength, size_t& consumed,
+                      char* out, size_t outLength, size_t& produced, bool eof) override {
+            _stream.next_in = (const uint8_t*)in;
+            _stream.avail_in = inLength;
+            _stream.next_out = (uint8_t*)out;
+            _stream.avail_out = outLength;
+            auto r = lzma_code(&_stream, eof ? LZMA_FINISH : LZMA_RUN);
+            consumed = inLength - _stream.avail_in;
+            produced = outLength - _stream.avail_out;
+            if (r == LZMA_STREAM_END)
+                return End;
+            if (r == LZMA_OK || (r == LZMA_BUF_ERROR && !eof))
+                return Ok;
+            return Error;
+        }
+
+    private:
+        lzma_stream _stream = LZMA_STREAM_INIT;
+    };
+#endif
+}
+
+DecompressingStreambuf::DecompressingStreambuf(std::istream& in, size_t window)
+: _in(in), _input(window), _output(window) {
+    // the magic bytes stay in the input buffer, they are part of the stream
+    while (_length < 6 && fill());
+    _format = detect(_input.data(), _length);
+    switch (_format) {
+        case Gzip:
+#ifdef HAVE_ZLIB
+            _decoder = std::make_unique<GzipDecoder>();
+            break;
+#else
+            std::cerr << "ERROR: Input is gzip compressed, but support for it was not built" << std::endl;
+            exit(ErrorCode);
+#endif
+        case Xz:
+#ifdef HAVE_LZMA
+            _decoder = std::make_unique<XzDecoder>();
+            break;
+#else
+            std::cerr << "ERROR: Input is xz compressed, but support for it was not built" << std::endl;
+            exit(ErrorCode);
+#endif
+        case Plain:
+            break;
+    }
+}
+
+DecompressingStreambuf::~DecompressingStreambuf() {
+}
+
+DecompressingStreambuf::Format DecompressingStreambuf::detect(const char* data, size_t length) {
+    static const unsigned char gzip[] = {0x1f, 0x8b};
+    static const unsigned char xz[] = {0xfd, '7', 'z', 'X', 'Z', 0x00};
+    if (length >= sizeof(gzip) && memcmp(data, gzip, sizeof(gzip)) == 0)
+        return Gzip;
+    if (length >= sizeof(xz) && memcmp(data, xz, sizeof(xz)) == 0)
+        return Xz;
+    return Plain;
+}
+
+bool DecompressingStreambuf::fill() {
+    if (_pos == _length)
+        _pos = _length = 0;
+    if (_length == _input.size() || !_in)
+        return false;
+    _in.read(_input.data() + _length, _input.size() - _length);
+    auto n = _in.gcount();
+    _length += n;
+    return n > 0;
+}
+
+DecompressingStreambuf::int_type DecompressingStreambuf::underflow() {
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+    if (!_decoder) {
+        // plain input is handed out directly from the input buffer
+        if (_pos == _length && !fill())
+            return traits_type::eof();
+        setg(_input.data() + _pos, _input.data() + _pos, _input.data() + _length);
+        _pos = _length;
+        return traits_type::to_int_type(*gptr());
+    }
+    while (!_done) {
+        if (_pos == _length)
+            fill();
+        bool eof = _pos == _length || !_in;
+        size_t consumed = 0, produced = 0;
+        auto status = _decoder->decode(_input.data() + _pos, _length - _pos, consumed,
+                                       _output.data(), _output.size(), produced, eof);
+        _pos += consumed;
+        _done = status == Decoder::End;
+        if (status == Decoder::Error || (status == Decoder::Ok && eof && consumed == 0 && produced == 0)) {
+            std::cerr << "ERROR: Compressed input is corrupt or truncated" << std::endl;
+            exit(ErrorCode);
+        }
+        if (produced > 0) {
+            setg(_output.data(), _output.data(), _output.data() + produced);
+            return traits_type::to_int_type(*gptr());
+        }
+    }
+    return traits_type::eof();
+}
+}
@@ -25,9 +25,20 @@
 #include <limits>
 #include <istream>
 #include <cstring>
+#include <algorithm>
+#include <sstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 
 #include "PetriParse/PNMLParser.h"
+#include "PetriParse/XMLFragmentReader.h"
+#include "PetriParse/DecompressingStreambuf.h"
+#include "ParallelFor.h"
 #include "errorcodes.h"
 
 using namespace unfoldtacpn::PQL;
@@ -37,20 +48,134 @@ inline bool stringToBool(std::string b)
     return b == "true" ? 1 : 0;
 }
 
+// places, transitions and arcs may be parsed by several threads, which must
+// not exit, so their errors are thrown to the thread which started the parse
+template<typename... Args>
+[[noreturn]] void fail(const Args&... args)
+{
+    std::stringstream ss;
+    (ss << ... << args);
+    throw FatalError(ss.str());
+}
+
+// lookup without inserting, such that the maps can be read by several threads
+template<typename M>
+typename M::mapped_type lookup(const M& map, const std::string& key)
+{
+    auto it = map.find(key);
+    return it == map.end() ? nullptr : it->second;
+}
+
 namespace unfoldtacpn {
-void PNMLParser::parse(std::istream& xml,
-        ColoredPetriNetBuilder* builder) {
+void PNMLParser::beginParse(ColoredPetriNetBuilder* builder) {
     //Clear any left overs
     _colorTypes.clear();
 
     //Set the builder
     this->_builder = builder;
 
+    {   // add the default color-type
+        auto ct = unfoldtacpn::Colored::Color::dotConstant().getColorType();
+        _colorTypes["dot"] = ct;
+        builder->addColorType("dot", ct);
+        _global_scope.addType(ct);
+    }
+}
+
+void PNMLParser::endParse() {
+    //Cleanup
+    if(!_transportArcs.empty())
+    {
+        std::cerr << "ERROR: Could not match the following transport-arcs";
+        for(auto& kv : _transportArcs)
+        {
+            std::cerr << "\tgoing through transition " << kv.first.first << " with id " << kv.first.second << std::endl;
+        }
+        std::exit(ErrorCode);
+    }
+    _transportArcs.clear();
+    _deferred_arcs.clear();
+    _transition_ids.clear();
+    _colorTypes.clear();
+}
+
+void PNMLParser::parseConstant(rapidxml::xml_node<>* element) {
+    auto value = atoi(element->first_attribute("value")->value());
+    constantValues[element->first_attribute("name")->value()] = value;
+    _intervals.clear();
+    _invariants.clear();
+    _builder->addConstant(element->first_attribute("name")->value(), value);
+}
+
+void PNMLParser::parse(std::istream& xml,
+        ColoredPetriNetBuilder* builder) {
+    DecompressingStreambuf source(xml);
+    std::istream in(&source);
+    std::vector<char> buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    buffer.push_back('\0');
+    parseBuffer(buffer.data(), builder);
+}
+
+void PNMLParser::parseFile(const std::string& path,
+        ColoredPetriNetBuilder* builder) {
+#ifndef _WIN32
+    // map the file copy-on-write, rapidxml modifies the text in place.
+    // The file is mapped over a zeroed anonymous region which is at least
+    // one byte larger, such that the text is always nul-terminated.
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        size_t size = st.st_size + 1;
+        void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(region != MAP_FAILED)
+        {
+            // compressed files are decompressed while reading them below
+            if(mmap(region, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED &&
+               DecompressingStreambuf::detect((char*)region, st.st_size) == DecompressingStreambuf::Plain)
+            {
+                close(fd);
+                parseBuffer((char*)region, builder);
+                munmap(region, size);
+                return;
+            }
+            munmap(region, size);
+        }
+    }
+    if(fd >= 0)
+        close(fd);
+#endif
+    // fall back to reading the file in one go
+    std::ifstream in(path, std::ios::binary);
+    if(!in)
+    {
+        std::cerr << "ERROR: Could not open the file for reading " << path << std::endl;
+        exit(ErrorCode);
+    }
+    char magic[6];
+    in.read(magic, sizeof(magic));
+    auto format = DecompressingStreambuf::detect(magic, in.gcount());
+    in.clear();
+    in.seekg(0, std::ios::beg);
+    if(format != DecompressingStreambuf::Plain)
+    {
+        parse(in, builder);
+        return;
+    }
+    in.seekg(0, std::ios::end);
+    std::vector<char> buffer((size_t)in.tellg() + 1, '\0');
+    in.seekg(0, std::ios::beg);
+    in.read(buffer.data(), buffer.size() - 1);
+    parseBuffer(buffer.data(), builder);
+}
+
+void PNMLParser::parseBuffer(char* text,
+        ColoredPetriNetBuilder* builder) {
+    beginParse(builder);
+
     //Parser the xml
     rapidxml::xml_document<> doc;
-    std::vector<char> buffer((std::istreambuf_iterator<char>(xml)), std::istreambuf_iterator<char>());
-    buffer.push_back('\0');
-    doc.parse<0>(&buffer[0]);
+    doc.parse<0>(text);
 
     rapidxml::xml_node<>* root = doc.first_node();
 
@@ -65,59 +190,199 @@ void PNMLParser::parse(std::istream& xml,
         exit(ErrorCode);
     }
 
-    auto declarations = root->first_node("declaration");
-    if(declarations == nullptr){
-        declarations = root->first_node("net")->first_node("declaration");
-    }
+    try {
+        auto declarations = root->first_node("declaration");
+        if(declarations == nullptr){
+            declarations = root->first_node("net")->first_node("declaration");
+        }
 
-    {   // add the default color-type
-        auto ct = unfoldtacpn::Colored::Color::dotConstant()->getColorType();
-        _colorTypes["dot"] = ct;
-        builder->addColorType("dot", ct);
-        _global_scope.addType(ct);
-    }
+        if (declarations) {
+            parseDeclarations(declarations);
+        }
 
-    if (declarations) {
-        parseDeclarations(declarations);
-    }
+        for (auto it = root->first_node(); it; it = it->next_sibling()) {
+            if (strcmp(it->name(), "constant") == 0)
+                parseConstant(it);
+             else
+                break;
+        }
 
-    for (auto it = root->first_node(); it; it = it->next_sibling()) {
-        if (strcmp(it->name(), "constant") == 0)
-            constantValues[it->first_attribute("name")->value()] = atoi(it->first_attribute("value")->value());
-         else
-            break;
+        // we need to parse things in order, so first find the nodes
+        node_vector_t regular_arcs, colored_arc, places,
+                      inhib_arcs, trans_arcs, transitions;
+        findNodes(root, colored_arc, regular_arcs, inhib_arcs, trans_arcs, transitions, places);
+        parseNodes(places, [this](auto* p) { return parsePlace(p); });
+        parseNodes(transitions, [this](auto* t) { return parseTransition(t); });
+        parseNodes(regular_arcs, [this](auto* a) { return parseArc(a, false); });
+        parseNodes(inhib_arcs, [this](auto* a) { return parseArc(a, true); });
+        parseNodes(trans_arcs, [this](auto* a) { return parseTransportArc(a); });
+        parseNodes(colored_arc, [this](auto* a) { return handleArc(a); });
+    } catch (const FatalError& error) {
+        std::cerr << error.what() << std::endl;
+        std::exit(ErrorCode);
     }
 
-    // we need to parse things in order, so first find the nodes
-    node_vector_t regular_arcs, colored_arc, places,
-                  inhib_arcs, trans_arcs, transitions;
-    findNodes(root, colored_arc, regular_arcs, inhib_arcs, trans_arcs, transitions, places);
-    for(auto* p : places)
-        parsePlace(p);
-    for(auto* trans : transitions)
-        parseTransition(trans);
-    for(auto* a : regular_arcs)
-        parseArc(a, false);
-    for(auto* ia : inhib_arcs)
-        parseArc(ia, true);
-    for(auto* ta : trans_arcs)
-        parseTransportArc(ta);
-    for(auto* ca : colored_arc)
-        handleArc(ca);
+    endParse();
+}
 
-    //Cleanup
-    if(!_transportArcs.empty())
+// parses the nodes in parallel chunks, but hands them to the builder in document order
+void PNMLParser::parseNodes(const node_vector_t& nodes, const std::function<commit_t(rapidxml::xml_node<>*)>& parser)
+{
+    if(_threads <= 1)
     {
-        std::cerr << "ERROR: Could not match the following transport-arcs";
-        for(auto& kv : _transportArcs)
+        for(auto* n : nodes)
+            parser(n)();
+        return;
+    }
+    std::vector<commit_t> commits(nodes.size());
+    parallelFor(nodes.size(), _threads, [&](size_t i) {
+        commits[i] = parser(nodes[i]);
+    });
+    for(auto& c : commits)
+        c();
+}
+
+void PNMLParser::parseStreaming(std::istream& xml,
+        ColoredPetriNetBuilder* builder) {
+    beginParse(builder);
+
+    // net elements are held back until the declarations are known, which
+    // may come after the net. From then on elements are parsed as they are read.
+    bool declared = false;
+    bool leading_constants = true;
+    size_t seq = 0;
+    std::vector<fragment_ptr> pending;
+
+    auto policy = [&](const std::string& name, size_t depth) {
+        if(depth == 0)
         {
-            std::cerr << "\tgoing through transition " << kv.first.first << " with id " << kv.first.second << std::endl;
+            if(name != "pnml")
+            {
+                std::cerr << "ERROR: expecting <pnml> tag as root-node in xml tree." << std::endl;
+                exit(ErrorCode);
+            }
+            return XMLFragmentReader::Descend;
         }
+        bool constant = name == "constant";
+        if(depth == 1 && !constant)
+            leading_constants = false;
+        if(constant)
+            return depth == 1 && leading_constants ? XMLFragmentReader::Capture : XMLFragmentReader::Descend;
+        if(name == "declaration")
+            return declared ? XMLFragmentReader::Skip : XMLFragmentReader::Capture;
+        if(name == "place" || name == "transition" || name == "arc" ||
+           name == "inputArc" || name == "outputArc" ||
+           name == "transportArc" || name == "inhibitorArc")
+            return XMLFragmentReader::Capture;
+        if(name == "variable")
+        {
+            std::cerr << "ERROR: variable not supported" << std::endl;
+            exit(ErrorCode);
+        }
+        return XMLFragmentReader::Descend;
+    };
+
+    auto handler = [&](const std::string& name, std::vector<char>&& text) {
+        auto fragment = std::make_shared<XMLFragment>(std::move(text));
+        if(name == "constant")
+        {
+            parseConstant(fragment->node());
+        }
+        else if(name == "declaration")
+        {
+            if(declared)
+                return;
+            parseDeclarations(fragment->node());
+            declared = true;
+            for(auto& f : pending)
+                dispatchStreamed(f, seq++);
+            pending.clear();
+        }
+        else if(declared)
+        {
+            dispatchStreamed(fragment, seq++);
+        }
+        else
+        {
+            pending.emplace_back(std::move(fragment));
+        }
+    };
+
+    try {
+        DecompressingStreambuf source(xml);
+        std::istream in(&source);
+        XMLFragmentReader reader(in);
+        if(!reader.read(policy, handler))
+        {
+            std::cerr << "ERROR: Unexpected end of xml document" << std::endl;
+            exit(ErrorCode);
+        }
+
+        for(auto& f : pending)
+            dispatchStreamed(f, seq++);
+        pending.clear();
+
+        // whatever is left refers to undeclared nodes, parse it anyway to report the error
+        std::vector<std::pair<size_t, fragment_ptr>> remaining;
+        for(auto& kv : _deferred_arcs)
+            remaining.insert(remaining.end(), kv.second.begin(), kv.second.end());
+        _deferred_arcs.clear();
+        std::sort(remaining.begin(), remaining.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+        for(auto& r : remaining)
+            handleArc(r.second->node(), r.second)();
+    } catch (const FatalError& error) {
+        std::cerr << error.what() << std::endl;
         std::exit(ErrorCode);
     }
-    _transportArcs.clear();
-    transitions.clear();
-    _colorTypes.clear();
+
+    endParse();
+}
+
+// returns the first endpoint of an arc that is neither a known place nor transition
+const char* PNMLParser::missingEndpoint(rapidxml::xml_node<>* element) {
+    for(auto* attr : {"source", "target", "transition"})
+    {
+        auto* a = element->first_attribute(attr);
+        if(a == nullptr)
+            continue;
+        if(_place_types.count(a->value()) == 0 && _transition_ids.count(a->value()) == 0)
+            return a->value();
+    }
+    return nullptr;
+}
+
+void PNMLParser::releaseDeferred(const std::string& id) {
+    auto it = _deferred_arcs.find(id);
+    if(it == _deferred_arcs.end())
+        return;
+    auto waiting = std::move(it->second);
+    _deferred_arcs.erase(it);
+    for(auto& w : waiting)
+        dispatchStreamed(w.second, w.first);
+}
+
+void PNMLParser::dispatchStreamed(const fragment_ptr& fragment, size_t seq) {
+    auto* element = fragment->node();
+    if(strcmp(element->name(), "place") == 0)
+    {
+        parsePlace(element)();
+        releaseDeferred(element->first_attribute("id")->value());
+    }
+    else if(strcmp(element->name(), "transition") == 0)
+    {
+        parseTransition(element)();
+        _transition_ids.insert(element->first_attribute("id")->value());
+        releaseDeferred(element->first_attribute("id")->value());
+    }
+    else if(auto* missing = missingEndpoint(element))
+    {
+        _deferred_arcs[missing].emplace_back(seq, fragment);
+    }
+    else
+    {
+        handleArc(element, fragment)();
+    }
 }
 
 void PNMLParser::parseDeclarations(rapidxml::xml_node<>* element) {
@@ -127,7 +392,7 @@ void PNMLParser::parseDeclarations(rapidxml::xml_node<>* element) {
         } else if (strcmp(it->name(), "variabledecl") == 0) {
             auto sort = parseUserSort(it);
             auto id = it->first_attribute("id")->value();
-            auto var = new unfoldtacpn::Colored::Variable {id,sort};
+            auto var = _builder->arena().make<unfoldtacpn::Colored::Variable>(unfoldtacpn::Colored::Variable{id,sort});
             checkKeyword(id);
             _variables[id] = var;
         } else {
@@ -138,14 +403,24 @@ void PNMLParser::parseDeclarations(rapidxml::xml_node<>* element) {
 
 void PNMLParser::parseNamedSort(rapidxml::xml_node<>* element) {
     auto type = element->first_node();
-    bool is_product = strcmp(type->name(), "productsort") == 0;
-    std::string id = element->first_attribute("id")->value();
-    auto* ct = is_product?
-              new unfoldtacpn::Colored::ProductType(std::string(element->first_attribute("id")->value())) :
-              new unfoldtacpn::Colored::ColorType(std::string(element->first_attribute("id")->value()));
     if (strcmp(type->name(), "dot") == 0) {
         return;
-    } else if (is_product) {
+    }
+    bool is_product = strcmp(type->name(), "productsort") == 0;
+    bool is_range = strcmp(type->name(), "finiteintrange") == 0;
+    std::string id = element->first_attribute("id")->value();
+    unfoldtacpn::Colored::ColorType* ct = nullptr;
+    if (is_product) {
+        ct = _builder->arena().make<unfoldtacpn::Colored::ProductType>(id);
+    } else if (is_range) {
+        // ranges are kept symbolic, colors are only created once they are used
+        uint32_t start = (uint32_t)atoll(type->first_attribute("start")->value());
+        uint32_t end = (uint32_t)atoll(type->first_attribute("end")->value());
+        ct = _builder->arena().make<unfoldtacpn::Colored::FiniteIntRangeType>(id, start, end);
+    } else {
+        ct = _builder->arena().make<unfoldtacpn::Colored::ColorType>(id);
+    }
+    if (is_product) {
         for (auto it = type->first_node(); it; it = it->next_sibling()) {
             if (strcmp(it->name(), "usersort") == 0) {
                 auto* child_type = _colorTypes[it->first_attribute("declaration")->value()];
@@ -156,14 +431,7 @@ void PNMLParser::parseNamedSort(rapidxml::xml_node<>* element) {
                 throw "Cannot to deal with int-range in product sort";
             }
         }
-    } else if (strcmp(type->name(), "finiteintrange") == 0) {
-        uint32_t start = (uint32_t)atoll(type->first_attribute("start")->value());
-        uint32_t end = (uint32_t)atoll(type->first_attribute("end")->value());
-        for (uint32_t i = start; i<=end;i++) {
-            auto str = std::to_string(i);
-            ct->addColor(str.c_str());
-        }
-    } else {
+    } else if (!is_range) {
         for (auto it = type->first_node(); it; it = it->next_sibling()) {
             auto id = it->first_attribute("id")->value();
             assert(id != nullptr);
@@ -185,20 +453,20 @@ unfoldtacpn::Colored::ArcExpression_ptr PNMLParser::parseArcExpression(rapidxml:
         for (auto it = element->first_node(); it; it = it->next_sibling()) {
             constituents.push_back(parseArcExpression(it, type));
         }
-        return std::make_shared<unfoldtacpn::Colored::AddExpression>(std::move(constituents));
+        return _builder->expressions().make<unfoldtacpn::Colored::AddExpression>(std::move(constituents));
     } else if (strcmp(element->name(), "subtract") == 0) {
         auto left = element->first_node();
         auto right = left->next_sibling();
-        auto res = std::make_shared<unfoldtacpn::Colored::SubtractExpression>(parseArcExpression(left, type), parseArcExpression(right, type));
+        auto res = _builder->expressions().make<unfoldtacpn::Colored::SubtractExpression>(parseArcExpression(left, type), parseArcExpression(right, type));
         auto next = right;
         while ((next = next->next_sibling())) {
-            res = std::make_shared<unfoldtacpn::Colored::SubtractExpression>(res, parseArcExpression(next, type));
+            res = _builder->expressions().make<unfoldtacpn::Colored::SubtractExpression>(res, parseArcExpression(next, type));
         }
         return res;
     } else if (strcmp(element->name(), "scalarproduct") == 0) {
         auto scalar = element->first_node();
         auto ms = scalar->next_sibling();
-        return std::make_shared<unfoldtacpn::Colored::ScalarProductExpression>(parseArcExpression(ms, type), parseNumberConstant(scalar));
+        return _builder->expressions().make<unfoldtacpn::Colored::ScalarProductExpression>(parseArcExpression(ms, type), parseNumberConstant(scalar));
     } else if (strcmp(element->name(), "all") == 0) {
         return parseNumberOfExpression(element->parent(), type);
     } else if (strcmp(element->name(), "subterm") == 0 || strcmp(element->name(), "structure") == 0) {
@@ -213,37 +481,37 @@ unfoldtacpn::Colored::GuardExpression_ptr PNMLParser::parseGuardExpression(rapid
     if (strcmp(element->name(), "lt") == 0 || strcmp(element->name(), "lessthan") == 0) {
         auto left = element->first_node();
         auto right = left->next_sibling();
-        return std::make_shared<unfoldtacpn::Colored::LessThanExpression>(parseColorExpression(left, type), parseColorExpression(right, type));
+        return _builder->expressions().make<unfoldtacpn::Colored::LessThanExpression>(parseColorExpression(left, type), parseColorExpression(right, type));
     } else if (strcmp(element->name(), "gt") == 0 || strcmp(element->name(), "greaterthan") == 0) {
         auto left = element->first_node();
         auto right = left->next_sibling();
-        return std::make_shared<unfoldtacpn::Colored::GreaterThanExpression>(parseColorExpression(left, type), parseColorExpression(right, type));
+        return _builder->expressions().make<unfoldtacpn::Colored::GreaterThanExpression>(parseColorExpression(left, type), parseColorExpression(right, type));
     } else if (strcmp(element->name(), "leq") == 0 || strcmp(element->name(), "lessthanorequal") == 0) {
         auto left = element->first_node();
         auto right = left->next_sibling();
-        return std::make_shared<unfoldtacpn::Colored::LessThanEqExpression>(parseColorExpression(left, type), parseColorExpression(right, type));
+        return _builder->expressions().make<unfoldtacpn::Colored::LessThanEqExpression>(parseColorExpression(left, type), parseColorExpression(right, type));
     } else if (strcmp(element->name(), "geq") == 0 || strcmp(element->name(), "greaterthanorequal") == 0) {
         auto left = element->first_node();
         auto right = left->next_sibling();
-        return std::make_shared<unfoldtacpn::Colored::GreaterThanEqExpression>(parseColorExpression(left, type), parseColorExpression(right, type));
+        return _builder->expressions().make<unfoldtacpn::Colored::GreaterThanEqExpression>(parseColorExpression(left, type), parseColorExpression(right, type));
     } else if (strcmp(element->name(), "eq") == 0 || strcmp(element->name(), "equality") == 0) {
         auto left = element->first_node();
         auto right = left->next_sibling();
-        return std::make_shared<unfoldtacpn::Colored::EqualityExpression>(parseColorExpression(left, type), parseColorExpression(right, type));
+        return _builder->expressions().make<unfoldtacpn::Colored::EqualityExpression>(parseColorExpression(left, type), parseColorExpression(right, type));
     } else if (strcmp(element->name(), "neq") == 0 || strcmp(element->name(), "inequality") == 0) {
         auto left = element->first_node();
         auto right = left->next_sibling();
-        return std::make_shared<unfoldtacpn::Colored::InequalityExpression>(parseColorExpression(left, type), parseColorExpression(right, type));
+        return _builder->expressions().make<unfoldtacpn::Colored::InequalityExpression>(parseColorExpression(left, type), parseColorExpression(right, type));
     } else if (strcmp(element->name(), "not") == 0) {
-        return std::make_shared<unfoldtacpn::Colored::NotExpression>(parseGuardExpression(element->first_node(), type));
+        return _builder->expressions().make<unfoldtacpn::Colored::NotExpression>(parseGuardExpression(element->first_node(), type));
     } else if (strcmp(element->name(), "and") == 0) {
         auto left = element->first_node();
         auto right = left->next_sibling();
-        return std::make_shared<unfoldtacpn::Colored::AndExpression>(parseGuardExpression(left, type), parseGuardExpression(right, type));
+        return _builder->expressions().make<unfoldtacpn::Colored::AndExpression>(parseGuardExpression(left, type), parseGuardExpression(right, type));
     } else if (strcmp(element->name(), "or") == 0) {
         auto left = element->first_node();
         auto right = left->next_sibling();
-        return std::make_shared<unfoldtacpn::Colored::OrExpression>(parseGuardExpression(left, type), parseGuardExpression(right, type));
+        return _builder->expressions().make<unfoldtacpn::Colored::OrExpression>(parseGuardExpression(left, type), parseGuardExpression(right, type));
     } else if (strcmp(element->name(), "subterm") == 0 || strcmp(element->name(), "structure") == 0) {
         return parseGuardExpression(element->first_node(), type);
     }
@@ -255,16 +523,16 @@ unfoldtacpn::Colored::GuardExpression_ptr PNMLParser::parseGuardExpression(rapid
 
 unfoldtacpn::Colored::ColorExpression_ptr PNMLParser::parseColorExpression(rapidxml::xml_node<>* element, const Colored::ColorType* type) {
     if (strcmp(element->name(), "dotconstant") == 0) {
-        return std::make_shared<unfoldtacpn::Colored::DotConstantExpression>();
+        return _builder->expressions().make<unfoldtacpn::Colored::DotConstantExpression>();
     } else if (strcmp(element->name(), "variable") == 0) {
-        return std::make_shared<unfoldtacpn::Colored::VariableExpression>(_variables[element->first_attribute("refvariable")->value()]);
+        return _builder->expressions().make<unfoldtacpn::Colored::VariableExpression>(lookup(_variables, element->first_attribute("refvariable")->value()));
     } else if (strcmp(element->name(), "useroperator") == 0) {
-        return std::make_shared<unfoldtacpn::Colored::UserOperatorExpression>(
-            &(*type)[element->first_attribute("declaration")->value()]);
+        return _builder->expressions().make<unfoldtacpn::Colored::UserOperatorExpression>(
+            (*type)[element->first_attribute("declaration")->value()]);
     } else if (strcmp(element->name(), "successor") == 0) {
-        return std::make_shared<unfoldtacpn::Colored::SuccessorExpression>(parseColorExpression(element->first_node(), type));
+        return _builder->expressions().make<unfoldtacpn::Colored::SuccessorExpression>(parseColorExpression(element->first_node(), type));
     } else if (strcmp(element->name(), "predecessor") == 0) {
-        return std::make_shared<unfoldtacpn::Colored::PredecessorExpression>(parseColorExpression(element->first_node(), type));
+        return _builder->expressions().make<unfoldtacpn::Colored::PredecessorExpression>(parseColorExpression(element->first_node(), type));
     } else if (strcmp(element->name(), "tuple") == 0) {
         std::vector<unfoldtacpn::Colored::ColorExpression_ptr> colors;
         auto* pt = static_cast<const Colored::ProductType*>(type);
@@ -277,9 +545,9 @@ unfoldtacpn::Colored::ColorExpression_ptr PNMLParser::parseColorExpression(rapid
             ++i;
         }
         if(type != &_global_scope)
-            return std::make_shared<unfoldtacpn::Colored::TupleExpression>(std::move(colors), type);
+            return _builder->expressions().make<unfoldtacpn::Colored::TupleExpression>(std::move(colors), type);
         else
-            return std::make_shared<unfoldtacpn::Colored::TupleExpression>(std::move(colors), nullptr);
+            return _builder->expressions().make<unfoldtacpn::Colored::TupleExpression>(std::move(colors), nullptr);
     } else if (strcmp(element->name(), "subterm") == 0 || strcmp(element->name(), "structure") == 0) {
         return parseColorExpression(element->first_node(), type);
     }
@@ -291,16 +559,22 @@ unfoldtacpn::Colored::ColorExpression_ptr PNMLParser::parseColorExpression(rapid
         auto end = intRangeElement->first_attribute("end")->value();
         auto si = atoll(start);
         auto ei = atoll(end);
+        auto matches = [&](const unfoldtacpn::Colored::ColorType* ct) {
+            auto* range = dynamic_cast<const unfoldtacpn::Colored::FiniteIntRangeType*>(ct);
+            return range != nullptr && range->lowerBound() == (uint32_t)si && range->upperBound() == (uint32_t)ei;
+        };
+        // colors are only equal within a type, so the constant belongs to the
+        // sort it is used with whenever that one has these bounds
+        const unfoldtacpn::Colored::ColorType* range = matches(type) ? type : nullptr;
         for(auto [_, ct] : _colorTypes)
         {
-            if(ct->size() != size_t(ei-si)+1) continue;
-            if(ct->begin()->getColorName().compare(start) == 0)
-            {
-                assert(value >= si);
-                const unfoldtacpn::Colored::Color* color = &(*ct)[(size_t)(value-si)];
-                auto res = std::make_shared<unfoldtacpn::Colored::UserOperatorExpression>(color);
-                return std::dynamic_pointer_cast<unfoldtacpn::Colored::ColorExpression>(res);
-            }
+            if(range != nullptr) break;
+            if(matches(ct)) range = ct;
+        }
+        if(range != nullptr)
+        {
+            assert(value >= si);
+            return _builder->expressions().make<unfoldtacpn::Colored::UserOperatorExpression>((*range)[(size_t)(value-si)]);
         }
     }
     assert(false);
@@ -309,7 +583,7 @@ unfoldtacpn::Colored::ColorExpression_ptr PNMLParser::parseColorExpression(rapid
 
 unfoldtacpn::Colored::AllExpression_ptr PNMLParser::parseAllExpression(rapidxml::xml_node<>* element) {
     if (strcmp(element->name(), "all") == 0) {
-        return std::make_shared<unfoldtacpn::Colored::AllExpression>(parseUserSort(element));
+        return _builder->expressions().make<unfoldtacpn::Colored::AllExpression>(parseUserSort(element));
     } else if (strcmp(element->name(), "subterm") == 0) {
         return parseAllExpression(element->first_node());
     }
@@ -321,7 +595,7 @@ const unfoldtacpn::Colored::ColorType* PNMLParser::parseUserSort(rapidxml::xml_n
     if (element) {
         for (auto it = element->first_node(); it; it = it->next_sibling()) {
             if (strcmp(it->name(), "usersort") == 0) {
-                return _colorTypes[it->first_attribute("declaration")->value()];
+                return lookup(_colorTypes, it->first_attribute("declaration")->value());
             } else if (strcmp(it->name(), "structure") == 0
                     || strcmp(it->name(), "type") == 0
                     || strcmp(it->name(), "subterm") == 0) {
@@ -352,13 +626,13 @@ unfoldtacpn::Colored::ArcExpression_ptr PNMLParser::parseNumberOfExpression(rapi
 
     auto allExpr = parseAllExpression(first);
     if (allExpr) {
-        return std::make_shared<unfoldtacpn::Colored::NumberOfExpression>(std::move(allExpr), number);
+        return _builder->expressions().make<unfoldtacpn::Colored::NumberOfExpression>(std::move(allExpr), number);
     } else {
         std::vector<unfoldtacpn::Colored::ColorExpression_ptr> colors;
         for (auto it = first; it; it = it->next_sibling()) {
             colors.push_back(parseColorExpression(it, type));
         }
-        return std::make_shared<unfoldtacpn::Colored::NumberOfExpression>(std::move(colors), number);
+        return _builder->expressions().make<unfoldtacpn::Colored::NumberOfExpression>(std::move(colors), number);
     }
 }
 
@@ -376,12 +650,12 @@ void PNMLParser::collectColorsInTuple(rapidxml::xml_node<>* element,
     } else if (strcmp(element->name(), "all") == 0) {
         std::vector<unfoldtacpn::Colored::ColorExpression_ptr> expressionsToAdd;
         auto expr = parseAllExpression(element);
-        std::unordered_map<uint32_t, std::vector<const unfoldtacpn::Colored::Color *>> constantMap;
+        std::unordered_map<uint32_t, std::vector<unfoldtacpn::Colored::Color>> constantMap;
         uint32_t index = 0;
         expr->getConstants(constantMap, index);
         for(auto& positionColors : constantMap){
             for(auto& color : positionColors.second){
-                expressionsToAdd.push_back(std::make_shared<unfoldtacpn::Colored::UserOperatorExpression>(color));
+                expressionsToAdd.push_back(_builder->expressions().make<unfoldtacpn::Colored::UserOperatorExpression>(color));
             }
         }
         collectedColors.push_back(expressionsToAdd);
@@ -412,12 +686,12 @@ unfoldtacpn::Colored::ArcExpression_ptr PNMLParser::constructAddExpressionFromTu
         for (const auto& color : set) {
             colors.push_back(color);
         }
-        std::shared_ptr<unfoldtacpn::Colored::TupleExpression> tupleExpr = std::make_shared<unfoldtacpn::Colored::TupleExpression>(std::move(colors), type);
+        auto* tupleExpr = _builder->expressions().make<unfoldtacpn::Colored::TupleExpression>(std::move(colors), type);
         std::vector<unfoldtacpn::Colored::ColorExpression_ptr> placeholderVector;
         placeholderVector.push_back(tupleExpr);
-        constituents.emplace_back(std::make_shared<unfoldtacpn::Colored::NumberOfExpression>(std::move(placeholderVector),numberof));
+        constituents.emplace_back(_builder->expressions().make<unfoldtacpn::Colored::NumberOfExpression>(std::move(placeholderVector),numberof));
     }
-    return std::make_shared<unfoldtacpn::Colored::AddExpression>(std::move(constituents));
+    return _builder->expressions().make<unfoldtacpn::Colored::AddExpression>(std::move(constituents));
 }
 
 std::vector<std::vector<unfoldtacpn::Colored::ColorExpression_ptr>> PNMLParser::cartesianProduct
@@ -476,66 +750,79 @@ void PNMLParser::findNodes(rapidxml::xml_node<>* element,
     }
 }
 
-void PNMLParser::handleArc(rapidxml::xml_node<>* element)
+PNMLParser::commit_t PNMLParser::handleArc(rapidxml::xml_node<>* element, const fragment_ptr& owner)
 {
+    if(strcmp(element->name(), "inputArc") == 0 || strcmp(element->name(), "outputArc") == 0)
+        return parseArc(element, false);
+    if(strcmp(element->name(), "inhibitorArc") == 0)
+        return parseArc(element, true);
+    if(strcmp(element->name(), "transportArc") == 0)
+        return parseTransportArc(element);
     auto t = element->first_attribute("type")->value();
     if(t == nullptr ||
        strcmp(t, "normal") == 0 ||
        strcmp(t, "timed") == 0)
     {
-        parseArc(element, false);
+        return parseArc(element, false);
     }
     else if(strcmp(t, "inhibitor") == 0)
     {
-        parseArc(element, true);
+        return parseArc(element, true);
     }
     else if(strcmp(t, "tapnInhibitor") == 0)
     {
-        parseArc(element, true);
+        return parseArc(element, true);
     }
     else if(strcmp(t, "transport") == 0)
     {
-        parseSingleTransportArc(element);
+        // the two halves are matched in document order
+        return [this, element, owner]() { parseSingleTransportArc(element, owner); };
     }
     else
     {
-        std::cerr << "ERROR: Arc type '" << t << "' not supported";
-        std::exit(ErrorCode);
+        fail("ERROR: Arc type '", t, "' not supported");
     }
 }
 
-std::pair<std::string, std::vector<const Colored::Color*>> PNMLParser::parseTimeConstraint(rapidxml::xml_node<> *element) { // parses the inscription and colors belonging to either an interval or invariant and returns it.
+std::pair<const char*, std::vector<Colored::Color>> PNMLParser::parseTimeConstraint(rapidxml::xml_node<> *element) { // parses the inscription and colors belonging to either an interval or invariant and returns it.
     std::string colorTypeName;
-    std::string inscription;
-    std::vector<const Colored::Color*> colors;
+    const char* inscription = "";
+    std::vector<Colored::Color> colors;
     for (auto i = element->first_node(); i; i = i->next_sibling()) {
         if (strcmp(i->name(), "colortype") == 0) {
             colorTypeName = i->first_attribute("name")->value();
 
-            if (_colorTypes.find(colorTypeName) == _colorTypes.end()) {
-                std::cerr << "ERROR: The color type " << colorTypeName << " does not exist" << std::endl;
-                std::exit(ErrorCode);
+            auto* type = lookup(_colorTypes, colorTypeName);
+            if (type == nullptr) {
+                fail("ERROR: The color type ", colorTypeName, " does not exist");
             }
             else {
                 size_t id = 0;
-                auto* type = _colorTypes[colorTypeName];
+                auto* prod = dynamic_cast<const Colored::ProductType*>(type);
                 for (auto it = i->first_node(); it; it = it->next_sibling()) {
                     if (strcmp(it->name(), "color") == 0) {
-                        if(auto* prod = dynamic_cast<const Colored::ProductType*>(type))
+                        if(prod != nullptr)
                         {
-                            colors.emplace_back(&(*prod->getType(id))[it->first_attribute("value")->value()]);
+                            colors.emplace_back((*prod->getType(id))[it->first_attribute("value")->value()]);
                         }
                         else
                         {
-                            colors.emplace_back(&(*type)[it->first_attribute("value")->value()]);
+                            colors.emplace_back((*type)[it->first_attribute("value")->value()]);
                         }
                     }
                     else {
-                        std::cerr << "ERROR: The colortype to the place element " << element->first_attribute("id")->value() << " does not have or should only have colors" << std::endl;
-                        exit(ErrorCode);
+                        fail("ERROR: The colortype to the place element ", element->first_attribute("id")->value(), " does not have or should only have colors");
                     }
                     ++id;
                 }
+                if (prod != nullptr) {
+                    // constraints on tuples are matched against the color of the product type
+                    auto color = prod->getColor(colors);
+                    if (!color) {
+                        fail("ERROR: The colors of a time constraint do not match the color type ", colorTypeName);
+                    }
+                    colors = {*color};
+                }
             }
         } else if (strcmp(i->name(), "inscription") == 0) {
             inscription = i->first_attribute("inscription")->value();
@@ -544,9 +831,9 @@ std::pair<std::string, std::vector<const Colored::Color*>> PNMLParser::parseTime
     return std::make_pair(inscription, colors);
 }
 
-void PNMLParser::parsePlace(rapidxml::xml_node<>* element) {
+PNMLParser::commit_t PNMLParser::parsePlace(rapidxml::xml_node<>* element) {
     double x = 0, y = 0;
-    std::string starInvariant;
+    const char* starInvariant = "";
     std::string id(element->first_attribute("id")->value());
 
     auto initial = element->first_attribute("initialMarking");
@@ -571,25 +858,19 @@ void PNMLParser::parsePlace(rapidxml::xml_node<>* element) {
     }
 
 
-    std::vector<const Colored::Color*> colors;
-    colors.push_back(new Colored::Color());
-    timeInvariants.push_back(Colored::TimeInvariant::createFor(starInvariant, colors, constantValues));
+    timeInvariants.push_back(parseInvariant(starInvariant, {}));
 
     bool found_hl = false;
     // we first need the type
     if(auto* node = element->first_node("type"))
     {
-        _place_types[id] = type = parseUserSort(node);
-    }
-    else
-    {
-        _place_types[id] = _colorTypes["dot"];
+        type = parseUserSort(node);
     }
     for (auto it = element->first_node(); it; it = it->next_sibling()) {
         // name element is ignored
         if (strcmp(it->name(), "colorinvariant") == 0) {
             auto pair = parseTimeConstraint(it);
-            timeInvariants.push_back(Colored::TimeInvariant::createFor(pair.first, pair.second, constantValues));
+            timeInvariants.push_back(parseInvariant(pair.first, Colored::TimeInvariant::createColor(pair.second)));
         } else if (strcmp(it->name(),"hlinitialMarking") == 0) {
             unfoldtacpn::Colored::ExpressionContext::BindingMap binding;
             unfoldtacpn::Colored::ExpressionContext::TypeMap typeMap{{type->getName(), type}};
@@ -601,30 +882,31 @@ void PNMLParser::parsePlace(rapidxml::xml_node<>* element) {
 
     if(initialMarking >= std::numeric_limits<int>::max())
     {
-        std::cerr << "ERROR: Number of tokens in " << id << " exceeded " << std::numeric_limits<int>::max() << std::endl;
-        exit(ErrorCode);
+        fail("ERROR: Number of tokens in ", id, " exceeded ", std::numeric_limits<int>::max());
     }
     //Create place
     if (type == nullptr) {
-        type = _colorTypes["dot"];
+        type = lookup(_colorTypes, "dot");
     }
     if(!found_hl && type->size() == 1)
     {
-        hlinitialMarking = unfoldtacpn::Colored::Multiset(&(*type)[0], initialMarking);
+        hlinitialMarking = unfoldtacpn::Colored::Multiset((*type)[0], initialMarking);
     }
-    _builder->addPlace(id, std::move(hlinitialMarking), type, timeInvariants, x, y);
+    return [this, id, type, x, y, timeInvariants = std::move(timeInvariants), marking = std::move(hlinitialMarking)]() mutable {
+        _place_types[id] = type;
+        _builder->addPlace(id, std::move(marking), type, timeInvariants, x, y);
+    };
 }
 
 unfoldtacpn::Colored::ArcExpression_ptr PNMLParser::parseHLInscriptions(rapidxml::xml_node<>* element, const Colored::ColorType* type)
 {
-    unfoldtacpn::Colored::ArcExpression_ptr expr;
+    unfoldtacpn::Colored::ArcExpression_ptr expr = nullptr;
     bool first = true;
     for (auto it = element->first_node("hlinscription"); it; it = it->next_sibling("hlinscription")) {
         expr = parseArcExpression(it->first_node("structure"), type);
         if(!first)
         {
-            std::cerr << "ERROR: Multiple hlinscription tags in xml" << std::endl;
-            exit(ErrorCode);
+            fail("ERROR: Multiple hlinscription tags in xml");
         }
         first = false;
     }
@@ -633,25 +915,44 @@ unfoldtacpn::Colored::ArcExpression_ptr PNMLParser::parseHLInscriptions(rapidxml
 
 std::vector<Colored::TimeInterval> PNMLParser::parseTimeGuard(rapidxml::xml_node<>* element) {
     auto el = element->first_attribute("inscription");
-    std::vector<const Colored::Color*> colors;
-    colors.push_back(new Colored::Color());
     std::vector<Colored::TimeInterval> intervals;
     if(el == nullptr) {
-        std::string def = "[0,inf)";
-        intervals.push_back(Colored::TimeInterval::createFor(def, colors, constantValues));
+        intervals.push_back(parseInterval("[0,inf)", {}));
     }
     else
     {
-        auto interval = el->value();
-        intervals.push_back(Colored::TimeInterval::createFor(interval, colors, constantValues));
+        intervals.push_back(parseInterval(el->value(), {}));
         for (auto it = element->first_node("colorinterval"); it; it = it->next_sibling("colorinterval")) {
             auto pair = parseTimeConstraint(it);
-            intervals.push_back(Colored::TimeInterval::createFor(pair.first, pair.second, constantValues));
+            intervals.push_back(parseInterval(pair.first, Colored::TimeInterval::createColor(pair.second)));
         }
     }
     return intervals;
 }
 
+// constraint strings repeat a lot, each distinct one is only parsed once
+Colored::TimeInterval PNMLParser::parseInterval(const char* text, const Colored::Color& color) {
+    std::lock_guard<std::mutex> guard(_constraint_lock);
+    auto it = _intervals.find(text);
+    if(it == _intervals.end())
+    {
+        Colored::Color star;
+        it = _intervals.emplace(text, Colored::TimeInterval::createFor(text, {star}, constantValues)).first;
+    }
+    return Colored::TimeInterval(it->second, color);
+}
+
+Colored::TimeInvariant PNMLParser::parseInvariant(const char* text, const Colored::Color& color) {
+    std::lock_guard<std::mutex> guard(_constraint_lock);
+    auto it = _invariants.find(text);
+    if(it == _invariants.end())
+    {
+        Colored::Color star;
+        it = _invariants.emplace(text, Colored::TimeInvariant::createFor(text, {star}, constantValues)).first;
+    }
+    return Colored::TimeInvariant(it->second, color);
+}
+
 int PNMLParser::parseWeight(rapidxml::xml_node<>* element) {
     int weight = 1;
     bool first = true;
@@ -667,8 +968,7 @@ int PNMLParser::parseWeight(rapidxml::xml_node<>* element) {
             assert(weight > 0);
             if(!first)
             {
-                std::cerr << "ERROR: Multiple inscription tags in xml of a arc";
-                exit(ErrorCode);
+                fail("ERROR: Multiple inscription tags in xml of a arc");
             }
             first = false;
         }
@@ -676,7 +976,7 @@ int PNMLParser::parseWeight(rapidxml::xml_node<>* element) {
     return weight;
 }
 
-void PNMLParser::parseArc(rapidxml::xml_node<>* element, bool inhibitor) {
+PNMLParser::commit_t PNMLParser::parseArc(rapidxml::xml_node<>* element, bool inhibitor) {
     std::string source = element->first_attribute("source")->value(),
            target = element->first_attribute("target")->value();
     auto weight = parseWeight(element);
@@ -684,12 +984,11 @@ void PNMLParser::parseArc(rapidxml::xml_node<>* element, bool inhibitor) {
     auto source_is_trans = isTransition(source);
     if(source_is_trans == target_is_trans)
     {
-        std::cerr << "ERROR: at least one of '" << source << "' or '" << target << "' of an arc must be a transition" << std::endl;
-        std::exit(ErrorCode);
+        fail("ERROR: at least one of '", source, "' or '", target, "' of an arc must be a transition");
     }
 
 
-    auto type = _place_types[target_is_trans ? source : target];
+    auto type = lookup(_place_types, target_is_trans ? source : target);
     auto expr = parseHLInscriptions(element, type);
 
     std::vector<Colored::TimeInterval> intervals;
@@ -698,24 +997,21 @@ void PNMLParser::parseArc(rapidxml::xml_node<>* element, bool inhibitor) {
         intervals = parseTimeGuard(element);
     }
 
-    if(weight != 0)
+    if(weight == 0)
     {
-        _builder->addArc(source, target, weight, inhibitor, expr, intervals);
-    }
-    else
-    {
-        std::cerr << "ERROR: Arc from " << source << " to " << target << " has non-sensible weight 0." << std::endl;
-        std::exit(ErrorCode);
+        fail("ERROR: Arc from ", source, " to ", target, " has non-sensible weight 0.");
     }
+    return [this, source, target, weight, inhibitor, expr, intervals = std::move(intervals)]() {
+        _builder->addArc(source, target, weight, inhibitor, expr, intervals);
+    };
 }
 
-void PNMLParser::parseSingleTransportArc(rapidxml::xml_node<>* element)
+void PNMLParser::parseSingleTransportArc(rapidxml::xml_node<>* element, const fragment_ptr& owner)
 {
     const char* tid = element->first_attribute("transportID")->value();
     if(tid == nullptr)
     {
-        std::cerr << "ERROR: Missing transportID on transport-arc." << std::endl;
-        exit(ErrorCode);
+        fail("ERROR: Missing transportID on transport-arc.");
     }
     std::string source	= element->first_attribute("source")->value();
     std::string target	= element->first_attribute("target")->value();
@@ -724,17 +1020,19 @@ void PNMLParser::parseSingleTransportArc(rapidxml::xml_node<>* element)
     // technically isTransition only checks if it is not a place. Due to parsing we know that places are defined
     if(!isTransition(trans))
     {
-        std::cerr << "ERROR: Could not find transition '" << trans << "' for transport arc" << std::endl;
-        std::exit(ErrorCode);
+        fail("ERROR: Could not find transition '", trans, "' for transport arc");
     }
-    auto* other = _transportArcs[{trans,tid}];
-    if(other == nullptr)
+    auto it = _transportArcs.find({trans,tid});
+    if(it == _transportArcs.end())
     {
-        _transportArcs[{trans,tid}] = element;
+        _transportArcs[{trans,tid}] = {element, owner};
     }
     else
     {
-        _transportArcs.erase({trans,tid});
+        // keep the fragment of the other half alive until it has been parsed
+        auto other = it->second.first;
+        auto other_owner = std::move(it->second.second);
+        _transportArcs.erase(it);
         rapidxml::xml_node<>* in = element, *out = other;
         if(target != trans)
         {
@@ -744,35 +1042,33 @@ void PNMLParser::parseSingleTransportArc(rapidxml::xml_node<>* element)
         auto intervals = parseTimeGuard(in);
         source = in->first_attribute("source")->value();
         target = out->first_attribute("target")->value();
-        auto in_expr = parseHLInscriptions(in, _place_types[source]);
-        auto out_expr = parseHLInscriptions(out, _place_types[target]);
+        auto in_expr = parseHLInscriptions(in, lookup(_place_types, source));
+        auto out_expr = parseHLInscriptions(out, lookup(_place_types, target));
         _builder->addTransportArc(source, trans, target, weight, in_expr, out_expr, intervals);
     }
 }
 
-void PNMLParser::parseTransportArc(rapidxml::xml_node<>* element){
+PNMLParser::commit_t PNMLParser::parseTransportArc(rapidxml::xml_node<>* element){
     std::string source	= element->first_attribute("source")->value(),
            transition	= element->first_attribute("transition")->value(),
            target	= element->first_attribute("target")->value();
     auto weight = parseWeight(element);
     auto intervals = parseTimeGuard(element);
-    if(weight != 0)
-    {
-        _builder->addTransportArc(source, transition, target, weight, nullptr, nullptr, intervals);
-    }
-    else
+    if(weight == 0)
     {
-        std::cerr << "ERROR: Arc from " << source << " to " << target << " has non-sensible weight 0." << std::endl;
-        exit(ErrorCode);
+        fail("ERROR: Arc from ", source, " to ", target, " has non-sensible weight 0.");
     }
+    return [this, source, transition, target, weight, intervals = std::move(intervals)]() {
+        _builder->addTransportArc(source, transition, target, weight, nullptr, nullptr, intervals);
+    };
 }
 
-void PNMLParser::parseTransition(rapidxml::xml_node<>* element) {
+PNMLParser::commit_t PNMLParser::parseTransition(rapidxml::xml_node<>* element) {
     double x = 0, y = 0;
     bool urgent = false;
     int player = 0;
     unfoldtacpn::Colored::GuardExpression_ptr expr = nullptr;
-    auto name = element->first_attribute("id")->value();
+    std::string name = element->first_attribute("id")->value();
     Colored::SMC::Distribution distrib = Colored::SMC::Constant;
     Colored::SMC::DistributionParameters distrib_params = { 1.0, 0.0 };
     double weight = 1.0;
@@ -826,14 +1122,14 @@ void PNMLParser::parseTransition(rapidxml::xml_node<>* element) {
         } else if (strcmp(it->name(), "condition") == 0) {
             expr = parseGuardExpression(it->first_node("structure"), &_global_scope);
         } else if (strcmp(it->name(), "conditions") == 0) {
-            std::cerr << "ERROR: Conditions not supported" << std::endl;
-            exit(ErrorCode);
+            fail("ERROR: Conditions not supported");
         } else if (strcmp(it->name(), "assignments") == 0) {
-            std::cerr << "ERROR: Assignments not supported" << std::endl;
-            exit(ErrorCode);
+            fail("ERROR: Assignments not supported");
         }
     }
-    _builder->addTransition(name, expr, player, urgent, x, y, distrib, distrib_params, weight, firingMode);
+    return [=]() {
+        _builder->addTransition(name, expr, player, urgent, x, y, distrib, distrib_params, weight, firingMode);
+    };
 }
 
 std::tuple<Colored::SMC::Distribution, Colored::SMC::DistributionParameters> PNMLParser::parseDistribution(rapidxml::xml_node<>* element) {
@@ -935,8 +1231,7 @@ void PNMLParser::checkKeyword(const char* id)
     auto res = _used_keywords.insert(id).second;
     if(!res)
     {
-        std::cerr << "ERROR: Duplicate use of name " << id << std::endl;
-        std::exit(ErrorCode);
+        fail("ERROR: Duplicate use of name ", id);
     }
 }
 
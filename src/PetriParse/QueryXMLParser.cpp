@@ -17,9 +17,11 @@
  */
 
 #include "PetriParse/QueryXMLParser.h"
+#include "PetriParse/DecompressingStreambuf.h"
+#include "PetriParse/XMLFragmentReader.h"
 #include "PQL/Expressions.h"
 #include "PQL/SMCExpressions.h"
-#include "errorcodes.h"
+#include "ParallelFor.h"
 
 #include <string>
 #include <cstdio>
@@ -39,6 +41,19 @@ int getChildCount(rapidxml::xml_node<> *n)
   return c;
 }
 
+namespace {
+    // thrown by fatal_error, which may run on a worker thread, and reported
+    // by parse on the thread that called it
+    struct QueryXMLError {
+        std::string token;
+    };
+
+    void report(const QueryXMLError& error) {
+        std::cerr << "An error occurred while parsing the query." << std::endl;
+        std::cerr << error.token << std::endl;
+    }
+}
+
 QueryXMLParser::QueryXMLParser() = default;
 
 QueryXMLParser::~QueryXMLParser() = default;
@@ -46,13 +61,20 @@ QueryXMLParser::~QueryXMLParser() = default;
 bool QueryXMLParser::parse(std::istream& xml, const std::set<size_t>& parse_only) {
     //Parse the xml
     rapidxml::xml_document<> doc;
-    vector<char> buffer((istreambuf_iterator<char>(xml)), istreambuf_iterator<char>());
+    unfoldtacpn::DecompressingStreambuf source(xml);
+    std::istream in(&source);
+    vector<char> buffer((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
     buffer.push_back('\0');
     doc.parse<0>(&buffer[0]);
     rapidxml::xml_node<>*  root = doc.first_node();
     bool parsingOK;
     if (root) {
-        parsingOK = parsePropertySet(root, parse_only);
+        try {
+            parsingOK = parsePropertySet(root, parse_only);
+        } catch (const QueryXMLError& error) {
+            report(error);
+            parsingOK = false;
+        }
     } else {
         parsingOK = false;
     }
@@ -61,33 +83,82 @@ bool QueryXMLParser::parse(std::istream& xml, const std::set<size_t>& parse_only
     return parsingOK;
 }
 
+bool QueryXMLParser::parse(std::istream& xml, const std::set<size_t>& parse_only, const QueryHandler& handler) {
+    using unfoldtacpn::XMLFragmentReader;
+    bool parsingOK = true;
+    bool root = false;
+    size_t i = 0;
+    auto empty = []() {
+        QueryItem queryItem;
+        queryItem.query = nullptr;
+        queryItem.parsingResult = QueryItem::PARSING_OK;
+        return queryItem;
+    };
+
+    auto policy = [&](const std::string& name, size_t depth) {
+        if (depth == 0) {
+            root = true;
+            if (name != "property-set") {
+                fprintf(stderr, "ERROR missing property-set\n");
+                parsingOK = false;
+                return XMLFragmentReader::Skip;
+            }
+            return XMLFragmentReader::Descend;
+        }
+        if (parse_only.empty() || parse_only.count(i++) > 0)
+            return XMLFragmentReader::Capture;
+        handler(empty());
+        return XMLFragmentReader::Skip;
+    };
+
+    auto capture = [&](const std::string&, std::vector<char>&& text) {
+        unfoldtacpn::PNMLParser::XMLFragment fragment(std::move(text));
+        auto queryItem = empty();
+        if (!parseProperty(fragment.node(), queryItem))
+            parsingOK = false;
+        handler(std::move(queryItem));
+    };
+
+    unfoldtacpn::DecompressingStreambuf source(xml);
+    std::istream in(&source);
+    XMLFragmentReader reader(in);
+    try {
+        if (!reader.read(policy, capture))
+            return false;
+    } catch (const QueryXMLError& error) {
+        report(error);
+        return false;
+    }
+    return root && parsingOK;
+}
+
 bool QueryXMLParser::parsePropertySet(rapidxml::xml_node<>*  element, const std::set<size_t>& parse_only) {
     if (strcmp(element->name(), "property-set") != 0) {
         fprintf(stderr, "ERROR missing property-set\n");
         return false; // missing property-set element
     }
 
+    // properties which are not selected are left empty
+    std::vector<rapidxml::xml_node<>*> selected;
     size_t i = 0;
     for (auto it = element->first_node(); it; it = it->next_sibling()) {
-        if(parse_only.empty() || parse_only.count(i) > 0)
-        {
-            if (!parseProperty(it)) {
-                return false;
-            }
-        }
-        else
-        {
-            QueryItem queryItem;
-            queryItem.query = nullptr;
-            queryItem.parsingResult = QueryItem::PARSING_OK;
-            queries.push_back(queryItem);
-        }
+        QueryItem queryItem;
+        queryItem.query = nullptr;
+        queryItem.parsingResult = QueryItem::PARSING_OK;
+        queries.push_back(queryItem);
+        selected.push_back(parse_only.empty() || parse_only.count(i) > 0 ? it : nullptr);
         ++i;
     }
-    return true;
+
+    std::vector<char> parsed(selected.size(), true);
+    unfoldtacpn::parallelFor(selected.size(), _threads, [&](size_t i) {
+        if (selected[i] != nullptr)
+            parsed[i] = parseProperty(selected[i], queries[i]);
+    });
+    return std::all_of(parsed.begin(), parsed.end(), [](char ok) { return ok; });
 }
 
-bool QueryXMLParser::parseProperty(rapidxml::xml_node<>*  element) {
+bool QueryXMLParser::parseProperty(rapidxml::xml_node<>*  element, QueryItem& queryItem) {
     if (strcmp(element->name(), "property") != 0) {
         fprintf(stderr, "ERROR missing property\n");
         return false; // unexpected element (only property is allowed)
@@ -116,7 +187,6 @@ bool QueryXMLParser::parseProperty(rapidxml::xml_node<>*  element) {
         return false;
     }
 
-    QueryItem queryItem;
     queryItem.id = id;
     if(tagsOK && smcPtr == nullptr) {
         queryItem.query = parseFormula(formulaPtr);
@@ -135,7 +205,6 @@ bool QueryXMLParser::parseProperty(rapidxml::xml_node<>*  element) {
         queryItem.query = nullptr;
         queryItem.parsingResult = QueryItem::UNSUPPORTED_QUERY;
     }
-    queries.push_back(queryItem);
     return true;
 }
 
@@ -150,10 +219,7 @@ bool QueryXMLParser::parseTags(rapidxml::xml_node<>*  element) {
 }
 
 void QueryXMLParser::fatal_error(const std::string &token) {
-    std::cerr << "An error occurred while parsing the query." << std::endl;
-    std::cerr << token << std::endl;
-    assert(false);
-    exit(ErrorCode);
+    throw QueryXMLError{token};
 }
 
 Condition_ptr QueryXMLParser::parseFormula(rapidxml::xml_node<>*  element) {
@@ -563,13 +629,12 @@ Expr_ptr QueryXMLParser::parseIntegerExpression(rapidxml::xml_node<>*  element)
                 assert(false);
                 return nullptr;
             }
-            string placeName = parsePlace(it);
-            if (placeName.empty())
+            auto id = parsePlaceIdentifier(it);
+            if (!id)
             {
                 assert(false);
                 return nullptr; // invalid place name
             }
-            auto id = std::make_shared<IdentifierExpr>(placeName);
             ids.emplace_back(id);
         }
 
@@ -582,12 +647,12 @@ Expr_ptr QueryXMLParser::parseIntegerExpression(rapidxml::xml_node<>*  element)
 
         return std::make_shared<PlusExpr>(std::move(ids));
     } else if (elementName == "place") { // Shortcut for single places tokens count
-        string placeName = parsePlace(element);
-        if(placeName.empty()) {
+        auto id = parsePlaceIdentifier(element);
+        if(!id) {
             assert(false);
             return nullptr;
         }
-        return std::make_shared<IdentifierExpr>(placeName);
+        return id;
     } else if (elementName == "integer-sum" || elementName == "integer-product") {
         auto children = element->first_node();
         bool isMult = false;
@@ -635,4 +700,18 @@ string QueryXMLParser::parsePlace(rapidxml::xml_node<>*  element) {
     string placeName = element->value();
     placeName.erase(std::remove_if(placeName.begin(), placeName.end(), ::isspace), placeName.end());
     return placeName;
-}
\ No newline at end of file
+}
+
+// <place color="(a,*)">P</place> only counts the tokens of P with a matching color
+Expr_ptr QueryXMLParser::parsePlaceIdentifier(rapidxml::xml_node<>*  element) {
+    string placeName = parsePlace(element);
+    if (placeName.empty())
+        return nullptr;
+    auto colorAttr = element->first_attribute("color");
+    if (colorAttr == nullptr)
+        return std::make_shared<IdentifierExpr>(placeName);
+    std::vector<std::string> color;
+    if (!IdentifierExpr::parseColor(colorAttr->value(), color))
+        return nullptr;
+    return std::make_shared<IdentifierExpr>(placeName, std::move(color));
+}
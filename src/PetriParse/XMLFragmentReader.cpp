@@ -0,0 +1,160 @@
+/*
+ * File:   XMLFragmentReader.cpp
+ */
+
+#include "PetriParse/XMLFragmentReader.h"
+
+#include <cstring>
+#include <limits>
+
+namespace unfoldtacpn {
+XMLFragmentReader::XMLFragmentReader(std::istream& in, size_t window)
+: _in(in), _buffer(window) {
+}
+
+int XMLFragmentReader::get() {
+    if (_pos == _length) {
+        _in.read(_buffer.data(), _buffer.size());
+        _length = _in.gcount();
+        _pos = 0;
+        if (_length == 0)
+            return -1;
+    }
+    return (unsigned char)_buffer[_pos++];
+}
+
+bool XMLFragmentReader::readUntil(std::string& token, const char* end) {
+    auto n = strlen(end);
+    while (token.size() < n || token.compare(token.size() - n, n, end) != 0) {
+        int c = get();
+        if (c < 0)
+            return false;
+        token.push_back((char)c);
+    }
+    return true;
+}
+
+// reads the remainder of a markup token, the leading '<' is already in token
+bool XMLFragmentReader::readMarkup(std::string& token) {
+    int c = get();
+    if (c < 0)
+        return false;
+    token.push_back((char)c);
+    if (c == '?')
+        return readUntil(token, "?>");
+    if (c == '!') {
+        for (size_t i = 0; i < 2; ++i) {
+            if ((c = get()) < 0)
+                return false;
+            token.push_back((char)c);
+        }
+        if (token.compare(0, 4, "<!--") == 0)
+            return readUntil(token, "-->");
+        if (token.compare(0, 4, "<![C") == 0)
+            return readUntil(token, "]]>");
+        // doctype and other declarations, possibly with an internal subset
+        int nesting = token.back() == '[' ? 1 : 0;
+        while (true) {
+            if ((c = get()) < 0)
+                return false;
+            token.push_back((char)c);
+            if (c == '[')
+                ++nesting;
+            else if (c == ']')
+                --nesting;
+            else if (c == '>' && nesting <= 0)
+                return true;
+        }
+    }
+    // start or end tag, '>' may occur in quoted attribute values
+    char quote = 0;
+    while (c != '>' || quote != 0) {
+        if (quote == 0 && (c == '"' || c == '\''))
+            quote = (char)c;
+        else if (c == quote)
+            quote = 0;
+        if ((c = get()) < 0)
+            return false;
+        token.push_back((char)c);
+    }
+    return true;
+}
+
+bool XMLFragmentReader::read(const Policy& policy, const Handler& handler) {
+    const size_t none = std::numeric_limits<size_t>::max();
+    size_t depth = 0;
+    size_t captureDepth = none;
+    size_t skipDepth = none;
+    std::vector<char> capture;
+    std::string captureName;
+    std::string token;
+
+    auto finish = [&]() {
+        capture.push_back('\0');
+        handler(captureName, std::move(capture));
+        capture = std::vector<char>();
+        captureDepth = none;
+    };
+
+    int c;
+    while ((c = get()) >= 0) {
+        if (c != '<') {
+            if (captureDepth != none)
+                capture.push_back((char)c);
+            continue;
+        }
+        token.assign(1, '<');
+        if (!readMarkup(token))
+            return false;
+        bool inside = captureDepth != none || skipDepth != none;
+        if (token[1] == '?' || token[1] == '!') {
+            if (captureDepth != none)
+                capture.insert(capture.end(), token.begin(), token.end());
+            continue;
+        }
+        if (token[1] == '/') {
+            if (depth == 0)
+                return false;
+            --depth;
+            if (captureDepth != none) {
+                capture.insert(capture.end(), token.begin(), token.end());
+                if (depth == captureDepth)
+                    finish();
+            } else if (depth == skipDepth) {
+                skipDepth = none;
+            }
+            continue;
+        }
+
+        bool selfClosing = token[token.size() - 2] == '/';
+        if (inside) {
+            if (captureDepth != none)
+                capture.insert(capture.end(), token.begin(), token.end());
+            if (!selfClosing)
+                ++depth;
+            continue;
+        }
+
+        auto end = token.find_first_of(" \t\r\n/>", 1);
+        std::string name = token.substr(1, end - 1);
+        switch (policy(name, depth)) {
+            case Capture:
+                captureName = std::move(name);
+                capture.assign(token.begin(), token.end());
+                captureDepth = depth;
+                if (selfClosing)
+                    finish();
+                break;
+            case Skip:
+                if (!selfClosing)
+                    skipDepth = depth;
+                break;
+            case Descend:
+                break;
+        }
+        if (!selfClosing)
+            ++depth;
+    }
+    return depth == 0 && captureDepth == none;
+}
+}
@@ -50,10 +50,14 @@
 #include "PQL/Contexts.h"
 #include "PetriParse/QueryXMLParser.h"
 #include "PetriParse/PNMLParser.h"
+#include "PetriParse/DecompressingStreambuf.h"
 #include "PQL/PQL.h"
 #include "errorcodes.h"
 #include "PQL/Expressions.h"
+#include "PQL/QueryPlaces.h"
+#include "PQL/QuerySimplifier.h"
 #include "Colored/ColoredPetriNetBuilder.h"
+#include "ParallelFor.h"
 
 using namespace std;
 using namespace unfoldtacpn;
@@ -61,38 +65,79 @@ using namespace unfoldtacpn::PQL;
 
 namespace unfoldtacpn {
 
-    void context_analysis(const ColoredPetriNetBuilder& cpnBuilder, const std::vector<std::pair<Condition_ptr, std::string> >& queries) {
-        //Context analysis
-        NamingContext context(cpnBuilder.getUnfoldedPlaceNames(),
-            cpnBuilder.getUnfoldedTransitionNames());
-        for (auto& q : queries) {
-            if(q.first)
-                q.first->analyze(context);
+    // resolves the colors of places for color specific atoms such as P[(a,*)]
+    class ColoredNamingContext : public NamingContext {
+    public:
+        ColoredNamingContext(const ColoredPetriNetBuilder& cpnBuilder)
+        : NamingContext(cpnBuilder.getUnfoldedPlaceNames(), cpnBuilder.getUnfoldedTransitionNames()),
+          _cpnBuilder(cpnBuilder) {}
+
+        std::vector<std::string> placeColor(const std::string& place, uint32_t color) const override {
+            return _cpnBuilder.getPlaceColorNames(place, color);
         }
+
+    private:
+        const ColoredPetriNetBuilder& _cpnBuilder;
+    };
+
+    void context_analysis(const ColoredPetriNetBuilder& cpnBuilder, const std::vector<std::pair<Condition_ptr, std::string> >& queries, size_t threads = 1) {
+        //Context analysis, the queries share the context and its expansions
+        ColoredNamingContext context(cpnBuilder);
+        parallelFor(queries.size(), threads, [&](size_t i) {
+            if(queries[i].first)
+                queries[i].first->analyze(context);
+        });
+    }
+
+    void analyze_queries(const ColoredPetriNetBuilder& builder, const std::vector<std::pair<Condition_ptr, std::string>>& queries, size_t threads) {
+        context_analysis(builder, queries, threads);
     }
 
     std::vector<std::pair<Condition_ptr, std::string>> parse_string_queries(const ColoredPetriNetBuilder& builder, istream& qfile) {
+        auto r = parse_string_queries(qfile);
+        context_analysis(builder, r);
+        return r;
+    }
+
+    std::vector<std::pair<Condition_ptr, std::string>> parse_string_queries(istream& qfile) {
+        DecompressingStreambuf source(qfile);
         stringstream buffer;
-        buffer << qfile.rdbuf();
+        buffer << &source;
         string querystring = buffer.str(); // including EF and AG
         std::vector<std::pair<Condition_ptr,std::string>> r;
         auto q = parseQuery(querystring);
         r.emplace_back(q, std::string("unknown"));
-        context_analysis(builder, r);
         return r;
     }
 
-    std::vector<std::pair<Condition_ptr, std::string>> parse_xml_queries(const ColoredPetriNetBuilder& builder, istream& qfile, const std::set<size_t>& to_parse) {
+    std::vector<std::pair<Condition_ptr, std::string>> parse_xml_queries(const ColoredPetriNetBuilder& builder, istream& qfile, const std::set<size_t>& to_parse, size_t threads) {
+        auto conditions = parse_xml_queries(qfile, to_parse, threads);
+        context_analysis(builder, conditions, threads);
+        return conditions;
+    }
+
+    std::vector<std::pair<Condition_ptr, std::string>> parse_xml_queries(istream& qfile, const std::set<size_t>& to_parse, size_t threads) {
         std::vector<std::pair<Condition_ptr, std::string>> conditions;
 
+        // a single thread streams the file, several need all of it at once
         QueryXMLParser parser;
-        if (!parser.parse(qfile, to_parse)) {
+        std::vector<QueryItem> queries;
+        bool parsed;
+        if (threads > 1) {
+            parser.setParseThreads(threads);
+            parsed = parser.parse(qfile, to_parse);
+            queries = std::move(parser.queries);
+        } else {
+            parsed = parser.parse(qfile, to_parse, [&](QueryItem&& q) {
+                queries.push_back(std::move(q));
+            });
+        }
+        if (!parsed) {
             fprintf(stderr, "Error: Failed parsing XML query file\n");
             fprintf(stdout, "DO_NOT_COMPETE\n");
             conditions.clear();
             return conditions;
         }
-        auto queries = std::move(parser.queries);
 
 
         for (size_t i = 0; i < queries.size(); ++i) {
@@ -116,7 +161,26 @@ namespace unfoldtacpn {
             }
 
         }
-        context_analysis(builder, conditions);
         return conditions;
     }
+
+    void unfold_for_queries(ColoredPetriNetBuilder& cpnBuilder, TAPNBuilderInterface& builder, const std::vector<std::pair<Condition_ptr, std::string>>& queries) {
+        QueryPlaces places;
+        for (auto& q : queries) {
+            if(q.first)
+                q.first->visit(places);
+        }
+        if (places.needsWholeNet())
+            cpnBuilder.unfold(builder);
+        else
+            cpnBuilder.unfoldConeOfInfluence(builder, places.places());
+    }
+
+    void simplify_queries(std::vector<std::pair<Condition_ptr, std::string>>& queries, const PlaceBounds& bounds) {
+        QuerySimplifier simplifier(bounds);
+        for (auto& q : queries) {
+            if(q.first)
+                q.first = simplifier.simplify(q.first);
+        }
+    }
 }
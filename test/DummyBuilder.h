@@ -26,6 +26,12 @@ class DummyBuilder : public unfoldtacpn::TAPNBuilderInterface {
             double y = 0) {};
 
     // add a time transition with a unique name
+    virtual void addTransition(const std::string &name, int player, bool urgent,
+            double x, double y,
+            int distrib, std::vector<double> distribParams, double weight, int firingMode) {
+        addTransition(name, player, urgent, x, y);
+    };
+
     virtual void addTransition(const std::string &name, int player, bool urgent,
             double, double) {};
 
@@ -18,11 +18,22 @@
 
 #include "DummyBuilder.h"
 #include "Colored/ColoredPetriNetBuilder.h"
+#include "Colored/Colors.h"
+#include "Colored/Arena.h"
+#include "PetriParse/XMLFragmentReader.h"
+#include "NetReducer.h"
+#include "errorcodes.h"
 
 #include <boost/test/unit_test.hpp>
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <array>
+#include <iterator>
+#include <regex>
+#include <memory>
+#include <algorithm>
+#include <limits>
 
 namespace utf = boost::unit_test;
 
@@ -220,6 +231,63 @@ BOOST_AUTO_TEST_CASE(PlacesBoundsMap) {
     BOOST_REQUIRE_EQUAL(p.n_places, 2);
 }
 
+BOOST_AUTO_TEST_CASE(ProductBoundsMap) {
+
+    class PBuilder : public DummyBuilder {
+
+    public:
+        std::map<std::string, int> bounds;
+        void addPlace(const std::string& name,
+            int tokens,
+            bool strict,
+            int b,
+            double x,
+            double y) {
+            BOOST_REQUIRE_EQUAL(strict, false);
+            bounds[name] = b;
+        }
+
+        virtual void addTransition(const std::string &name, int player, bool urgent,
+            double, double) {
+            BOOST_REQUIRE(false);
+        };
+
+        virtual void addInputArc(const std::string &place,
+            const std::string &transition,
+            bool inhibitor,
+            int weight,
+            bool lstrict, bool ustrict, int lower, int upper) {
+            BOOST_REQUIRE(false);
+        };
+
+        virtual void addOutputArc(const std::string& transition,
+            const std::string& place,
+            int weight) {
+            BOOST_REQUIRE(false);
+        };
+
+        virtual void addTransportArc(const std::string& source,
+            const std::string& transition,
+            const std::string& target, int weight,
+            bool lstrict, bool ustrict, int lower, int upper) {
+            BOOST_REQUIRE(false);
+        }
+    };
+
+    auto f = loadFile("product_inv_map.xml");
+    BOOST_REQUIRE(f);
+    ColoredPetriNetBuilder b;
+    b.parseNet(f);
+    PBuilder p;
+    b.unfold(p);
+    BOOST_REQUIRE_EQUAL(p.bounds.size(), 4);
+    // (1,1), (2,1), (1,2) and (2,2)
+    BOOST_REQUIRE_EQUAL(p.bounds["P0__0"], 4);
+    BOOST_REQUIRE_EQUAL(p.bounds["P0__1"], 2);
+    BOOST_REQUIRE_EQUAL(p.bounds["P0__2"], 1);
+    BOOST_REQUIRE_EQUAL(p.bounds["P0__3"], 4);
+}
+
 BOOST_AUTO_TEST_CASE(RegularArc) {
 
     class PBuilder : public DummyBuilder {
@@ -782,7 +850,7 @@ BOOST_AUTO_TEST_CASE(ColoredGuardTest) {
             if(inhibitor)
             {
                 ++n_inhib;
-                BOOST_REQUIRE(place == "__P2__SUM");
+                BOOST_REQUIRE(place.find("P2__") == 0);
                 BOOST_REQUIRE(transition.find("T0") == 0);
                 BOOST_REQUIRE_EQUAL(weight, 1);
             }
@@ -819,11 +887,13 @@ BOOST_AUTO_TEST_CASE(ColoredGuardTest) {
     b.unfold(p);
     BOOST_REQUIRE_EQUAL(p.n_places["P0"], 2);
     BOOST_REQUIRE_EQUAL(p.n_places["P1"], 2);
-    BOOST_REQUIRE_EQUAL(p.n_places["P2"], 3); // should have sum-place
-    BOOST_REQUIRE(p.seen_sum);
+    // the inhibitor has weight one, so it is put on every color of P2
+    // instead of on a sum-place
+    BOOST_REQUIRE_EQUAL(p.n_places["P2"], 2);
+    BOOST_REQUIRE(!p.seen_sum);
     BOOST_REQUIRE_EQUAL(p.n_trans, 2);
     BOOST_REQUIRE_EQUAL(p.n_input, 4);
-    BOOST_REQUIRE_EQUAL(p.n_inhib, 2);
+    BOOST_REQUIRE_EQUAL(p.n_inhib, 4);
 }
 
 BOOST_AUTO_TEST_CASE(Referendum) {
@@ -1191,6 +1261,141 @@ BOOST_AUTO_TEST_CASE(FiniteIntRange) {
     b.unfold(p);
 }
 
+BOOST_AUTO_TEST_CASE(LargeFiniteIntRange, * utf::timeout(5)) {
+    Colored::FiniteIntRangeType range("big", 1, 1000000);
+    BOOST_REQUIRE_EQUAL(range.size(), 1000000);
+    auto c = range["500000"];
+    BOOST_REQUIRE_EQUAL(c.getId(), 499999);
+    BOOST_REQUIRE_EQUAL(c.toString(), "500000");
+    BOOST_REQUIRE(c == range[(size_t)499999]);
+    BOOST_REQUIRE(!range.findColor("0"));
+    BOOST_REQUIRE(!range.findColor("1000001"));
+    BOOST_REQUIRE(!range.findColor("x"));
+
+    auto last = range["1000000"];
+    BOOST_REQUIRE(++last == range["1"]);
+    BOOST_REQUIRE(--range["1"] == last);
+
+    // enumerating the whole range keeps nothing per color
+    auto color = range[(size_t)0];
+    size_t steps = 0;
+    do {
+        color = ++color;
+        ++steps;
+    } while (color.getId() != 0);
+    BOOST_REQUIRE_EQUAL(steps, range.size());
+
+    // colors of different ranges are only related by value in guards
+    Colored::FiniteIntRangeType small("small", 499999, 500001);
+    BOOST_REQUIRE(small["500000"] != c);
+    BOOST_REQUIRE(Colored::Color::equalValues(small["500000"], c));
+    BOOST_REQUIRE(Colored::Color::lessValue(small["499999"], c));
+    BOOST_REQUIRE(Colored::Color::lessValue(c, small["500001"]));
+    BOOST_REQUIRE(!Colored::Color::lessValue(small["500000"], c));
+}
+
+BOOST_AUTO_TEST_CASE(ColorLookupByName, * utf::timeout(5)) {
+    Colored::ColorType names("names");
+    for (size_t i = 0; i < 100000; ++i) {
+        auto n = "c" + std::to_string(i);
+        names.addColor(n.c_str());
+    }
+    BOOST_REQUIRE_EQUAL(names["c99999"].getId(), 99999);
+    BOOST_REQUIRE(!names.findColor("d"));
+    // parser threads cannot exit, so a missing color is thrown
+    BOOST_REQUIRE_THROW(names["d"], FatalError);
+
+    Colored::FiniteIntRangeType range("range", 1, 10);
+    Colored::ProductType product("product");
+    product.addType(&names);
+    product.addType(&range);
+    auto c = product["(c42,7)"];
+    BOOST_REQUIRE(c == product.getColor({names["c42"], range["7"]}));
+    BOOST_REQUIRE(!product.findColor("(c42)"));
+    BOOST_REQUIRE(!product.findColor("(c42,7,1)"));
+    BOOST_REQUIRE(!product.findColor("(c42,11)"));
+
+    Colored::ScopeType scope;
+    scope.addType(&names);
+    scope.addType(&range);
+    scope.addType(&product);
+    BOOST_REQUIRE(scope["c7"] == names["c7"]);
+    BOOST_REQUIRE(scope["7"] == range["7"]);
+    BOOST_REQUIRE(!scope.findColor("(c42,7)"));
+
+    // colors are handles, the components are recovered from the product type
+    BOOST_REQUIRE_LE(sizeof(Colored::Color), 2 * sizeof(void*));
+    BOOST_REQUIRE(c.isTuple());
+    BOOST_REQUIRE(c[0] == names["c42"]);
+    BOOST_REQUIRE(c[1] == range["7"]);
+    BOOST_REQUIRE_EQUAL(c.toString(), "(c42,7)");
+}
+
+BOOST_AUTO_TEST_CASE(ArenaOwnership) {
+    struct Counted {
+        size_t& count;
+        Counted(size_t& count) : count(count) { ++count; }
+        ~Counted() { --count; }
+    };
+    size_t alive = 0;
+    {
+        Colored::Arena arena(64);
+        for (size_t i = 0; i < 100; ++i) {
+            auto* c = arena.make<Counted>(alive);
+            BOOST_REQUIRE_EQUAL((uintptr_t)c % alignof(Counted), 0);
+        }
+        auto* big = arena.make<std::array<uint64_t, 64>>();
+        BOOST_REQUIRE_EQUAL((uintptr_t)big % alignof(uint64_t), 0);
+        BOOST_REQUIRE_EQUAL(alive, 100);
+    }
+    BOOST_REQUIRE_EQUAL(alive, 0);
+
+    // copies of a builder share the parsed expressions and types
+    auto f = loadFile("referendum.xml");
+    BOOST_REQUIRE(f);
+    DummyBuilder p;
+    std::unique_ptr<ColoredPetriNetBuilder> copy;
+    {
+        ColoredPetriNetBuilder b;
+        b.parseNet(f);
+        BOOST_REQUIRE_GT(b.arena().allocated(), 0);
+        copy = std::make_unique<ColoredPetriNetBuilder>(b);
+    }
+    copy->unfold(p);
+}
+
+BOOST_AUTO_TEST_CASE(HashConsedExpressions) {
+    ColoredPetriNetBuilder b;
+    auto& exprs = b.expressions();
+    Colored::ColorType type("T");
+    type.addColor("a");
+    type.addColor("b");
+    Colored::Variable x{"x", &type};
+
+    auto* dot = exprs.make<Colored::DotConstantExpression>();
+    BOOST_REQUIRE(dot == exprs.make<Colored::DotConstantExpression>());
+
+    auto one = [&](Colored::ColorExpression_ptr c, uint32_t n) {
+        std::vector<Colored::ColorExpression_ptr> colors{c};
+        return exprs.make<Colored::NumberOfExpression>(std::move(colors), n);
+    };
+    auto* var = exprs.make<Colored::VariableExpression>(&x);
+    auto* a = exprs.make<Colored::UserOperatorExpression>(type["a"]);
+    BOOST_REQUIRE(var == exprs.make<Colored::VariableExpression>(&x));
+    BOOST_REQUIRE(a == exprs.make<Colored::UserOperatorExpression>(type["a"]));
+    BOOST_REQUIRE(one(var, 1) == one(var, 1));
+    BOOST_REQUIRE(one(var, 1) != one(var, 2));
+    BOOST_REQUIRE(one(var, 1) != one(a, 1));
+
+    auto* guard = exprs.make<Colored::EqualityExpression>(var, a);
+    BOOST_REQUIRE(guard == exprs.make<Colored::EqualityExpression>(var, a));
+    BOOST_REQUIRE((const void*)guard != exprs.make<Colored::InequalityExpression>(var, a));
+
+    BOOST_REQUIRE_EQUAL(exprs.size(), 8);
+    BOOST_REQUIRE(exprs[guard->id()] == guard);
+    BOOST_REQUIRE(exprs[dot->id()] == dot);
+}
+
 BOOST_AUTO_TEST_CASE(UnfoldLoop, * utf::timeout(5)) {
     class PBuilder : public DummyBuilder {
     public:
@@ -1386,4 +1591,428 @@ BOOST_AUTO_TEST_CASE(ColoredGuards, * utf::timeout(5)) {
     b.parseNet(f);
     PBuilder p;
     b.unfold(p);
-}
\ No newline at end of file
+}
+
+class RecordingBuilder : public DummyBuilder {
+public:
+    std::vector<std::string> lines;
+    void addPlace(const std::string& name, int tokens, bool strict, int bound,
+        double, double) {
+        lines.push_back("P " + name + " " + std::to_string(tokens) + " " +
+            std::to_string(strict) + " " + std::to_string(bound));
+    }
+
+    virtual void addTransition(const std::string &name, int player, bool urgent,
+        double, double) {
+        lines.push_back("T " + name + " " + std::to_string(player) + " " + std::to_string(urgent));
+    };
+
+    virtual void addInputArc(const std::string &place, const std::string &transition,
+        bool inhibitor, int weight, bool lstrict, bool ustrict, int lower, int upper) {
+        lines.push_back("I " + place + " " + transition + " " + std::to_string(inhibitor) + " " +
+            std::to_string(weight) + " " + std::to_string(lstrict) + std::to_string(ustrict) + " " +
+            std::to_string(lower) + " " + std::to_string(upper));
+    };
+
+    virtual void addOutputArc(const std::string& transition, const std::string& place,
+        int weight) {
+        lines.push_back("O " + transition + " " + place + " " + std::to_string(weight));
+    };
+
+    virtual void addTransportArc(const std::string& source, const std::string& transition,
+        const std::string& target, int weight, bool lstrict, bool ustrict, int lower, int upper) {
+        lines.push_back("A " + source + " " + transition + " " + target + " " + std::to_string(weight) + " " +
+            std::to_string(lstrict) + std::to_string(ustrict) + " " +
+            std::to_string(lower) + " " + std::to_string(upper));
+    }
+};
+
+BOOST_AUTO_TEST_CASE(ParseEntryPoints) {
+    // the file, streaming and threaded parsers, as well as a snapshot of the
+    // parsed net, have to produce the same net as the DOM parser
+    // range and product colors are resolved by the parser threads without locking
+    for (auto* file : {"referendum.xml", "transport_arc.xml", "color_inv_map.xml",
+                       "inhib_arc.xml", "product_inv_map.xml", "token_ring.pnml",
+                       "finite_range_member.xml", "int_range.pnml", "product.xml"}) {
+        BOOST_TEST_CONTEXT(file) {
+            RecordingBuilder dom, streamed, mapped, threaded, restored, retried;
+            {
+                auto f = loadFile(file);
+                BOOST_REQUIRE(f);
+                ColoredPetriNetBuilder b;
+                b.parseNet(f);
+                b.unfold(dom);
+            }
+            {
+                auto f = loadFile(file);
+                BOOST_REQUIRE(f);
+                ColoredPetriNetBuilder b;
+                b.parseNetStreaming(f);
+                b.unfold(streamed);
+            }
+            {
+                ColoredPetriNetBuilder b;
+                b.parseNetFile(std::string(getenv("TEST_FILES")) + "/cpn_format/" + file);
+                b.unfold(mapped);
+            }
+            {
+                auto f = loadFile(file);
+                BOOST_REQUIRE(f);
+                ColoredPetriNetBuilder b;
+                b.setParseThreads(4);
+                b.parseNet(f);
+                b.unfold(threaded);
+
+                std::stringstream snapshot;
+                b.writeSnapshot(snapshot);
+                ColoredPetriNetBuilder r;
+                BOOST_REQUIRE(r.readSnapshot(snapshot));
+                r.unfold(restored);
+
+                // truncated snapshots are rejected without changing the builder
+                auto data = snapshot.str();
+                std::stringstream truncated(data.substr(0, data.size() / 2));
+                ColoredPetriNetBuilder t;
+                BOOST_REQUIRE(!t.readSnapshot(truncated));
+                BOOST_REQUIRE_EQUAL(t.expressions().size(), 0);
+                std::stringstream full(data);
+                BOOST_REQUIRE(t.readSnapshot(full));
+                t.unfold(retried);
+            }
+            std::sort(dom.lines.begin(), dom.lines.end());
+            std::sort(streamed.lines.begin(), streamed.lines.end());
+            std::sort(mapped.lines.begin(), mapped.lines.end());
+            std::sort(threaded.lines.begin(), threaded.lines.end());
+            std::sort(restored.lines.begin(), restored.lines.end());
+            std::sort(retried.lines.begin(), retried.lines.end());
+            BOOST_REQUIRE(!dom.lines.empty());
+            BOOST_REQUIRE(dom.lines == streamed.lines);
+            BOOST_REQUIRE(dom.lines == mapped.lines);
+            BOOST_REQUIRE(dom.lines == threaded.lines);
+            BOOST_REQUIRE(dom.lines == restored.lines);
+            BOOST_REQUIRE(dom.lines == retried.lines);
+        }
+    }
+
+    // elements split across tiny read windows
+    std::istringstream xml("<?xml version=\"1.0\"?><!-- <place/> --><pnml a=\"x>y\">"
+                           "<net><place id=\"p\"><![CDATA[</place>]]></place><skip><place/></skip>"
+                           "<transition id=\"t\"/></net></pnml>");
+    XMLFragmentReader reader(xml, 3);
+    std::vector<std::string> captured;
+    bool ok = reader.read([](const std::string& name, size_t) {
+            if (name == "skip") return XMLFragmentReader::Skip;
+            if (name == "place" || name == "transition") return XMLFragmentReader::Capture;
+            return XMLFragmentReader::Descend;
+        }, [&](const std::string&, std::vector<char>&& text) {
+            captured.emplace_back(text.data());
+        });
+    BOOST_REQUIRE(ok);
+    BOOST_REQUIRE_EQUAL(captured.size(), 2);
+    BOOST_REQUIRE_EQUAL(captured[0], "<place id=\"p\"><![CDATA[</place>]]></place>");
+    BOOST_REQUIRE_EQUAL(captured[1], "<transition id=\"t\"/>");
+}
+
+BOOST_AUTO_TEST_CASE(IncrementalUnfold) {
+    Colored::UnfoldCache cache;
+    std::stringstream first_out, second_out, fresh_out;
+    RecordingBuilder first, second, edited, fresh;
+    {
+        auto f = loadFile("referendum.xml");
+        BOOST_REQUIRE(f);
+        ColoredPetriNetBuilder b(&first_out);
+        b.parseNet(f);
+        b.unfold(first, cache);
+        BOOST_REQUIRE_EQUAL(cache.replayedPlaces(), 0);
+        BOOST_REQUIRE_EQUAL(cache.replayedTransitions(), 0);
+    }
+    auto f = loadFile("referendum.xml");
+    BOOST_REQUIRE(f);
+    ColoredPetriNetBuilder b(&second_out);
+    b.parseNet(f);
+    b.unfold(second, cache);
+    BOOST_REQUIRE_EQUAL(cache.replayedPlaces(), b.getPlaceCount());
+    BOOST_REQUIRE_EQUAL(cache.replayedTransitions(), b.getTransitionCount());
+    BOOST_REQUIRE(!first.lines.empty());
+    BOOST_REQUIRE(first.lines == second.lines);
+    BOOST_REQUIRE_EQUAL(first_out.str(), second_out.str());
+
+    // only the new place is unfolded
+    b.addPlace("extra", Colored::Multiset(), nullptr, {Colored::TimeInvariant(Colored::Color())});
+    b.unfold(edited, cache);
+    BOOST_REQUIRE_EQUAL(cache.replayedPlaces(), b.getPlaceCount() - 1);
+    BOOST_REQUIRE_EQUAL(cache.replayedTransitions(), b.getTransitionCount());
+    b.unfold(fresh);
+    BOOST_REQUIRE(edited.lines == fresh.lines);
+}
+
+BOOST_AUTO_TEST_CASE(IncrementalUnfoldEdits) {
+    auto f = loadFile("incremental.xml");
+    BOOST_REQUIRE(f);
+    std::string xml((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    struct edit_t {
+        const char* name;
+        std::string xml;
+        std::vector<std::string> places;
+        std::vector<std::string> transitions;
+    };
+    std::vector<edit_t> edits = {
+        {"guard", std::regex_replace(xml, std::regex("equality>"), "inequality>"), {}, {"TG"}},
+        {"arc", std::regex_replace(xml, std::regex("successor>"), "predecessor>"), {}, {"TA"}},
+        {"type", std::regex_replace(xml, std::regex("(<feconstant id=\"d1\" name=\"D\"/>)"),
+            "$1<feconstant id=\"d2\" name=\"D\"/>"), {"PQ"}, {"TD"}}
+    };
+    for (auto& edit : edits) {
+        BOOST_TEST_CONTEXT(edit.name) {
+            BOOST_REQUIRE(edit.xml != xml);
+            Colored::UnfoldCache cache;
+            RecordingBuilder original, edited, fresh;
+            std::stringstream original_out, edited_out, fresh_out;
+            {
+                std::istringstream net(xml);
+                ColoredPetriNetBuilder b(&original_out);
+                b.parseNet(net);
+                b.unfold(original, cache);
+            }
+            {
+                std::istringstream net(edit.xml);
+                ColoredPetriNetBuilder b(&edited_out);
+                b.parseNet(net);
+                b.unfold(edited, cache);
+                BOOST_REQUIRE(cache.unfoldedPlaces() == edit.places);
+                BOOST_REQUIRE(cache.unfoldedTransitions() == edit.transitions);
+                BOOST_REQUIRE_EQUAL(cache.replayedPlaces(), b.getPlaceCount() - edit.places.size());
+                BOOST_REQUIRE_EQUAL(cache.replayedTransitions(), b.getTransitionCount() - edit.transitions.size());
+            }
+            {
+                std::istringstream net(edit.xml);
+                ColoredPetriNetBuilder b(&fresh_out);
+                b.parseNet(net);
+                b.unfold(fresh);
+            }
+            BOOST_REQUIRE(original.lines != edited.lines);
+            BOOST_REQUIRE(edited.lines == fresh.lines);
+            BOOST_REQUIRE_EQUAL(edited_out.str(), fresh_out.str());
+        }
+    }
+
+    // transitions cached without an output stream have no bindings to replay
+    Colored::UnfoldCache cache;
+    std::stringstream replayed_out, fresh_out;
+    for (auto* out : {(std::stringstream*)nullptr, &replayed_out, &fresh_out}) {
+        std::istringstream net(xml);
+        ColoredPetriNetBuilder b(out);
+        b.parseNet(net);
+        RecordingBuilder builder;
+        if (out == &fresh_out)
+            b.unfold(builder);
+        else
+            b.unfold(builder, cache);
+    }
+    BOOST_REQUIRE_EQUAL(cache.unfoldedTransitions().size(), 3);
+    BOOST_REQUIRE_EQUAL(replayed_out.str(), fresh_out.str());
+}
+
+BOOST_AUTO_TEST_CASE(CompressedInput) {
+    std::vector<std::pair<const char*, const char*>> files;
+#ifdef HAVE_ZLIB
+    files.emplace_back("referendum.xml", "referendum.xml.gz");
+#endif
+#ifdef HAVE_LZMA
+    files.emplace_back("token_ring.pnml", "token_ring.pnml.xz");
+#endif
+    for (auto& [plain, compressed] : files) {
+        BOOST_TEST_CONTEXT(compressed) {
+            RecordingBuilder expected, stream, file, streamed;
+            {
+                auto f = loadFile(plain);
+                BOOST_REQUIRE(f);
+                ColoredPetriNetBuilder b;
+                b.parseNet(f);
+                b.unfold(expected);
+            }
+            {
+                auto f = loadFile(compressed);
+                BOOST_REQUIRE(f);
+                ColoredPetriNetBuilder b;
+                b.parseNet(f);
+                b.unfold(stream);
+            }
+            {
+                ColoredPetriNetBuilder b;
+                b.parseNetFile(std::string(getenv("TEST_FILES")) + "/cpn_format/" + compressed);
+                b.unfold(file);
+            }
+            {
+                auto f = loadFile(compressed);
+                BOOST_REQUIRE(f);
+                ColoredPetriNetBuilder b;
+                b.parseNetStreaming(f);
+                b.unfold(streamed);
+            }
+            std::sort(streamed.lines.begin(), streamed.lines.end());
+            auto sorted = expected.lines;
+            std::sort(sorted.begin(), sorted.end());
+            BOOST_REQUIRE(!expected.lines.empty());
+            BOOST_REQUIRE(expected.lines == stream.lines);
+            BOOST_REQUIRE(expected.lines == file.lines);
+            BOOST_REQUIRE(sorted == streamed.lines);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ConstantReinstantiation) {
+    auto load = [](const std::string& low, const std::string& high) {
+        auto f = loadFile("constants.xml");
+        std::stringstream ss;
+        ss << f.rdbuf();
+        auto text = ss.str();
+        auto replace = [&](const std::string& from, const std::string& to) {
+            auto pos = text.find(from);
+            BOOST_REQUIRE(pos != std::string::npos);
+            text.replace(pos, from.size(), to);
+        };
+        replace("name=\"low\" value=\"1\"", "name=\"low\" value=\"" + low + "\"");
+        replace("name=\"high\" value=\"3\"", "name=\"high\" value=\"" + high + "\"");
+        return text;
+    };
+
+    std::stringstream xml(load("1", "3"));
+    ColoredPetriNetBuilder b;
+    b.parseNet(xml);
+    BOOST_REQUIRE_EQUAL(b.getConstants().size(), 2);
+    BOOST_REQUIRE_EQUAL(b.getConstants().at("high"), 3);
+    RecordingBuilder initial;
+    b.unfold(initial);
+
+    for (auto [low, high] : {std::make_pair(2, 7), std::make_pair(0, 1)}) {
+        BOOST_TEST_CONTEXT(low << " " << high) {
+            b.setConstants({{"low", low}, {"high", high}});
+            RecordingBuilder swept, expected;
+            b.unfold(swept);
+
+            std::stringstream reparsed(load(std::to_string(low), std::to_string(high)));
+            ColoredPetriNetBuilder r;
+            r.parseNet(reparsed);
+            r.unfold(expected);
+            BOOST_REQUIRE(swept.lines == expected.lines);
+            BOOST_REQUIRE(swept.lines != initial.lines);
+        }
+    }
+
+    // symbolic bounds survive a snapshot
+    std::stringstream snapshot;
+    b.writeSnapshot(snapshot);
+    ColoredPetriNetBuilder restored;
+    BOOST_REQUIRE(restored.readSnapshot(snapshot));
+    restored.setConstants({{"low", 1}, {"high", 3}});
+    RecordingBuilder back;
+    restored.unfold(back);
+    BOOST_REQUIRE(back.lines == initial.lines);
+}
+
+BOOST_AUTO_TEST_CASE(NetReduction) {
+    const int inf = std::numeric_limits<int>::max();
+    RecordingBuilder reduced, recorded;
+    TAPNBuilderInterface& expected = recorded;
+    NetReducer reducer(reduced);
+    reducer.addPlace("P0", 1, false, inf, 0, 0);
+    reducer.addPlace("P1", 0, false, inf, 0, 0);
+    reducer.addPlace("P2", 0, false, inf, 0, 0);
+    reducer.addPlace("Isolated", 2, false, inf, 0, 0);
+    reducer.addPlace("Invariant", 1, false, 5, 0, 0);
+    reducer.addTransition("T0", 0, false, 0, 0, 0, {}, 1, 0);
+    reducer.addTransition("T0copy", 0, false, 0, 0, 0, {}, 1, 0);
+    reducer.addTransition("T1", 0, false, 0, 0, 0, {}, 1, 0);
+    reducer.addTransition("T2", 0, false, 0, 0, 0, {}, 1, 0);
+    for (auto* t : {"T0", "T0copy"}) {
+        reducer.addInputArc("P0", t, false, 1, false, false, 1, 3);
+        reducer.addOutputArc(t, "P1", 1);
+    }
+    reducer.addInputArc("P2", "T1", false, 1, false, false, 0, inf);
+    reducer.addOutputArc("T1", "P1", 1);
+    reducer.addInputArc("P1", "T2", false, 1, false, false, 0, inf);
+    reducer.addInputArc("P2", "T2", true, 1, false, false, 0, inf);
+    reducer.addOutputArc("T2", "P0", 1);
+    reducer.reduce();
+
+    // P2 is never marked, so T1 is dead and the inhibitor arc of T2 is
+    // always satisfied. The invariant of the isolated place stops time.
+    expected.addPlace("P0", 1, false, inf, 0, 0);
+    expected.addPlace("P1", 0, false, inf, 0, 0);
+    expected.addPlace("Invariant", 1, false, 5, 0, 0);
+    expected.addTransition("T0", 0, false, 0, 0, 0, {}, 2, 0);
+    expected.addTransition("T2", 0, false, 0, 0, 0, {}, 1, 0);
+    expected.addInputArc("P0", "T0", false, 1, false, false, 1, 3);
+    expected.addOutputArc("T0", "P1", 1);
+    expected.addInputArc("P1", "T2", false, 1, false, false, 0, inf);
+    expected.addOutputArc("T2", "P0", 1);
+    BOOST_REQUIRE(reduced.lines == recorded.lines);
+
+    BOOST_REQUIRE_EQUAL(reducer.removedPlaces().size(), 2);
+    BOOST_REQUIRE_EQUAL(reducer.removedPlaces().at("Isolated"), 2);
+    BOOST_REQUIRE_EQUAL(reducer.removedPlaces().at("P2"), 0);
+    BOOST_REQUIRE(reducer.removedTransitions() == std::vector<std::string>{"T1"});
+    BOOST_REQUIRE(reducer.mergedTransitions("T0") == std::vector<std::string>{"T0copy"});
+    BOOST_REQUIRE(reducer.mergedTransitions("T2").empty());
+}
+
+BOOST_AUTO_TEST_CASE(Symmetries) {
+    auto f = loadFile("referendum.xml");
+    BOOST_REQUIRE(f);
+    std::string xml((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    {
+        // Voters1 has its own invariant and intervals
+        std::istringstream net(xml);
+        ColoredPetriNetBuilder b;
+        b.parseNet(net);
+        DummyBuilder p;
+        b.unfold(p);
+        BOOST_REQUIRE(b.getSymmetries().empty());
+    }
+    {
+        // without them voters are only matched by variables and all
+        std::istringstream net(std::regex_replace(xml, std::regex("<color(invariant|interval)>[\\s\\S]*?</color\\1>"), ""));
+        ColoredPetriNetBuilder b;
+        b.parseNet(net);
+        DummyBuilder p;
+        b.unfold(p);
+        auto symmetries = b.getSymmetries();
+        BOOST_REQUIRE_EQUAL(symmetries.size(), 1);
+        auto& voters = symmetries[0];
+        BOOST_REQUIRE_EQUAL(voters.sort, "Voters");
+        BOOST_REQUIRE_EQUAL(voters.colors.size(), 10);
+        BOOST_REQUIRE_EQUAL(voters.generators.size(), 2);
+        auto& swap = voters.generators[0];
+        BOOST_REQUIRE_EQUAL(swap.size(), 6);
+        BOOST_REQUIRE_EQUAL(swap.at("voting__0"), "voting__1");
+        BOOST_REQUIRE_EQUAL(swap.at("voted_yes__1"), "voted_yes__0");
+        auto& rotate = voters.generators[1];
+        BOOST_REQUIRE_EQUAL(rotate.size(), 30);
+        BOOST_REQUIRE_EQUAL(rotate.at("voted_no__9"), "voted_no__0");
+    }
+    {
+        // the successor orders the colors of the ring
+        auto f = loadFile("token_ring.pnml");
+        BOOST_REQUIRE(f);
+        ColoredPetriNetBuilder b;
+        b.parseNet(f);
+        DummyBuilder p;
+        b.unfold(p);
+        BOOST_REQUIRE(b.getSymmetries().empty());
+    }
+    {
+        // A and B have the same values, so the guard x = y relates them
+        auto f = loadFile("range_guard.xml");
+        BOOST_REQUIRE(f);
+        std::string xml((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        for (bool guarded : {true, false}) {
+            std::istringstream net(guarded ? xml : std::regex_replace(xml, std::regex("<condition>[\\s\\S]*?</condition>"), ""));
+            ColoredPetriNetBuilder b;
+            b.parseNet(net);
+            DummyBuilder p;
+            b.unfold(p);
+            BOOST_REQUIRE_EQUAL(b.getSymmetries().size(), guarded ? 0 : 2);
+        }
+    }
+}
@@ -21,11 +21,19 @@
 #include "unfoldtacpn.h"
 #include "PQL/Expressions.h"
 #include "PQL/Visitor.h"
+#include "PQL/QuerySimplifier.h"
+#include "PQL/QuerySet.h"
+#include "PQL/PQLParser.h"
 
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <set>
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <thread>
 
 using namespace unfoldtacpn;
 
@@ -208,4 +216,327 @@ BOOST_AUTO_TEST_CASE(UnfoldTest) {
             }
         }
     }
-}
\ No newline at end of file
+}
+BOOST_AUTO_TEST_CASE(ColorSpecificPlaces) {
+    auto f = loadFile("product.xml");
+    BOOST_REQUIRE(f);
+    ColoredPetriNetBuilder b;
+    b.parseNet(f);
+    DummyBuilder p;
+    b.unfold(p);
+
+    std::vector<std::pair<std::string, size_t>> cases = {
+        {"EF SIMPLE[2] = 1", 1},
+        {"EF PRODUCT[(1,2)] = 1", 1},
+        {"EF PRODUCT[(1,*)] = 1", 2},
+        {"EF PRODUCT[(*, *)] = 1", 4},
+        {"EF DOT[dot] = 1", 1}
+    };
+    for (auto& c : cases) {
+        BOOST_TEST_CONTEXT(c.first) {
+            std::stringstream ss(c.first);
+            auto res = unfoldtacpn::parse_string_queries(b, ss);
+            BOOST_REQUIRE_EQUAL(res.size(), 1);
+            PVisitor v;
+            res[0].first->visit(v);
+            BOOST_REQUIRE_EQUAL(v._seen.size(), c.second);
+        }
+    }
+
+    // the color of the first constituent is fixed
+    std::stringstream ss("EF PRODUCT[(1,*)] = 1");
+    auto res = unfoldtacpn::parse_string_queries(b, ss);
+    PVisitor first;
+    res[0].first->visit(first);
+    std::stringstream xs("<property-set><property><id>A</id><description/><formula><exists-path><finally>"
+        "<integer-eq><tokens-count><place color=\"(1, *)\">PRODUCT</place></tokens-count>"
+        "<integer-constant>1</integer-constant></integer-eq></finally></exists-path></formula></property></property-set>");
+    auto xres = unfoldtacpn::parse_xml_queries(b, xs, {});
+    BOOST_REQUIRE_EQUAL(xres.size(), 1);
+    PVisitor xml;
+    xres[0].first->visit(xml);
+    BOOST_REQUIRE(first._seen == xml._seen);
+
+    for (std::string s : {"EF PRODUCT[(1,2,1)] = 1", "EF PRODUCT[3] = 1"}) {
+        std::stringstream es(s);
+        BOOST_CHECK_THROW(unfoldtacpn::parse_string_queries(b, es), ExprError);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SharedExpansion) {
+    class SumVisitor : public DummyVisitor {
+    public:
+        std::vector<const PlusExpr*> _sums;
+        void _accept(const PlusExpr* element) override {
+            _sums.push_back(element);
+        }
+    };
+
+    auto f = loadFile("product.xml");
+    BOOST_REQUIRE(f);
+    ColoredPetriNetBuilder b;
+    b.parseNet(f);
+    DummyBuilder p;
+    b.unfold(p);
+
+    std::vector<std::pair<Condition_ptr, std::string>> queries;
+    for (std::string s : {"EF SIMPLE = 1", "AG SIMPLE <= 2"}) {
+        std::stringstream ss(s);
+        auto res = unfoldtacpn::parse_string_queries(ss);
+        BOOST_REQUIRE_EQUAL(res.size(), 1);
+        queries.push_back(res[0]);
+    }
+    unfoldtacpn::analyze_queries(b, queries);
+
+    // both queries refer to the one expansion of SIMPLE
+    SumVisitor first, second;
+    queries[0].first->visit(first);
+    queries[1].first->visit(second);
+    BOOST_REQUIRE_EQUAL(first._sums.size(), 1);
+    BOOST_REQUIRE_EQUAL(second._sums.size(), 1);
+    BOOST_REQUIRE(first._sums[0] == second._sums[0]);
+}
+
+BOOST_AUTO_TEST_CASE(ConeOfInfluence) {
+    class NameBuilder : public DummyBuilder {
+    public:
+        std::set<std::string> places, transitions;
+        void addPlace(const std::string& name, int, bool, int, double, double) override {
+            places.insert(name);
+        }
+        void addTransition(const std::string& name, int, bool, double, double) override {
+            transitions.insert(name);
+        }
+    };
+
+    auto unfold = [](const std::string& query, NameBuilder& p) {
+        auto f = loadFile("cone.xml");
+        BOOST_REQUIRE(f);
+        ColoredPetriNetBuilder b;
+        b.parseNet(f);
+        std::stringstream ss(query);
+        auto res = unfoldtacpn::parse_string_queries(ss);
+        unfoldtacpn::unfold_for_queries(b, p, res);
+        unfoldtacpn::analyze_queries(b, res);
+    };
+
+    // B is produced by T1 from A, which T3 also consumes, E has an invariant
+    NameBuilder reach;
+    unfold("EF B >= 1", reach);
+    BOOST_REQUIRE(reach.places == std::set<std::string>({"A", "B", "E", "G"}));
+    BOOST_REQUIRE(reach.transitions == std::set<std::string>({"T1", "T3", "T4"}));
+
+    for (std::string s : {"EF deadlock", "EG B >= 1", "control: AG B <= 1"}) {
+        BOOST_TEST_CONTEXT(s) {
+            NameBuilder all;
+            unfold(s, all);
+            BOOST_REQUIRE_EQUAL(all.places.size(), 6);
+            BOOST_REQUIRE_EQUAL(all.transitions.size(), 4);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SimplifyQueries) {
+    auto f = loadFile("cone.xml");
+    BOOST_REQUIRE(f);
+    ColoredPetriNetBuilder b;
+    b.parseNet(f);
+    DummyBuilder p;
+    PQL::PlaceBounds bounds(p);
+    b.unfold(bounds);
+
+    auto query = [&](const std::string& s) {
+        std::stringstream ss(s);
+        auto res = unfoldtacpn::parse_string_queries(b, ss);
+        BOOST_REQUIRE_EQUAL(res.size(), 1);
+        return res;
+    };
+    auto xml = [](const PQL::Condition_ptr& c) {
+        std::stringstream ss;
+        PQL::to_xml(ss, *c);
+        return ss.str();
+    };
+
+    // A, C and E only lose their single token, B, D and G only gain tokens
+    std::vector<std::pair<std::string, std::string>> cases = {
+        {"EF A <= 1", "EF true"},
+        {"EF (A >= 2 or B >= 1)", "EF B >= 1"},
+        {"AG (B >= 1 and B >= 1 and (C <= 1 and D + 0 + 1 + 2 >= 0))", "AG B >= 1"},
+        {"EF not not A = 3", "EF false"},
+        {"EF ((B >= 1 or D >= 1) and (B >= 1 or D + 0 >= 1))", "EF (B >= 1 or D >= 1)"},
+        {"AG (B + (D + 2 * 3) > 1 * 2 * G)", "AG B + D + 6 > G * 2"}
+    };
+    for (auto& c : cases) {
+        BOOST_TEST_CONTEXT(c.first) {
+            auto res = query(c.first);
+            unfoldtacpn::simplify_queries(res, bounds);
+            // the expected query only has its sums and products flattened
+            PQL::QuerySimplifier flatten;
+            BOOST_REQUIRE_EQUAL(xml(res[0].first), xml(flatten.simplify(query(c.second)[0].first)));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SharedQuerySet) {
+    auto f = loadFile("cone.xml");
+    BOOST_REQUIRE(f);
+    ColoredPetriNetBuilder b;
+    b.parseNet(f);
+    DummyBuilder p;
+    b.unfold(p);
+
+    std::vector<std::pair<Condition_ptr, std::string>> queries;
+    for (std::string s : {"EF (A >= 2 or B >= 1)", "AG (B >= 1 and C <= 1)", "EF A >= 2"}) {
+        std::stringstream ss(s);
+        auto res = unfoldtacpn::parse_string_queries(b, ss);
+        BOOST_REQUIRE_EQUAL(res.size(), 1);
+        queries.push_back(res[0]);
+    }
+    queries.emplace_back(nullptr, "failed");
+    PQL::QuerySet set(queries);
+
+    BOOST_REQUIRE_EQUAL(set.queries().size(), queries.size());
+    BOOST_REQUIRE_EQUAL(set.root(3), PQL::QuerySet::NONE);
+    for (size_t i = 0; i < 3; ++i) {
+        std::stringstream a, b;
+        PQL::to_xml(a, *queries[i].first);
+        PQL::to_xml(b, *set.queries()[i].first);
+        BOOST_REQUIRE_EQUAL(a.str(), b.str());
+        BOOST_REQUIRE(set.node(set.root(i)).condition == set.queries()[i].first);
+    }
+    for (uint32_t id = 0; id < set.nodes(); ++id)
+        for (auto op : set.node(id).operands)
+            BOOST_REQUIRE_LT(op, id);
+
+    // A >= 2, B >= 1 and C <= 1 are each one node, whichever query they are in
+    BOOST_REQUIRE_EQUAL(set.atoms().size(), 3);
+    auto disjunction = set.node(set.root(0)).operands[0];
+    auto conjunction = set.node(set.root(1)).operands[0];
+    BOOST_REQUIRE_EQUAL(set.node(set.root(2)).operands[0], set.node(disjunction).operands[0]);
+    BOOST_REQUIRE_EQUAL(set.node(disjunction).operands[1], set.node(conjunction).operands[0]);
+
+    // a condition dropped after it was numbered does not pass its number on
+    // to a later one allocated in its place
+    auto first = set.node(set.atoms()[0]).condition;
+    auto second = set.node(set.atoms()[1]).condition;
+    auto negated = set.add(std::make_shared<PQL::NotCondition>(first));
+    for (size_t i = 0; i < 8; ++i) {
+        BOOST_REQUIRE_EQUAL(set.add(std::make_shared<PQL::NotCondition>(first)), negated);
+        auto other = set.add(std::make_shared<PQL::NotCondition>(second));
+        BOOST_REQUIRE_NE(other, negated);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(QueryEncodings) {
+    auto f = loadFile("product.xml");
+    BOOST_REQUIRE(f);
+    ColoredPetriNetBuilder b;
+    b.parseNet(f);
+    DummyBuilder p;
+    b.unfold(p);
+
+    std::vector<std::pair<PQL::Condition_ptr, std::string>> queries;
+    for (std::string s : {"EF (SIMPLE = 1 and PRODUCT[(1,*)] >= 2)", "AG (SIMPLE <= 2 or -DOT + 1 < 3 * PRODUCT)"}) {
+        std::stringstream ss(s);
+        auto res = unfoldtacpn::parse_string_queries(ss);
+        queries.push_back(res[0]);
+    }
+    unfoldtacpn::analyze_queries(b, queries);
+
+    auto xml = [](const std::vector<std::pair<PQL::Condition_ptr, std::string>>& qs, bool newlines) {
+        std::stringstream ss;
+        for (auto& q : qs)
+            PQL::to_xml(ss, *q.first, 0, 2, newlines);
+        return ss.str();
+    };
+
+    auto compact = xml(queries, false);
+    BOOST_REQUIRE(compact.find_first_of(" \n") == std::string::npos);
+    auto pretty = xml(queries, true);
+    pretty.erase(std::remove_if(pretty.begin(), pretty.end(), ::isspace), pretty.end());
+    BOOST_REQUIRE_EQUAL(compact, pretty);
+
+    std::string data;
+    PQL::to_binary(data, queries);
+    std::vector<std::pair<PQL::Condition_ptr, std::string>> decoded;
+    BOOST_REQUIRE(PQL::from_binary(data, decoded));
+    BOOST_REQUIRE_EQUAL(decoded.size(), 2);
+    BOOST_REQUIRE_EQUAL(decoded[1].second, queries[1].second);
+    BOOST_REQUIRE_EQUAL(xml(decoded, true), xml(queries, true));
+
+    // the expansion of SIMPLE is still shared between the queries
+    class SumVisitor : public DummyVisitor {
+    public:
+        std::set<const PlusExpr*> _sums;
+        void _accept(const PlusExpr* element) override {
+            _sums.insert(element);
+        }
+    };
+    SumVisitor first, second;
+    decoded[0].first->visit(first);
+    decoded[1].first->visit(second);
+    std::vector<const PlusExpr*> common;
+    std::set_intersection(first._sums.begin(), first._sums.end(), second._sums.begin(), second._sums.end(),
+                          std::back_inserter(common));
+    BOOST_REQUIRE_EQUAL(common.size(), 1);
+
+    for (size_t size : {(size_t)0, (size_t)4, data.size() - 1}) {
+        BOOST_REQUIRE(!PQL::from_binary(data.substr(0, size), decoded));
+    }
+    // huge counts anywhere after the magic are rejected, not allocated
+    for (size_t offset = 8; offset + 4 <= data.size(); ++offset) {
+        auto corrupt = data;
+        corrupt.replace(offset, 4, 4, '\xff');
+        BOOST_REQUIRE_NO_THROW(PQL::from_binary(corrupt, decoded));
+    }
+    BOOST_REQUIRE(!PQL::from_binary(data.substr(0, 8) + std::string(4, '\xff') + data.substr(12), decoded));
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentParsing) {
+    std::vector<std::string> queries = {
+        "EF (A >= 1 and B < 2)",
+        "AG !(C + D * 2 = 3) or deadlock",
+        "control: AG P[(a,*)] <= 1",
+        "EG true"
+    };
+    auto xml = [](const std::string& s) {
+        auto q = PQL::parseQuery(s);
+        BOOST_REQUIRE(q);
+        std::stringstream ss;
+        PQL::to_xml(ss, *q);
+        return ss.str();
+    };
+    std::vector<std::string> expected;
+    for (auto& q : queries)
+        expected.push_back(xml(q));
+
+    // the parser keeps no global state
+    std::vector<std::thread> threads;
+    std::atomic<size_t> mismatches(0);
+    for (size_t t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = 0; i < 200; ++i) {
+                auto j = (i + t) % queries.size();
+                auto q = PQL::parseQuery(queries[j]);
+                std::stringstream ss;
+                if (q)
+                    PQL::to_xml(ss, *q);
+                if (ss.str() != expected[j])
+                    ++mismatches;
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    BOOST_REQUIRE_EQUAL(mismatches.load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(InvalidQuery) {
+    // a syntax error fails the parse instead of ending the process
+    for (std::string s : {"EF (A >= 1", "AG A + >= 2", "EF A[(a,] = 1", "A >= 1", ""}) {
+        BOOST_TEST_CONTEXT(s) {
+            BOOST_REQUIRE(!PQL::parseQuery(s));
+        }
+    }
+    BOOST_REQUIRE(PQL::parseQuery("EF A >= 1"));
+}
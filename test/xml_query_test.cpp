@@ -67,6 +67,67 @@ BOOST_AUTO_TEST_CASE(GameQuery) {
     BOOST_REQUIRE(parser.queries[1].query != nullptr);
 }
 
+BOOST_AUTO_TEST_CASE(StreamedQueries) {
+    for (std::set<size_t> to_read : {std::set<size_t>{0}, std::set<size_t>{1}, std::set<size_t>{}}) {
+        auto f = loadFile("game_queries.xml");
+        BOOST_REQUIRE(f);
+        QueryXMLParser dom;
+        BOOST_REQUIRE(dom.parse(f, to_read));
+
+        auto g = loadFile("game_queries.xml");
+        BOOST_REQUIRE(g);
+        QueryXMLParser parser;
+        std::vector<QueryItem> streamed;
+        BOOST_REQUIRE(parser.parse(g, to_read, [&](QueryItem&& q) {
+            streamed.push_back(std::move(q));
+        }));
+        BOOST_REQUIRE(parser.queries.empty());
+        BOOST_REQUIRE_EQUAL(streamed.size(), dom.queries.size());
+        for (size_t i = 0; i < streamed.size(); ++i) {
+            BOOST_REQUIRE_EQUAL(streamed[i].id, dom.queries[i].id);
+            BOOST_REQUIRE_EQUAL(streamed[i].parsingResult, dom.queries[i].parsingResult);
+            BOOST_REQUIRE_EQUAL(streamed[i].query == nullptr, dom.queries[i].query == nullptr);
+            if (streamed[i].query) {
+                std::stringstream a, b;
+                PQL::to_xml(a, *streamed[i].query);
+                PQL::to_xml(b, *dom.queries[i].query);
+                BOOST_REQUIRE_EQUAL(a.str(), b.str());
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ParallelQueries) {
+    auto print = [](size_t threads) {
+        auto f = loadFile("game_queries.xml");
+        BOOST_REQUIRE(f);
+        auto queries = parse_xml_queries(f, {0, 1}, threads);
+        std::stringstream ss;
+        PQL::to_xml(ss, queries);
+        return ss.str();
+    };
+    auto sequential = print(1);
+    BOOST_REQUIRE_EQUAL(sequential, print(4));
+    BOOST_REQUIRE(sequential.find("<property>") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(InvalidQuery) {
+    // the error is reported by the calling thread, the workers do not exit
+    std::string xml =
+        "<property-set><property><id>bad</id><formula>"
+        "<all-paths><finally><unknown-formula/></finally></all-paths>"
+        "</formula></property></property-set>";
+    for (size_t threads : {1, 4}) {
+        std::istringstream in(xml);
+        QueryXMLParser parser;
+        parser.setParseThreads(threads);
+        BOOST_REQUIRE(!parser.parse(in, {}));
+    }
+    std::istringstream in(xml);
+    QueryXMLParser parser;
+    BOOST_REQUIRE(!parser.parse(in, {}, [](QueryItem&&) {}));
+}
+
 using namespace PQL;
 class DummyVisitor : public PQL::Visitor {
 public: